@@ -5,8 +5,8 @@
 #include <sstream>
 #include <functional>
 #include <random>
-#include <ctime>
 #include <iostream>
+#include "../common/rng.hpp"
 
 const int WINDOW_WIDTH = 800;
 const int WINDOW_HEIGHT = 600;
@@ -245,7 +245,8 @@ std::vector<std::vector<int>> getLevelLayout(int level)
 
 int main()
 {
-    std::srand(static_cast<unsigned int>(std::time(nullptr))); // Ensure consistent randomization by initializing the random seed
+    std::random_device seedSource;
+    Pcg32 rng = makeRng(seedSource(), STREAM_GAMEPLAY); // launch angles
 
     sf::RenderWindow window(sf::VideoMode(WINDOW_WIDTH, WINDOW_HEIGHT), "Breakout");
     window.setFramerateLimit(60);
@@ -384,8 +385,8 @@ int main()
             // Lancement de la balle
             if (!balls.empty() && !balls[0].launched && sf::Keyboard::isKeyPressed(sf::Keyboard::Space))
             {
-                float angle = (std::rand() % 120 + 30) * 3.14159f / 180.f;
-                balls[0].velocity = sf::Vector2f(BALL_SPEED * std::cos(angle), BALL_SPEED * -std::sin(angle));
+                float turns = rng.uniform(30.0f, 150.0f) / 360.0f;
+                balls[0].velocity = sf::Vector2f(BALL_SPEED * fastCosTurns(turns), BALL_SPEED * -fastSinTurns(turns));
                 balls[0].launched = true;
             }
             // Mouvement et collisions pour chaque balle
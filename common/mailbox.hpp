@@ -0,0 +1,37 @@
+#pragma once
+
+#include <atomic>
+
+// Latest-value mailbox between one writer thread and one reader thread
+// (triple buffering). The writer never waits and never overwrites the
+// slot being read; the reader always gets the newest complete value, and
+// values it did not pick up in time are simply replaced. Neither side ever
+// takes a lock, so a render loop can poll it every frame.
+template <typename T>
+class Mailbox {
+public:
+    // Writer only
+    void publish(const T& value) {
+        slots[back] = value;
+        unsigned previous = middle.exchange(back | FRESH, std::memory_order_acq_rel);
+        back = previous & INDEX;
+    }
+
+    // Reader only; false when nothing was published since the last fetch
+    bool fetch(T& value) {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+        unsigned previous = middle.exchange(front, std::memory_order_acq_rel);
+        front = previous & INDEX;
+        value = slots[front];
+        return true;
+    }
+
+private:
+    static constexpr unsigned INDEX = 3;
+    static constexpr unsigned FRESH = 4;
+
+    T slots[3] = {};
+    unsigned back = 0;                // the writer's slot
+    std::atomic<unsigned> middle{1};  // the slot in between, and whether it holds a new value
+    unsigned front = 2;               // the reader's slot
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent worker pool shared by the game AIs and headless tools.
+// parallelFor hands out indices from a shared counter, so uneven work items
+// balance themselves, and the calling thread takes part in the loop.
+class ThreadPool {
+public:
+    // 0 threads = one per hardware thread
+    explicit ThreadPool(unsigned threads = 0) {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        // The caller is one of the threads
+        for (unsigned i = 1; i < threads; ++i)
+            workers.emplace_back([this] { workerLoop(); });
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+    // Run fn(i) for every i in [0, count) and return once all calls finished
+    void parallelFor(std::size_t count, const std::function<void(std::size_t)>& fn) {
+        if (count == 0) return;
+        if (workers.empty() || count == 1) {
+            for (std::size_t i = 0; i < count; ++i) fn(i);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &fn;
+            jobSize = count;
+            nextIndex.store(0, std::memory_order_relaxed);
+            busyWorkers = static_cast<unsigned>(workers.size());
+            generation++;
+        }
+        wake.notify_all();
+        runIndices(fn, count);
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return busyWorkers == 0; });
+        job = nullptr;
+    }
+
+private:
+    void runIndices(const std::function<void(std::size_t)>& fn, std::size_t count) {
+        for (std::size_t i = nextIndex.fetch_add(1, std::memory_order_relaxed); i < count;
+             i = nextIndex.fetch_add(1, std::memory_order_relaxed))
+            fn(i);
+    }
+
+    void workerLoop() {
+        unsigned long seenGeneration = 0;
+        while (true) {
+            const std::function<void(std::size_t)>* fn;
+            std::size_t count;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seenGeneration; });
+                if (stopping) return;
+                seenGeneration = generation;
+                fn = job;
+                count = jobSize;
+            }
+            runIndices(*fn, count);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--busyWorkers == 0) done.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(std::size_t)>* job = nullptr;
+    std::size_t jobSize = 0;
+    std::atomic<std::size_t> nextIndex{0};
+    unsigned busyWorkers = 0;
+    unsigned long generation = 0;
+    bool stopping = false;
+};
@@ -0,0 +1,208 @@
+#pragma once
+
+#include "mcts.hpp"
+#include "solver.hpp"
+#include "../common/mailbox.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+// Background engine for the window: all searching happens on one service
+// thread (plus the solver's own helpers), so the render loop only ever
+// posts positions and polls results, and never waits.
+//
+//  - UI to service: the latest position goes through a Mailbox and an
+//    interrupt flag that aborts the running search within a few thousand
+//    nodes
+//  - on the human's turn the service ponders: it scores every column with
+//    deeper and deeper searches and streams each finished depth back
+//    through a second Mailbox, which the window draws as a heatmap
+//  - on the engine's turn it searches for a move and posts it to a third
+//    Mailbox. The transposition table survives between turns, so after
+//    the human plays the move the ponder rated best, an alpha-beta search
+//    starts from a warm table, and the time already spent pondering that
+//    line is taken off its budget. MCTS starts a fresh tree every move, so
+//    it always gets its full budget
+
+struct AnalysisRequest {
+    Position position;
+    std::uint32_t id = 0;
+    bool engineToMove = false;
+    bool ponder = false;  // analyse the human's turn
+};
+
+// Per-column scores of one position, from the player to move's side
+struct ColumnEvals {
+    std::uint32_t id = 0;  // request the scores belong to
+    int depth = 0;
+    int best = -1;
+    bool exact = false;    // every score is proven
+    int scores[COLS] = {};
+    long nodes = 0;
+    double seconds = 0;
+};
+
+struct EngineMove {
+    std::uint32_t id = 0;
+    int column = -1;
+    int depth = 0;         // alpha-beta only
+    bool exact = false;
+    bool ponderHit = false;
+    long work = 0;         // nodes, or playouts for MCTS
+    double seconds = 0;
+    MctsStats mctsStats;   // MCTS only
+};
+
+class AnalysisService {
+public:
+    // `mcts` (optional) makes the engine's moves; the solver always ponders
+    AnalysisService(Solver& solver_, MctsPlayer* mcts_, const SearchLimits& limits_)
+        : solver(solver_), mcts(mcts_), limits(limits_) {
+        solver.setAbortFlag(&interrupt);
+        if (mcts) mcts->setAbortFlag(&interrupt);
+        worker = std::thread([this] { run(); });
+    }
+
+    ~AnalysisService() {
+        quitting.store(true);
+        interrupt.store(true);
+        wake.notify_one();
+        worker.join();
+        solver.setAbortFlag(nullptr);
+        if (mcts) mcts->setAbortFlag(nullptr);
+    }
+
+    AnalysisService(const AnalysisService&) = delete;
+    AnalysisService& operator=(const AnalysisService&) = delete;
+
+    // UI thread: work on this position from now on; returns the id results
+    // for it will carry
+    std::uint32_t post(const Position& position, bool engineToMove, bool ponder) {
+        AnalysisRequest request;
+        request.position = position;
+        request.id = ++lastId;
+        request.engineToMove = engineToMove;
+        request.ponder = ponder;
+        requests.publish(request);
+        interrupt.store(true, std::memory_order_release);
+        // No lock here: a missed wake-up only costs one idle timeout
+        wake.notify_one();
+        return request.id;
+    }
+
+    // UI thread, every frame
+    bool pollEvals(ColumnEvals& evals) { return evalsBox.fetch(evals); }
+    bool pollMove(EngineMove& move) { return moves.fetch(move); }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    void run() {
+        AnalysisRequest request;
+        bool pending = false;
+        while (!quitting.load()) {
+            // The flag can go up after the request it announces was already
+            // taken, so an empty mailbox keeps the current request
+            if (interrupt.exchange(false, std::memory_order_acquire) && requests.fetch(request)) pending = true;
+            bool over = request.position.isFull() || request.position.lastMoveWon();
+            if (!pending || over || (!request.engineToMove && !request.ponder)) {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait_for(lock, std::chrono::milliseconds(20), [this] { return interrupt.load() || quitting.load(); });
+                continue;
+            }
+            if (request.engineToMove) think(request);
+            else ponder(request);
+            // Interrupted: pick up the new request, or redo this one
+            if (!interrupt.load()) pending = false;
+        }
+    }
+
+    // Deeper and deeper per-column scores until interrupted or all proven
+    void ponder(const AnalysisRequest& request) {
+        auto start = Clock::now();
+        long nodesBefore = solver.getNodes();
+        ponderRoot = request.position;
+        ponderBest = -1;
+        ponderSeconds = 0;
+        int remaining = CELLS - request.position.getMoves();
+        for (int depth = 1; depth <= remaining; ++depth) {
+            ColumnEvals evals;
+            if (!solver.scoreColumns(request.position, depth, evals.scores)) break;
+            evals.id = request.id;
+            evals.depth = depth;
+            evals.exact = true;
+            for (int col = 0; col < COLS; ++col) {
+                if (!request.position.canPlay(col)) continue;
+                if (evals.best < 0 || evals.scores[col] > evals.scores[evals.best]) evals.best = col;
+                if (!isProven(evals.scores[col])) evals.exact = false;
+            }
+            evals.nodes = solver.getNodes() - nodesBefore;
+            evals.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            evalsBox.publish(evals);
+            // Every reply was searched depth - 1 plies on from here
+            ponderBest = evals.best;
+            ponderSeconds = evals.seconds;
+            if (evals.exact) break;
+        }
+    }
+
+    void think(const AnalysisRequest& request) {
+        EngineMove move;
+        move.id = request.id;
+        move.ponderHit = ponderBest >= 0 && followsPonder(request.position);
+        ponderBest = -1;
+        int timeMs = limits.timeMs;
+        // The pondering already searched this position and the solver's table
+        // still holds it; the MCTS tree does not carry over, so it keeps its time
+        if (move.ponderHit && !mcts && timeMs > 0)
+            timeMs = std::max(timeMs / 10, timeMs - static_cast<int>(ponderSeconds * 1000));
+
+        if (mcts) {
+            MctsResult result = mcts->think(request.position, MctsLimits{timeMs > 0 ? timeMs : 1000, 0});
+            move.column = result.column;
+            move.work = result.stats.playouts;
+            move.seconds = result.stats.seconds;
+            move.mctsStats = result.stats;
+        } else {
+            SearchResult result = solver.search(request.position, SearchLimits{limits.maxDepth, timeMs});
+            move.column = result.column;
+            move.depth = result.depth;
+            move.exact = result.exact;
+            move.work = result.nodes;
+            move.seconds = result.seconds;
+        }
+        // A move for a position the UI has left behind is of no use
+        if (!interrupt.load()) moves.publish(move);
+    }
+
+    // Is `position` the pondered one after its best move?
+    bool followsPonder(const Position& position) const {
+        if (!ponderRoot.canPlay(ponderBest)) return false;
+        Position predicted = ponderRoot;
+        predicted.play(ponderBest);
+        return predicted.getMoves() == position.getMoves() && predicted.key() == position.key();
+    }
+
+    Solver& solver;
+    MctsPlayer* mcts;
+    SearchLimits limits;
+    std::uint32_t lastId = 0;  // UI thread only
+
+    Mailbox<AnalysisRequest> requests;
+    Mailbox<ColumnEvals> evalsBox;
+    Mailbox<EngineMove> moves;
+    std::atomic<bool> interrupt{false};
+    std::atomic<bool> quitting{false};
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::thread worker;
+
+    // Service thread only
+    Position ponderRoot;
+    int ponderBest = -1;
+    double ponderSeconds = 0;
+};
@@ -0,0 +1,293 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+// Window-free Connect-N board as two bitboards, so the game, the AIs and
+// the headless tools share the same rules. The size and the length of a
+// winning line are template parameters; Position is the classic 6 x 7,
+// four in a row.
+//
+// Each column takes ROWS + 1 bits, bottom cell first; the spare bit on top
+// keeps a full column from spilling into the next one, which is what makes
+// the shift tests below exact:
+//
+//   .  .  .  .  .  .  .
+//   5 12 19 26 33 40 47
+//   4 11 18 25 32 39 46
+//   3 10 17 24 31 38 45
+//   2  9 16 23 30 37 44
+//   1  8 15 22 29 36 43
+//   0  7 14 21 28 35 42
+//
+// `mask` has a bit for every token, `current` for the tokens of the player
+// to move. Playing a column adds its bottom bit to the mask, which carries
+// up to the first empty cell; a win is WIN set bits at a fixed stride.
+
+__extension__ typedef unsigned __int128 Uint128;
+
+// One 64-bit word when the board and its guard bits fit, 128 bits otherwise
+template <int Bits>
+using BoardWord = typename std::conditional<(Bits <= 64), std::uint64_t, Uint128>::type;
+
+inline int popcount(std::uint64_t bits) { return __builtin_popcountll(bits); }
+inline int popcount(Uint128 bits) {
+    return popcount(static_cast<std::uint64_t>(bits)) + popcount(static_cast<std::uint64_t>(bits >> 64));
+}
+
+// Index of the lowest set bit; `bits` must not be 0
+inline int lowestBit(std::uint64_t bits) { return __builtin_ctzll(bits); }
+inline int lowestBit(Uint128 bits) {
+    std::uint64_t low = static_cast<std::uint64_t>(bits);
+    return low ? __builtin_ctzll(low) : 64 + __builtin_ctzll(static_cast<std::uint64_t>(bits >> 64));
+}
+
+// Centre columns first: they take part in the most alignments
+template <int Cols>
+struct ColumnOrder {
+    int columns[Cols];
+    constexpr ColumnOrder() : columns() {
+        for (int i = 0; i < Cols; ++i) columns[i] = Cols / 2 + (1 - 2 * (i % 2)) * (i + 1) / 2;
+    }
+};
+
+// Masks and line tests for one board size. Every shift amount is a
+// template argument, so each test compiles to a fixed run of shifts and
+// ANDs, with no loop left at run time.
+template <int Rows, int Cols, int Win>
+struct BoardLayout {
+    static_assert(Win >= 2 && Win <= std::max(Rows, Cols), "a line must fit on the board");
+    static_assert((Rows + 1) * Cols <= 128, "the board and its guard bits must fit in 128 bits");
+
+    static constexpr int ROWS = Rows;
+    static constexpr int COLS = Cols;
+    static constexpr int WIN = Win;
+    static constexpr int CELLS = Rows * Cols;
+    static constexpr int COLUMN_BITS = Rows + 1;
+
+    typedef BoardWord<COLUMN_BITS * Cols> Bitboard;
+    static constexpr int WORD_BITS = sizeof(Bitboard) * 8;
+
+    static constexpr Bitboard bottomMask(int col) { return Bitboard(1) << (col * COLUMN_BITS); }
+    static constexpr Bitboard topMask(int col) { return Bitboard(1) << (Rows - 1 + col * COLUMN_BITS); }
+    static constexpr Bitboard columnMask(int col) { return ((Bitboard(1) << Rows) - 1) << (col * COLUMN_BITS); }
+    static constexpr Bitboard cellMask(int col, int row) { return Bitboard(1) << (row + col * COLUMN_BITS); } // row 0 = bottom
+
+    static constexpr Bitboard allBottoms() {
+        Bitboard bits = 0;
+        for (int col = 0; col < Cols; ++col) bits |= bottomMask(col);
+        return bits;
+    }
+
+    static constexpr Bitboard BOTTOM_ROW = allBottoms();
+    static constexpr Bitboard BOARD_MASK = BOTTOM_ROW * ((Bitboard(1) << Rows) - 1);
+
+    // Bit x of the result is bit x + Shift of `bits`
+    template <int Shift>
+    static constexpr Bitboard shifted(Bitboard bits) {
+        if constexpr (Shift >= WORD_BITS || -Shift >= WORD_BITS) return 0;
+        else if constexpr (Shift >= 0) return bits >> Shift;
+        else return bits << -Shift;
+    }
+
+    // Cells where a line of N stones at stride S starts; doubling the
+    // length at each step keeps it to about log2(N) steps
+    template <int S, int N>
+    static constexpr Bitboard runs(Bitboard stones) {
+        if constexpr (N == 1) return stones;
+        else if constexpr (N % 2 == 0) {
+            Bitboard half = runs<S, N / 2>(stones);
+            return half & shifted<S * (N / 2)>(half);
+        } else return runs<S, N - 1>(stones) & shifted<S * (N - 1)>(stones);
+    }
+
+    // True if `stones` holds WIN in a row in any direction
+    static constexpr bool hasAlignment(Bitboard stones) {
+        // Vertical, horizontal and diagonals are strides of 1, COLUMN_BITS and COLUMN_BITS +- 1
+        return (runs<1, Win>(stones) | runs<COLUMN_BITS, Win>(stones) | runs<COLUMN_BITS - 1, Win>(stones) |
+                runs<COLUMN_BITS + 1, Win>(stones)) != 0;
+    }
+
+    // Cells that would be the K-th of a line at stride S: stones at every
+    // other place j of the line, x + S * (j - K)
+    template <int S, int K, int... J>
+    static constexpr Bitboard lineThrough(Bitboard stones, std::integer_sequence<int, J...>) {
+        return (~Bitboard(0) & ... & (J == K ? ~Bitboard(0) : shifted<S * (J - K)>(stones)));
+    }
+
+    template <int S, int... K>
+    static constexpr Bitboard linesAlong(Bitboard stones, std::integer_sequence<int, K...>) {
+        return (Bitboard(0) | ... | lineThrough<S, K>(stones, std::make_integer_sequence<int, Win>()));
+    }
+
+    // The same for four in a row, sharing the pairs between the four cases
+    template <int S>
+    static constexpr Bitboard foursAlong(Bitboard stones) {
+        Bitboard above = shifted<-S>(stones) & shifted<-2 * S>(stones);
+        Bitboard below = shifted<S>(stones) & shifted<2 * S>(stones);
+        return (above & (shifted<-3 * S>(stones) | shifted<S>(stones))) |
+               (below & (shifted<-S>(stones) | shifted<3 * S>(stones)));
+    }
+
+    // Empty cells of `mask` that would complete a line for `stones`,
+    // playable now or not (J. Pons' threat mask)
+    static constexpr Bitboard winningCells(Bitboard stones, Bitboard mask) {
+        const auto line = std::make_integer_sequence<int, Win>();
+        // Vertical: the cell can only be on top
+        Bitboard r = lineThrough<1, Win - 1>(stones, line);
+        // Horizontal and both diagonals: the cell can be anywhere on the line
+        if constexpr (Win == 4)
+            r |= foursAlong<COLUMN_BITS>(stones) | foursAlong<COLUMN_BITS - 1>(stones) |
+                 foursAlong<COLUMN_BITS + 1>(stones);
+        else
+            r |= linesAlong<COLUMN_BITS>(stones, line) | linesAlong<COLUMN_BITS - 1>(stones, line) |
+                 linesAlong<COLUMN_BITS + 1>(stones, line);
+        return r & (BOARD_MASK ^ mask);
+    }
+
+    // The board seen in a mirror: column c becomes column COLS - 1 - c
+    static constexpr Bitboard mirror(Bitboard bits) {
+        return mirrorColumns(bits, std::make_integer_sequence<int, Cols>());
+    }
+
+    template <int... C>
+    static constexpr Bitboard mirrorColumns(Bitboard bits, std::integer_sequence<int, C...>) {
+        const Bitboard column = (Bitboard(1) << COLUMN_BITS) - 1;
+        return (Bitboard(0) | ... | (((bits >> (C * COLUMN_BITS)) & column) << ((Cols - 1 - C) * COLUMN_BITS)));
+    }
+};
+
+template <int Rows, int Cols, int Win = 4>
+class ConnectPosition {
+public:
+    typedef BoardLayout<Rows, Cols, Win> Layout;
+    typedef typename Layout::Bitboard Bitboard;
+    static constexpr int ROWS = Rows;
+    static constexpr int COLS = Cols;
+    static constexpr int WIN = Win;
+    static constexpr int CELLS = Layout::CELLS;
+
+    bool canPlay(int col) const { return (mask & Layout::topMask(col)) == 0; }
+
+    // The caller checks canPlay() first
+    void play(int col) {
+        current ^= mask;
+        mask |= mask + Layout::bottomMask(col);
+        moves++;
+    }
+
+    // Take back the last token of `col`
+    void undo(int col) {
+        Bitboard stack = mask & Layout::columnMask(col);
+        mask ^= (stack + Layout::bottomMask(col)) >> 1; // highest token of the column
+        current ^= mask;
+        moves--;
+    }
+
+    // Would playing `col` complete a line for the player to move?
+    bool isWinningMove(int col) const {
+        Bitboard after = current | ((mask + Layout::bottomMask(col)) & Layout::columnMask(col));
+        return Layout::hasAlignment(after);
+    }
+
+    // Cell each playable column would fill, as one bitboard
+    Bitboard possible() const { return (mask + Layout::BOTTOM_ROW) & Layout::BOARD_MASK; }
+    Bitboard winningPosition() const { return Layout::winningCells(current, mask); }
+    Bitboard opponentWinningPosition() const { return Layout::winningCells(current ^ mask, mask); }
+    bool canWinNext() const { return (winningPosition() & possible()) != 0; }
+
+    // Playable cells that do not hand the opponent an immediate win; empty
+    // when every move loses. Only meaningful when canWinNext() is false.
+    Bitboard possibleNonLosingMoves() const {
+        Bitboard playable = possible();
+        Bitboard threats = opponentWinningPosition();
+        Bitboard forced = playable & threats;
+        if (forced) {
+            if (forced & (forced - 1)) return 0; // two threats to block at once
+            playable = forced;
+        }
+        return playable & ~(threats >> 1); // never play right under an opponent threat
+    }
+
+    // Play a single-bit move taken from possible()
+    void playMove(Bitboard move) {
+        current ^= mask;
+        mask |= move;
+        moves++;
+    }
+
+    // Column of a single-bit move
+    static int columnOf(Bitboard move) { return lowestBit(move) / Layout::COLUMN_BITS; }
+
+    // Threats the player to move would have after `move`; used to order moves
+    int moveScore(Bitboard move) const { return popcount(Layout::winningCells(current | move, mask)); }
+
+    // Did the move just played win? (the player who made it is not to move)
+    bool lastMoveWon() const { return Layout::hasAlignment(current ^ mask); }
+
+    bool isFull() const { return moves == CELLS; }
+    int getMoves() const { return moves; }
+    Bitboard getMask() const { return mask; }
+    Bitboard getCurrent() const { return current; }
+
+    // 0 = empty, 1 = first player, 2 = second player; row 0 = bottom
+    int owner(int col, int row) const {
+        Bitboard bit = Layout::cellMask(col, row);
+        if (!(mask & bit)) return 0;
+        bool toMove = (current & bit) != 0;
+        int playerToMove = moves % 2 == 0 ? 1 : 2;
+        return toMove ? playerToMove : 3 - playerToMove;
+    }
+
+    // Unique for every position: the side to move is implied by the token count
+    Bitboard key() const { return current + mask; }
+
+    // Same key for a position and its mirror image, which have the same score.
+    // The carries of current + mask stay inside each column, so mirroring
+    // the key is the same as mirroring both words.
+    Bitboard canonicalKey() const { return std::min(key(), Layout::mirror(key())); }
+
+    // Play a sequence of 1-based column digits, e.g. "4453"; stops and
+    // returns false at the first illegal or winning move
+    bool playSequence(const std::string& sequence) {
+        for (char c : sequence) {
+            int col = c - '1';
+            if (col < 0 || col >= COLS || !canPlay(col) || isWinningMove(col)) return false;
+            play(col);
+        }
+        return true;
+    }
+
+    void reset() { *this = ConnectPosition(); }
+
+private:
+    Bitboard current = 0;
+    Bitboard mask = 0;
+    int moves = 0;
+};
+
+// The classic game, played by the window, the solver and the opening book
+typedef ConnectPosition<6, 7, 4> Position;
+typedef Position::Layout ClassicLayout;
+
+const int ROWS = Position::ROWS;
+const int COLS = Position::COLS;
+const int CELLS = Position::CELLS;
+const int COLUMN_BITS = ClassicLayout::COLUMN_BITS;
+
+typedef Position::Bitboard Bitboard;
+
+constexpr Bitboard bottomMask(int col) { return ClassicLayout::bottomMask(col); }
+constexpr Bitboard topMask(int col) { return ClassicLayout::topMask(col); }
+constexpr Bitboard columnMask(int col) { return ClassicLayout::columnMask(col); }
+constexpr Bitboard cellMask(int col, int row) { return ClassicLayout::cellMask(col, row); }
+
+const Bitboard BOTTOM_ROW = ClassicLayout::BOTTOM_ROW;
+const Bitboard BOARD_MASK = ClassicLayout::BOARD_MASK;
+
+inline bool hasAlignment(Bitboard stones) { return ClassicLayout::hasAlignment(stones); }
+inline Bitboard winningCells(Bitboard stones, Bitboard mask) { return ClassicLayout::winningCells(stones, mask); }
+inline Bitboard mirrorBoard(Bitboard bits) { return ClassicLayout::mirror(bits); }
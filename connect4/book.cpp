@@ -0,0 +1,145 @@
+// Opening book generator: solves every position up to a given ply and
+// writes their exact scores as a sorted book file (see book.hpp).
+//
+// Positions are solved deepest ply first. Each finished ply joins the book
+// the solver consults, so the plies above it only search one move down
+// before landing on known scores: nearly all the time goes into the
+// deepest ply. Every solve runs on all threads (Lazy SMP, see solver.hpp).
+
+#include "solver.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct BookOptions {
+    int ply = 8;
+    std::string root;               // only positions that start with these moves
+    std::string output = "connect4/book.bin";
+    int tableLog2 = 24;
+    unsigned threads = 0;
+};
+
+void printUsage() {
+    std::cout << "Usage: connect4_book [--ply N] [--root MOVES] [--out FILE] [--hash-log2 N] [--threads N]\n"
+              << "  Solves every position with up to N moves (default 8) and writes the\n"
+              << "  book to FILE (default connect4/book.bin). --root limits the book to the\n"
+              << "  positions that follow the given moves, e.g. --root 44 for a quick test\n";
+}
+
+bool parseOptions(int argc, char** argv, BookOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--ply" && hasValue) options.ply = std::atoi(argv[++i]);
+        else if (arg == "--root" && hasValue) options.root = argv[++i];
+        else if (arg == "--out" && hasValue) options.output = argv[++i];
+        else if (arg == "--hash-log2" && hasValue) options.tableLog2 = std::atoi(argv[++i]);
+        else if (arg == "--threads" && hasValue) options.threads = static_cast<unsigned>(std::atoi(argv[++i]));
+        else return false;
+    }
+    return options.ply >= 0 && options.ply < CELLS - 2 && options.tableLog2 >= 10 && options.tableLog2 <= 32 &&
+           options.threads <= 256;
+}
+
+// One position per mirror pair, by ply
+class PositionSet {
+public:
+    explicit PositionSet(int maxPly) : byPly(maxPly + 1) {}
+
+    // Every position reachable from `root` without a win, up to the last ply
+    void collect(const Position& root) {
+        int last = static_cast<int>(byPly.size()) - 1;
+        std::vector<Position> frontier(1, root);
+        for (int ply = root.getMoves(); ply <= last && !frontier.empty(); ++ply) {
+            std::vector<Position> next;
+            std::vector<std::uint64_t> keys;
+            for (const Position& position : frontier) {
+                if (!position.canWinNext()) byPly[ply].push_back(position);
+                if (ply == last) continue;
+                for (int col = 0; col < COLS; ++col) {
+                    if (!position.canPlay(col) || position.isWinningMove(col)) continue;
+                    Position child = position;
+                    child.play(col);
+                    next.push_back(child);
+                    keys.push_back(child.canonicalKey());
+                }
+            }
+            frontier = unique(next, keys);
+        }
+    }
+
+    const std::vector<Position>& at(int ply) const { return byPly[ply]; }
+
+private:
+    // Drop mirror images and transpositions, keeping one of each key
+    static std::vector<Position> unique(const std::vector<Position>& positions, const std::vector<std::uint64_t>& keys) {
+        std::vector<std::size_t> order(positions.size());
+        for (std::size_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return keys[a] < keys[b]; });
+        std::vector<Position> kept;
+        for (std::size_t i = 0; i < order.size(); ++i)
+            if (i == 0 || keys[order[i]] != keys[order[i - 1]]) kept.push_back(positions[order[i]]);
+        return kept;
+    }
+
+    std::vector<std::vector<Position>> byPly;
+};
+
+int main(int argc, char** argv) {
+    BookOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+    Position root;
+    if (!root.playSequence(options.root) || root.getMoves() > options.ply) {
+        std::cerr << "invalid root: " << options.root << "\n";
+        return 1;
+    }
+
+    PositionSet positions(options.ply);
+    positions.collect(root);
+
+    Solver solver(options.tableLog2, options.threads);
+    OpeningBook partial;
+    solver.setBook(&partial);
+    std::printf("table: %zu MB, %u threads\n", solver.getTable().bytes() >> 20, solver.getThreadCount());
+
+    std::vector<std::uint64_t> entries;
+    auto start = std::chrono::steady_clock::now();
+    for (int ply = options.ply; ply >= root.getMoves(); --ply) {
+        const std::vector<Position>& level = positions.at(ply);
+        auto levelStart = std::chrono::steady_clock::now();
+        long nodesBefore = solver.getNodes();
+        for (std::size_t i = 0; i < level.size(); ++i) {
+            entries.push_back(packBookEntry(level[i].canonicalKey(), solver.solve(level[i])));
+            if (level.size() >= 1000 && (i + 1) % (level.size() / 20) == 0) {
+                std::fprintf(stderr, "\rply %d: %zu / %zu", ply, i + 1, level.size());
+                std::fflush(stderr);
+            }
+        }
+        if (level.size() >= 1000) std::fprintf(stderr, "\n");
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - levelStart).count();
+        std::printf("ply %2d: %8zu positions  %9.1f s  %9.1f positions/s  %.1f Mnodes\n", ply, level.size(), seconds,
+                    seconds > 0 ? level.size() / seconds : 0.0, (solver.getNodes() - nodesBefore) / 1e6);
+        std::fflush(stdout);
+
+        // The next ply up searches into this one
+        std::sort(entries.begin(), entries.end());
+        partial.assign(entries, options.ply);
+    }
+    solver.setBook(nullptr);
+
+    if (!OpeningBook::write(options.output, entries, options.ply)) {
+        std::cerr << "cannot write " << options.output << "\n";
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%zu positions in %.1f s, %zu bytes written to %s\n", entries.size(), seconds,
+                sizeof(BookHeader) + entries.size() * 8, options.output.c_str());
+    return 0;
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "bitboard.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Opening book: exact scores of every position up to some ply, written by
+// connect4_book and memory-mapped by the game and the solver, so opening
+// moves cost a lookup instead of a search.
+//
+// File layout, native endianness:
+//   BookHeader (16 bytes)
+//   count x uint64 entries, sorted: canonicalKey << 8 | uint8(score)
+// A position and its mirror image share one entry. Positions where the
+// player to move wins at once are left out, the search sees those anyway.
+
+const char BOOK_MAGIC[4] = {'C', '4', 'B', 'K'};
+const std::uint8_t BOOK_VERSION = 1;
+
+struct BookHeader {
+    char magic[4];
+    std::uint8_t version;
+    std::uint8_t rows;
+    std::uint8_t cols;
+    std::uint8_t maxPly;  // deepest position stored, in moves played
+    std::uint64_t count;
+};
+
+static_assert(sizeof(BookHeader) == 16, "the entries that follow must stay 8-byte aligned");
+
+inline std::uint64_t packBookEntry(std::uint64_t canonicalKey, int score) {
+    return canonicalKey << 8 | static_cast<std::uint8_t>(static_cast<std::int8_t>(score));
+}
+
+class OpeningBook {
+public:
+    OpeningBook() = default;
+    OpeningBook(const OpeningBook&) = delete;
+    OpeningBook& operator=(const OpeningBook&) = delete;
+    ~OpeningBook() { close(); }
+
+    // Map a book file; false (and an empty book) if it is missing or not a
+    // book for this board
+    bool open(const std::string& path) {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        void* data = MAP_FAILED;
+        if (fstat(fd, &info) == 0 && static_cast<std::size_t>(info.st_size) >= sizeof(BookHeader))
+            data = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) return false;
+        mapping = data;
+        mappedBytes = static_cast<std::size_t>(info.st_size);
+
+        BookHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, BOOK_MAGIC, 4) != 0 || header.version != BOOK_VERSION || header.rows != ROWS ||
+            header.cols != COLS || header.count != (mappedBytes - sizeof(header)) / 8) {
+            close();
+            return false;
+        }
+        entries = reinterpret_cast<const std::uint64_t*>(static_cast<const char*>(data) + sizeof(header));
+        count = header.count;
+        maxPly = header.maxPly;
+        // Lookups jump around the whole file
+        madvise(mapping, mappedBytes, MADV_RANDOM);
+        return true;
+    }
+
+    // Use sorted entries held in memory, for a book still being built
+    void assign(std::vector<std::uint64_t> sorted, int maxPly_) {
+        close();
+        owned = std::move(sorted);
+        entries = owned.data();
+        count = owned.size();
+        maxPly = maxPly_;
+    }
+
+    void close() {
+        if (mapping) munmap(mapping, mappedBytes);
+        mapping = nullptr;
+        mappedBytes = 0;
+        owned.clear();
+        entries = nullptr;
+        count = 0;
+        maxPly = -1;
+    }
+
+    // Exact score of `position` if the book has it
+    bool lookup(const Position& position, int& score) const {
+        if (position.getMoves() > maxPly || count == 0) return false;
+        std::uint64_t key = position.canonicalKey();
+        std::size_t index = find(key);
+        if (index == count) return false;
+        score = static_cast<std::int8_t>(entries[index] & 0xFF);
+        return true;
+    }
+
+    std::size_t size() const { return count; }
+    int getMaxPly() const { return maxPly; }
+
+    // Write sorted entries as a book file, through a temporary file so a
+    // crash never leaves half a book behind
+    static bool write(const std::string& path, const std::vector<std::uint64_t>& sorted, int maxPly) {
+        BookHeader header;
+        std::memcpy(header.magic, BOOK_MAGIC, 4);
+        header.version = BOOK_VERSION;
+        header.rows = ROWS;
+        header.cols = COLS;
+        header.maxPly = static_cast<std::uint8_t>(maxPly);
+        header.count = sorted.size();
+        std::string temp = path + ".tmp";
+        std::FILE* file = std::fopen(temp.c_str(), "wb");
+        if (!file) return false;
+        bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+                  std::fwrite(sorted.data(), 8, sorted.size(), file) == sorted.size();
+        ok = std::fclose(file) == 0 && ok;
+        return ok && std::rename(temp.c_str(), path.c_str()) == 0;
+    }
+
+private:
+    static std::uint64_t keyOf(std::uint64_t entry) { return entry >> 8; }
+
+    // Interpolation search: keys are spread fairly evenly, so guessing the
+    // index from the key value lands close in a few probes. Falls back to
+    // binary search when the guesses stop shrinking the range quickly.
+    std::size_t find(std::uint64_t key) const {
+        std::size_t lo = 0, hi = count - 1;
+        for (int probe = 0; probe < 8; ++probe) {
+            std::uint64_t low = keyOf(entries[lo]), high = keyOf(entries[hi]);
+            if (key < low || key > high) return count;
+            if (low == high) return low == key ? lo : count;
+            std::size_t guess = lo + static_cast<std::size_t>(static_cast<double>(key - low) / (high - low) * (hi - lo));
+            guess = std::min(guess, hi);
+            std::uint64_t found = keyOf(entries[guess]);
+            if (found == key) return guess;
+            if (found < key) lo = guess + 1;
+            else if (guess == 0) return count;
+            else hi = guess - 1;
+            if (lo > hi) return count;
+        }
+        const std::uint64_t* first = entries + lo;
+        const std::uint64_t* last = entries + hi + 1;
+        const std::uint64_t* it = std::lower_bound(first, last, key << 8);
+        return it != last && keyOf(*it) == key ? static_cast<std::size_t>(it - entries) : count;
+    }
+
+    void* mapping = nullptr;
+    std::size_t mappedBytes = 0;
+    std::vector<std::uint64_t> owned;
+    const std::uint64_t* entries = nullptr;
+    std::size_t count = 0;
+    int maxPly = -1;
+};
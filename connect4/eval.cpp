@@ -0,0 +1,355 @@
+// Batch evaluator: scores every position of a (possibly huge) file of move
+// strings with a depth-limited search, for labelling datasets.
+//
+//  - the input is memory-mapped and cut into chunks of about --chunk-kb at
+//    line ends; threads take chunks from a shared counter
+//  - each thread has its own single-threaded Solver and table, so threads
+//    share nothing while they search and the rate grows with the cores.
+//    The table is cleared before every position: a score never depends on
+//    which positions the thread happened to search before, so the output
+//    is the same for any thread count and across resumes
+//  - finished chunks go through a reorder buffer that writes them in input
+//    order. Threads may run at most a few chunks ahead of the writer, which
+//    bounds the memory held by chunks waiting for an earlier one
+//  - after each write a checkpoint (OUTPUT.progress) records how many
+//    chunks and output bytes are complete; --resume truncates the output to
+//    that point and carries on from the next chunk
+
+#include "solver.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct EvalOptions {
+    int depth = 8;
+    long chunkKb = 256;
+    int tableLog2 = 14;   // per thread; small, since it is cleared for every position
+    unsigned threads = 0; // 0 = one per hardware thread
+    bool resume = false;
+    std::string bookPath;
+    std::string input, output;
+};
+
+void printUsage() {
+    std::cout << "Usage: connect4_eval [--depth D] [--threads N] [--chunk-kb K] [--hash-log2 N]\n"
+              << "                     [--book FILE] [--resume] INPUT OUTPUT\n"
+              << "  Reads one position per line (column digits 1-7, e.g. 4453; anything after\n"
+              << "  the first space is ignored) and writes \"MOVES SCORE BEST\" lines in the\n"
+              << "  same order: the score for the player to move after a D-ply search\n"
+              << "  (default 8), an integer when proven as in connect4_solve, otherwise a\n"
+              << "  heuristic between -1 and 1, and the best column. --resume continues an\n"
+              << "  interrupted run from its last completed chunk\n";
+}
+
+bool parseOptions(int argc, char** argv, EvalOptions& options) {
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--depth" && hasValue) options.depth = std::atoi(argv[++i]);
+        else if (arg == "--threads" && hasValue) options.threads = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if (arg == "--chunk-kb" && hasValue) options.chunkKb = std::atol(argv[++i]);
+        else if (arg == "--hash-log2" && hasValue) options.tableLog2 = std::atoi(argv[++i]);
+        else if (arg == "--book" && hasValue) options.bookPath = argv[++i];
+        else if (arg == "--resume") options.resume = true;
+        else if (!arg.empty() && arg[0] != '-') files.push_back(arg);
+        else return false;
+    }
+    if (files.size() != 2) return false;
+    options.input = files[0];
+    options.output = files[1];
+    return options.depth >= 1 && options.depth <= CELLS && options.chunkKb >= 1 && options.tableLog2 >= 10 &&
+           options.tableLog2 <= 28 && options.threads <= 256;
+}
+
+// Read-only view of a whole file
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() {
+        if (data) munmap(const_cast<char*>(data), length);
+    }
+
+    bool open(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        bool ok = fstat(fd, &info) == 0;
+        length = ok ? static_cast<std::size_t>(info.st_size) : 0;
+        if (ok && length > 0) {
+            void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            ok = mapping != MAP_FAILED;
+            if (ok) {
+                data = static_cast<const char*>(mapping);
+                // Read front to back, each page once
+                madvise(mapping, length, MADV_SEQUENTIAL);
+            }
+        }
+        ::close(fd);
+        return ok;
+    }
+
+    const char* begin() const { return data; }
+    std::size_t size() const { return length; }
+
+private:
+    const char* data = nullptr;
+    std::size_t length = 0;
+};
+
+// Chunk boundaries: about chunkBytes each, always ending after a newline
+// (or at the end of the file). Fixed for a given file and chunk size, so a
+// resumed run cuts the same chunks.
+std::vector<std::size_t> splitChunks(const MappedFile& file, std::size_t chunkBytes) {
+    std::vector<std::size_t> starts(1, 0);
+    std::size_t position = 0;
+    while (position < file.size()) {
+        std::size_t end = std::min(position + chunkBytes, file.size());
+        if (end < file.size()) {
+            const void* newline = std::memchr(file.begin() + end - 1, '\n', file.size() - (end - 1));
+            end = newline ? static_cast<const char*>(newline) - file.begin() + 1 : file.size();
+        }
+        starts.push_back(end);
+        position = end;
+    }
+    return starts; // chunk i is [starts[i], starts[i + 1])
+}
+
+// What a resumed run must agree on, and how far the last one got
+struct Checkpoint {
+    std::size_t inputBytes = 0;
+    std::size_t chunkBytes = 0;
+    int depth = 0;
+    std::size_t chunks = 0;      // completed, from the start
+    std::size_t outputBytes = 0; // written for those chunks
+    long positions = 0;
+
+    bool load(const std::string& path) {
+        std::ifstream in(path);
+        std::string magic;
+        return static_cast<bool>(in >> magic >> inputBytes >> chunkBytes >> depth >> chunks >> outputBytes >> positions) &&
+               magic == "connect4_eval/1";
+    }
+
+    // Through a temporary file, so a kill mid-write leaves the old checkpoint
+    bool save(const std::string& path) const {
+        std::string temp = path + ".tmp";
+        std::FILE* file = std::fopen(temp.c_str(), "w");
+        if (!file) return false;
+        bool ok = std::fprintf(file, "connect4_eval/1 %zu %zu %d %zu %zu %ld\n", inputBytes, chunkBytes, depth, chunks,
+                               outputBytes, positions) > 0;
+        ok = std::fclose(file) == 0 && ok;
+        return ok && std::rename(temp.c_str(), path.c_str()) == 0;
+    }
+};
+
+// Writes finished chunks in input order and keeps the checkpoint in step
+class ReorderBuffer {
+public:
+    ReorderBuffer(std::FILE* output_, const std::string& checkpointPath_, const Checkpoint& start, std::size_t window_)
+        : output(output_), checkpointPath(checkpointPath_), state(start), window(window_) {}
+
+    // Blocks while `chunk` is too far ahead of the writer
+    void waitForTurn(std::size_t chunk) {
+        std::unique_lock<std::mutex> lock(mutex);
+        moved.wait(lock, [&] { return chunk < state.chunks + window || failed; });
+    }
+
+    // Hands over a finished chunk; whoever completes the next chunk in
+    // order writes it, and every chunk after it that is already waiting
+    void complete(std::size_t chunk, std::string text, long positions) {
+        std::lock_guard<std::mutex> lock(mutex);
+        waiting[chunk] = Pending{std::move(text), positions};
+        bool wrote = false;
+        for (auto it = waiting.find(state.chunks); it != waiting.end() && !failed; it = waiting.find(state.chunks)) {
+            const std::string& ready = it->second.text;
+            if (std::fwrite(ready.data(), 1, ready.size(), output) != ready.size()) failed = true;
+            state.outputBytes += ready.size();
+            state.positions += it->second.positions;
+            state.chunks++;
+            waiting.erase(it);
+            wrote = true;
+        }
+        // The output must reach the file before the checkpoint claims it
+        if (wrote && (std::fflush(output) != 0 || !state.save(checkpointPath))) failed = true;
+        moved.notify_all();
+    }
+
+    Checkpoint progress() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return state;
+    }
+
+    bool hasFailed() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return failed;
+    }
+
+private:
+    struct Pending {
+        std::string text;
+        long positions;
+    };
+
+    std::FILE* output;
+    std::string checkpointPath;
+    Checkpoint state;
+    std::size_t window;
+    std::map<std::size_t, Pending> waiting;
+    bool failed = false;
+    std::mutex mutex;
+    std::condition_variable moved;
+};
+
+// Score as in connect4_solve when proven, otherwise the heuristic in [-1, 1]
+void appendScore(std::string& out, int score) {
+    char text[32];
+    if (isProven(score)) std::snprintf(text, sizeof(text), "%d", score / SCORE_SCALE);
+    else std::snprintf(text, sizeof(text), "%.3f", static_cast<double>(score) / SCORE_SCALE);
+    out += text;
+}
+
+// One output line per input line
+long evaluateChunk(Solver& solver, const char* begin, const char* end, int depth, std::string& out) {
+    long positions = 0;
+    for (const char* line = begin; line < end;) {
+        const char* newline = static_cast<const char*>(std::memchr(line, '\n', end - line));
+        const char* lineEnd = newline ? newline : end;
+        const char* movesEnd = line;
+        while (movesEnd < lineEnd && *movesEnd != ' ' && *movesEnd != '\t' && *movesEnd != '\r') ++movesEnd;
+        std::string moves(line, movesEnd);
+        line = newline ? newline + 1 : end;
+
+        out += moves;
+        Position position;
+        // A blank line is not the empty board, just a stray line
+        if (moves.empty() || !position.playSequence(moves)) {
+            out += " invalid\n";
+            continue;
+        }
+        solver.clear();
+        SearchResult result = solver.search(position, SearchLimits{depth, 0});
+        out += ' ';
+        appendScore(out, result.score);
+        out += ' ';
+        out += result.column >= 0 ? static_cast<char>('1' + result.column) : '-';
+        out += '\n';
+        positions++;
+    }
+    return positions;
+}
+
+int main(int argc, char** argv) {
+    EvalOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+    MappedFile input;
+    if (!input.open(options.input)) {
+        std::cerr << "cannot read " << options.input << "\n";
+        return 1;
+    }
+    OpeningBook book;
+    if (!options.bookPath.empty() && !book.open(options.bookPath)) {
+        std::cerr << "cannot open book " << options.bookPath << "\n";
+        return 1;
+    }
+
+    Checkpoint start;
+    start.inputBytes = input.size();
+    start.chunkBytes = static_cast<std::size_t>(options.chunkKb) << 10;
+    start.depth = options.depth;
+    std::string checkpointPath = options.output + ".progress";
+    Checkpoint saved;
+    if (options.resume && !saved.load(checkpointPath)) {
+        std::printf("no checkpoint %s, starting from the beginning\n", checkpointPath.c_str());
+    } else if (options.resume) {
+        if (saved.inputBytes != start.inputBytes || saved.chunkBytes != start.chunkBytes || saved.depth != start.depth) {
+            std::cerr << "the checkpoint was made with another input, --chunk-kb or --depth\n";
+            return 1;
+        }
+        // Anything past the checkpoint belongs to chunks that may be incomplete
+        if (truncate(options.output.c_str(), static_cast<off_t>(saved.outputBytes)) != 0) {
+            std::cerr << "cannot resume " << options.output << "\n";
+            return 1;
+        }
+        start = saved;
+        std::printf("resuming after chunk %zu (%ld positions)\n", start.chunks, start.positions);
+    }
+    std::FILE* output = std::fopen(options.output.c_str(), start.chunks > 0 ? "ab" : "wb");
+    if (!output) {
+        std::cerr << "cannot write " << options.output << "\n";
+        return 1;
+    }
+
+    std::vector<std::size_t> bounds = splitChunks(input, start.chunkBytes);
+    std::size_t chunkCount = bounds.size() - 1;
+    ThreadPool pool(options.threads);
+    ReorderBuffer buffer(output, checkpointPath, start, 4 * pool.size());
+    std::atomic<std::size_t> nextChunk{start.chunks};
+    std::atomic<long> nodes{0};
+    std::printf("%zu chunks, depth %d, %u threads\n", chunkCount, options.depth, pool.size());
+    std::fflush(stdout);
+
+    typedef std::chrono::steady_clock Clock;
+    auto startTime = Clock::now();
+    std::atomic<Clock::rep> lastReport{startTime.time_since_epoch().count()};
+    pool.parallelFor(pool.size(), [&](std::size_t) {
+        Solver solver(options.tableLog2, 1);
+        if (book.size()) solver.setBook(&book);
+        std::string text;
+        for (std::size_t chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++) {
+            buffer.waitForTurn(chunk);
+            if (buffer.hasFailed()) break;
+            text.clear();
+            long nodesBefore = solver.getNodes();
+            long positions = evaluateChunk(solver, input.begin() + bounds[chunk], input.begin() + bounds[chunk + 1],
+                                           options.depth, text);
+            nodes += solver.getNodes() - nodesBefore;
+            buffer.complete(chunk, std::move(text), positions);
+
+            // About once a second, whichever thread gets here first
+            Clock::rep last = lastReport.load();
+            Clock::time_point now = Clock::now();
+            if (now - Clock::time_point(Clock::duration(last)) >= std::chrono::seconds(1) &&
+                lastReport.compare_exchange_strong(last, now.time_since_epoch().count())) {
+                Checkpoint done = buffer.progress();
+                double seconds = std::chrono::duration<double>(now - startTime).count();
+                std::fprintf(stderr, "\rchunk %zu / %zu  %ld positions  %.0f positions/s", done.chunks, chunkCount,
+                             done.positions, (done.positions - start.positions) / seconds);
+            }
+        }
+    });
+    std::fprintf(stderr, "\n");
+    bool ok = std::fclose(output) == 0 && !buffer.hasFailed();
+    if (!ok) {
+        std::cerr << "writing " << options.output << " failed; rerun with --resume\n";
+        return 1;
+    }
+    std::remove(checkpointPath.c_str()); // finished: nothing to resume
+
+    Checkpoint done = buffer.progress();
+    long evaluated = done.positions - start.positions;
+    double seconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+    std::printf("%ld positions in %.2f s: %.0f positions/s, %.1f Mnodes, %zu bytes written to %s\n", evaluated, seconds,
+                seconds > 0 ? evaluated / seconds : 0.0, nodes / 1e6, done.outputBytes, options.output.c_str());
+    return 0;
+}
@@ -1,91 +1,73 @@
 #include <SFML/Graphics.hpp>
+#include <algorithm>
 #include <iostream>
 #include <vector>
 #include <string>
+#include <cstdlib>
+#include <memory>
+#include <cstdio>
+#include "analysis.hpp"
 
-const int ROWS = 6;
-const int COLS = 7;
 const int CELL_SIZE = 100;
 const std::string FONT_PATH = "extern/fonts/PixelatedElegance.ttf";
-
-enum class Player
+const std::string BOOK_PATH = "connect4/book.bin";
+
+Position board;
+
+// Computer opponent: 0 = hot-seat, 1 or 2 = the player it controls
+int aiPlayer = 0;
+SearchLimits aiLimits = {0, 1000};
+Solver solver(20);
+OpeningBook book;
+std::unique_ptr<MctsPlayer> mcts; // --mcts: Monte Carlo tree search instead of alpha-beta
+
+// Searching runs in the background (analysis.hpp); the loop below only
+// posts the board when it changes and picks up what comes back
+std::unique_ptr<AnalysisService> analysis;
+std::uint32_t analysisId = 0; // request for the board on screen
+Bitboard postedKey = 0;
+int postedMoves = -1;
+bool postedHints = false;
+
+// H toggles the per-column evaluations of the pondering as a heatmap
+bool showHints = false;
+ColumnEvals evals;
+
+bool aiToMove()
 {
-    None,
-    Player1,
-    Player2
-};
-
-std::vector<std::vector<Player>> grid(ROWS, std::vector<Player>(COLS, Player::None));
-Player currentPlayer = Player::Player1;
-
-void dropToken(int col)
-{
-    for (int row = ROWS - 1; row >= 0; --row)
-    {
-        if (grid[row][col] == Player::None)
-        {
-            grid[row][col] = currentPlayer;
-            currentPlayer = (currentPlayer == Player::Player1) ? Player::Player2 : Player::Player1;
-            break;
-        }
-    }
+    return aiPlayer != 0 && board.getMoves() % 2 + 1 == aiPlayer && !board.isFull();
 }
 
-bool checkWin(Player player)
+// Plays `col` for the player to move; false if the column is full.
+// `won` tells whether the move connected four.
+bool dropToken(int col, bool &won)
 {
-    // Check rows
-    for (int row = 0; row < ROWS; ++row)
-    {
-        for (int col = 0; col <= COLS - 4; ++col)
-        {
-            if (grid[row][col] == player && grid[row][col + 1] == player &&
-                grid[row][col + 2] == player && grid[row][col + 3] == player)
-            {
-                return true;
-            }
-        }
-    }
+    if (!board.canPlay(col))
+        return false;
+    won = board.isWinningMove(col);
+    board.play(col);
+    return true;
+}
 
-    // Check columns
-    for (int col = 0; col < COLS; ++col)
-    {
-        for (int row = 0; row <= ROWS - 4; ++row)
-        {
-            if (grid[row][col] == player && grid[row + 1][col] == player &&
-                grid[row + 2][col] == player && grid[row + 3][col] == player)
-            {
-                return true;
-            }
-        }
-    }
+void showEndGamePopup(sf::RenderWindow &window, const std::string &message, sf::Font &font);
 
-    // Check diagonals (top-left to bottom-right)
-    for (int row = 0; row <= ROWS - 4; ++row)
+// Plays `col` and shows the end-game popup if the game is over; false if
+// the column is full
+bool playMove(int col, sf::RenderWindow &window, sf::Font &font)
+{
+    bool won = false;
+    if (!dropToken(col, won))
+        return false;
+    // The player who just moved is the one not to move now
+    if (won)
     {
-        for (int col = 0; col <= COLS - 4; ++col)
-        {
-            if (grid[row][col] == player && grid[row + 1][col + 1] == player &&
-                grid[row + 2][col + 2] == player && grid[row + 3][col + 3] == player)
-            {
-                return true;
-            }
-        }
+        showEndGamePopup(window, board.getMoves() % 2 == 1 ? "Player 1 won!!" : "Player 2 won!!", font);
     }
-
-    // Check diagonals (bottom-left to top-right)
-    for (int row = 3; row < ROWS; ++row)
+    else if (board.isFull())
     {
-        for (int col = 0; col <= COLS - 4; ++col)
-        {
-            if (grid[row][col] == player && grid[row - 1][col + 1] == player &&
-                grid[row - 2][col + 2] == player && grid[row - 3][col + 3] == player)
-            {
-                return true;
-            }
-        }
+        showEndGamePopup(window, "Draw!", font);
     }
-
-    return false;
+    return true;
 }
 
 void drawGrid(sf::RenderWindow &window)
@@ -113,27 +95,116 @@ void drawTokens(sf::RenderWindow &window)
     {
         for (int col = 0; col < COLS; ++col)
         {
-            if (grid[row][col] != Player::None)
+            int owner = board.owner(col, ROWS - 1 - row);
+            if (owner != 0)
             {
                 sf::CircleShape token(CELL_SIZE / 2 - 10);
                 token.setPosition(col * CELL_SIZE + 10, row * CELL_SIZE + 10);
-                token.setFillColor(grid[row][col] == Player::Player1 ? sf::Color::Red : sf::Color::Yellow);
+                token.setFillColor(owner == 1 ? sf::Color::Red : sf::Color::Yellow);
                 window.draw(token);
             }
         }
     }
 }
 
+// Posts the board to the analysis service whenever it changed: the engine
+// thinks on its own turn and ponders on the human's
+void syncAnalysis()
+{
+    if (board.key() == postedKey && board.getMoves() == postedMoves && showHints == postedHints)
+        return;
+    postedKey = board.key();
+    postedMoves = board.getMoves();
+    postedHints = showHints;
+    bool engine = aiToMove();
+    analysisId = analysis->post(board, engine, !engine && (showHints || aiPlayer != 0));
+}
+
+// Green for a win, red for a loss, grey for a draw; heuristic scores in between
+sf::Color evalColor(int score)
+{
+    if (score == 0)
+        return sf::Color(128, 128, 128, 110);
+    if (isProven(score))
+        return score > 0 ? sf::Color(0, 200, 0, 130) : sf::Color(220, 0, 0, 130);
+    float t = (score + SCORE_SCALE) / (2.0f * SCORE_SCALE);
+    return sf::Color(static_cast<sf::Uint8>(220 * (1 - t)), static_cast<sf::Uint8>(200 * t), 0, 90);
+}
+
+std::string evalLabel(int score)
+{
+    if (score == 0)
+        return "draw";
+    if (isProven(score))
+        return score > 0 ? "win" : "loss";
+    char text[16];
+    std::snprintf(text, sizeof(text), "%+.2f", static_cast<double>(score) / SCORE_SCALE);
+    return text;
+}
+
+void drawHeatmap(sf::RenderWindow &window, sf::Font &font)
+{
+    if (!showHints || evals.id != analysisId || evals.depth == 0)
+        return;
+    for (int col = 0; col < COLS; ++col)
+    {
+        if (!board.canPlay(col))
+            continue;
+        sf::RectangleShape shade(sf::Vector2f(CELL_SIZE, ROWS * CELL_SIZE));
+        shade.setPosition(col * CELL_SIZE, 0);
+        shade.setFillColor(evalColor(evals.scores[col]));
+        window.draw(shade);
+
+        sf::Text label;
+        label.setFont(font);
+        label.setString(evalLabel(evals.scores[col]));
+        label.setCharacterSize(20);
+        label.setFillColor(col == evals.best ? sf::Color::White : sf::Color(200, 200, 200));
+        label.setPosition(col * CELL_SIZE + 10, 5);
+        window.draw(label);
+    }
+
+    sf::Text depth;
+    depth.setFont(font);
+    depth.setString(evals.exact ? "solved" : "depth " + std::to_string(evals.depth));
+    depth.setCharacterSize(16);
+    depth.setFillColor(sf::Color::White);
+    depth.setPosition(5, ROWS * CELL_SIZE - 25);
+    window.draw(depth);
+}
+
+// Live progress of the Monte Carlo player while it thinks; getStats() may be
+// called while the search runs
+void drawEngineStats(sf::RenderWindow &window, sf::Font &font)
+{
+    if (!mcts || !aiToMove())
+        return;
+    MctsStats stats = mcts->getStats();
+    char line[96];
+    std::snprintf(line, sizeof(line), "MCTS %.1f s  %.0fk playouts/s  tree %.1f / %zu MB", stats.seconds,
+                  stats.playoutsPerSecond() / 1000, stats.bytes / 1048576.0, stats.maxBytes >> 20);
+    sf::Text text;
+    text.setFont(font);
+    text.setString(line);
+    text.setCharacterSize(16);
+    text.setFillColor(sf::Color::White);
+    text.setPosition(5, ROWS * CELL_SIZE - 25);
+    window.draw(text);
+}
+
 void resetGame()
 {
-    grid = std::vector<std::vector<Player>>(ROWS, std::vector<Player>(COLS, Player::None));
-    currentPlayer = Player::Player1;
+    board.reset();
 }
 
 // Removed UTF-8 conversion and replaced the message with English text
 
 void showEndGamePopup(sf::RenderWindow &window, const std::string &message, sf::Font &font)
 {
+    // The popup loop below does not sync: hand over the final board now, so
+    // the service stops searching the position before the last move
+    syncAnalysis();
+
     sf::RectangleShape popup(sf::Vector2f(400, 200));
     popup.setFillColor(sf::Color(50, 50, 50));
     popup.setOutlineColor(sf::Color::White);
@@ -201,10 +272,74 @@ void showEndGamePopup(sf::RenderWindow &window, const std::string &message, sf::
     }
 }
 
-int main()
+void printUsage()
 {
+    std::cout << "Usage: connect4 [--ai] [--ai-first] [--ai-ms T] [--ai-depth D] [--book FILE]\n"
+              << "                [--mcts] [--mcts-mb M]\n"
+              << "  --ai plays yellow against the computer, --ai-first lets it play red.\n"
+              << "  The computer thinks for T milliseconds (default 1000) or D plies, and\n"
+              << "  plays the opening from FILE (default " << BOOK_PATH << ") when it exists.\n"
+              << "  --mcts uses Monte Carlo tree search instead, with a tree of at most M MB\n"
+              << "  Keys: R restarts, H shows the computer's evaluation of every column\n";
+}
+
+int main(int argc, char **argv)
+{
+    bool timeGiven = false;
+    std::string bookPath = BOOK_PATH;
+    bool useMcts = false;
+    long mctsMegabytes = 256;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--ai")
+            aiPlayer = 2;
+        else if (arg == "--ai-first")
+            aiPlayer = 1;
+        else if (arg == "--ai-ms" && hasValue)
+        {
+            aiLimits.timeMs = std::atoi(argv[++i]);
+            timeGiven = true;
+        }
+        else if (arg == "--ai-depth" && hasValue)
+            aiLimits.maxDepth = std::atoi(argv[++i]);
+        else if (arg == "--book" && hasValue)
+            bookPath = argv[++i];
+        else if (arg == "--mcts")
+            useMcts = true;
+        else if (arg == "--mcts-mb" && hasValue)
+            mctsMegabytes = std::max(1L, std::atol(argv[++i]));
+        else
+        {
+            printUsage();
+            return 1;
+        }
+    }
+    if (aiLimits.maxDepth > 0 && !timeGiven)
+        aiLimits.timeMs = 0; // a depth alone means no time limit
+
+    if (useMcts)
+    {
+        mcts.reset(new MctsPlayer(static_cast<std::size_t>(mctsMegabytes) << 20));
+        if (aiLimits.timeMs == 0)
+            aiLimits.timeMs = 1000; // MCTS has no depth: always think on the clock
+    }
+    // The book is optional: without it the opening is searched like any other
+    // move. The solver always ponders, even when MCTS plays.
+    if (book.open(bookPath))
+    {
+        std::cout << "Opening book: " << book.size() << " positions up to move " << book.getMaxPly() << "\n";
+        solver.setBook(&book);
+    }
+
     // Adjust window size to fit the grid
     sf::RenderWindow window(sf::VideoMode(COLS * CELL_SIZE, ROWS * CELL_SIZE), "Connect 4");
+    // The loop no longer blocks on the computer, so keep it from spinning
+    // and taking a core away from the search
+    window.setFramerateLimit(60);
+
+    analysis.reset(new AnalysisService(solver, mcts.get(), aiLimits));
 
     sf::Font font;
     if (!font.loadFromFile(FONT_PATH))
@@ -230,17 +365,9 @@ int main()
             if (event.type == sf::Event::MouseButtonPressed && event.mouseButton.button == sf::Mouse::Left)
             {
                 int col = event.mouseButton.x / CELL_SIZE;
-                if (col >= 0 && col < COLS)
+                if (col >= 0 && col < COLS && !aiToMove())
                 {
-                    dropToken(col);
-                    if (checkWin(Player::Player1))
-                    {
-                        showEndGamePopup(window, "Player 1 won!!", font);
-                    }
-                    else if (checkWin(Player::Player2))
-                    {
-                        showEndGamePopup(window, "Player 2 won!!", font);
-                    }
+                    playMove(col, window, font);
                 }
             }
 
@@ -248,7 +375,19 @@ int main()
             {
                 resetGame();
             }
+
+            if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::H)
+            {
+                showHints = !showHints;
+            }
         }
+        if (!window.isOpen())
+            break;
+
+        syncAnalysis();
+        ColumnEvals latest;
+        if (analysis->pollEvals(latest))
+            evals = latest;
 
         // Clear the screen
         window.clear();
@@ -259,9 +398,30 @@ int main()
         // Draw the tokens
         drawTokens(window);
 
+        drawHeatmap(window, font);
+        drawEngineStats(window, font);
+
         // Display the contents of the window
         window.display();
+
+        // The computer's move, if it is for the board on screen
+        EngineMove move;
+        if (analysis->pollMove(move) && move.id == analysisId && aiToMove() && move.column >= 0)
+        {
+            std::cout << (mcts ? "AI (MCTS): column " : "AI: column ") << move.column + 1;
+            if (!mcts)
+                std::cout << ", depth " << move.depth << (move.exact ? " (solved)" : "");
+            std::cout << ", " << move.work << (mcts ? " playouts" : " nodes") << " in "
+                      << static_cast<int>(move.seconds * 1000) << " ms";
+            if (mcts)
+                std::cout << " (" << static_cast<long>(move.mctsStats.playoutsPerSecond()) << "/s), tree "
+                          << move.mctsStats.bytes / (1 << 20) << " / " << move.mctsStats.maxBytes / (1 << 20) << " MB";
+            std::cout << (move.ponderHit ? ", ponder hit" : "") << "\n";
+            playMove(move.column, window, font);
+        }
     }
 
+    // Stop the search thread before the solver it uses goes away
+    analysis.reset();
     return 0;
 }
\ No newline at end of file
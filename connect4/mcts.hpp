@@ -0,0 +1,289 @@
+#pragma once
+
+#include "bitboard.hpp"
+#include "../common/rng.hpp"
+#include "../common/thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Monte Carlo tree search (UCT) player, an alternative to the alpha-beta
+// search that needs no evaluation function and scales to boards far too
+// big to solve.
+//
+// All threads grow one shared tree (tree parallelism):
+//  - a thread walking down a node adds VIRTUAL_LOSS visits to it at once,
+//    which makes the node look worse to the other threads until the
+//    playout comes back, so they spread over different lines
+//  - nodes live in an arena allocated once, and children are created as a
+//    contiguous block. The thread that wins a compare-and-swap on the
+//    parent's child index expands it; the others do not wait, they play a
+//    random game from the parent instead
+//  - when the arena is full the tree stops growing, the playouts go on
+// Playouts use the bitboard: win at once when possible, never hand the
+// opponent a win, otherwise a random column.
+//
+// The player is a template over the board (any ConnectPosition), since it
+// needs nothing but the rules; MctsPlayer plays the classic game.
+
+struct MctsLimits {
+    int timeMs = 1000;     // 0 = no limit
+    long maxPlayouts = 0;  // 0 = no limit
+};
+
+// Snapshot of a running or finished search
+struct MctsStats {
+    long playouts = 0;
+    double seconds = 0;
+    std::size_t nodes = 0;     // in the tree
+    std::size_t capacity = 0;  // nodes the arena can hold
+    std::size_t bytes = 0;     // memory the tree uses
+    std::size_t maxBytes = 0;  // the cap
+
+    double playoutsPerSecond() const { return seconds > 0 ? playouts / seconds : 0.0; }
+};
+
+template <typename Board>
+struct BasicMctsResult {
+    int column = -1;
+    double value = 0.5;                // expected result for the player to move: 1 win, 0.5 draw, 0 loss
+    long visits[Board::COLS] = {};     // playouts through each root move
+    double values[Board::COLS] = {};   // expected result of each root move
+    MctsStats stats;
+};
+
+template <typename Board>
+class BasicMctsPlayer {
+public:
+    typedef BasicMctsResult<Board> Result;
+
+    static constexpr std::uint32_t VIRTUAL_LOSS = 3;
+    static constexpr std::uint32_t EXPAND_VISITS = 2; // finished visits before a leaf gets children
+
+    // memoryBytes caps the tree; 0 threads = one per hardware thread
+    explicit BasicMctsPlayer(std::size_t memoryBytes = std::size_t(64) << 20, unsigned threads = 0,
+                        std::uint64_t seed = 1)
+        : capacity(std::max<std::size_t>(memoryBytes / sizeof(Node), FIRST_INDEX + Board::COLS)), nodes(new Node[capacity]),
+          pool(threads), seedValue(seed) {}
+
+    // Best column after searching within the limits, -1 when the game is over
+    Result think(const Board& position, const MctsLimits& limits) {
+        auto start = Clock::now();
+        startTicks.store(start.time_since_epoch().count(), std::memory_order_relaxed);
+        deadline = limits.timeMs > 0 ? start + std::chrono::milliseconds(limits.timeMs) : Clock::time_point::max();
+        maxPlayouts = limits.maxPlayouts > 0 ? limits.maxPlayouts : -1;
+        stopping.store(false, std::memory_order_relaxed);
+        playouts.store(0, std::memory_order_relaxed);
+        used.store(FIRST_INDEX, std::memory_order_relaxed); // the root, then indices that mean states
+        initNode(nodes[0], -1, NOT_TERMINAL);
+        rounds++;
+
+        Result result;
+        if (position.isFull() || position.lastMoveWon()) {
+            result.stats = getStats();
+            return result;
+        }
+        expand(nodes[0], position);
+        pool.parallelFor(pool.size(), [&](std::size_t id) {
+            Pcg32 rng = makeRng(seedValue + rounds, id + 1);
+            long done = 0;
+            while (!stopping.load(std::memory_order_relaxed)) {
+                for (int i = 0; i < 64; ++i) playout(position, rng);
+                done = playouts.fetch_add(64, std::memory_order_relaxed) + 64;
+                if ((maxPlayouts >= 0 && done >= maxPlayouts) || Clock::now() >= deadline || aborted()) stop();
+            }
+        });
+
+        const Node& root = nodes[0];
+        std::uint32_t first = root.firstChild.load(std::memory_order_acquire);
+        long bestVisits = -1;
+        for (int i = 0; i < root.childCount; ++i) {
+            const Node& child = nodes[first + i];
+            long visits = child.visits.load(std::memory_order_relaxed);
+            result.visits[child.column] = visits;
+            result.values[child.column] = visits ? child.score.load(std::memory_order_relaxed) / (2.0 * visits) : 0.5;
+            // The most visited move is the one the search trusts most
+            if (visits > bestVisits) {
+                bestVisits = visits;
+                result.column = child.column;
+                result.value = result.values[child.column];
+            }
+        }
+        result.stats = getStats();
+        return result;
+    }
+
+    // Abort a running search from another thread
+    void stop() { stopping.store(true, std::memory_order_relaxed); }
+
+    // A flag another thread raises to abort searches, checked along with the
+    // clock; unlike stop(), a raise just before a search starts is not lost
+    void setAbortFlag(const std::atomic<bool>* flag) { abortFlag = flag; }
+
+    // Safe to call from another thread while think() runs
+    MctsStats getStats() const {
+        MctsStats stats;
+        stats.playouts = playouts.load(std::memory_order_relaxed);
+        Clock::time_point start{Clock::duration(startTicks.load(std::memory_order_relaxed))};
+        stats.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        stats.nodes = std::min<std::size_t>(used.load(std::memory_order_relaxed), capacity);
+        stats.capacity = capacity;
+        stats.bytes = stats.nodes * sizeof(Node);
+        stats.maxBytes = capacity * sizeof(Node);
+        return stats;
+    }
+
+    unsigned getThreadCount() const { return pool.size(); }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+    typedef typename Board::Bitboard Bitboard;
+    static constexpr ColumnOrder<Board::COLS> ORDER{};
+
+    bool aborted() const { return abortFlag && abortFlag->load(std::memory_order_relaxed); }
+
+    enum Terminal : std::uint8_t { NOT_TERMINAL, WON, DRAWN }; // for the player who moved into the node
+
+    // firstChild values below FIRST_INDEX are states, not indices
+    static constexpr std::uint32_t UNEXPANDED = 0;
+    static constexpr std::uint32_t EXPANDING = 1;
+    static constexpr std::uint32_t NO_ROOM = 2;
+    static constexpr std::uint32_t FIRST_INDEX = 3;
+
+    // 16 bytes. Results are counted in half points for the player who
+    // moved into the node: 2 win, 1 draw, 0 loss.
+    struct Node {
+        std::atomic<std::uint32_t> visits;
+        std::atomic<std::uint32_t> score;
+        std::atomic<std::uint32_t> firstChild; // arena index of the children, or a state
+        std::int8_t column;
+        std::uint8_t childCount;
+        std::uint8_t terminal;
+    };
+
+    static void initNode(Node& node, int column, Terminal terminal) {
+        node.visits.store(0, std::memory_order_relaxed);
+        node.score.store(0, std::memory_order_relaxed);
+        node.firstChild.store(UNEXPANDED, std::memory_order_relaxed);
+        node.column = static_cast<std::int8_t>(column);
+        node.childCount = 0;
+        node.terminal = terminal;
+    }
+
+    // Called by the one thread that moved firstChild to EXPANDING (or on the root)
+    void expand(Node& node, const Board& position) {
+        int count = 0;
+        for (int col = 0; col < Board::COLS; ++col) count += position.canPlay(col);
+        std::size_t first = used.fetch_add(static_cast<std::size_t>(count), std::memory_order_relaxed);
+        if (first + count > capacity) {
+            node.firstChild.store(NO_ROOM, std::memory_order_release);
+            return;
+        }
+        int i = 0;
+        // Centre first, so the unvisited moves are tried in that order
+        for (int col : ORDER.columns) {
+            if (!position.canPlay(col)) continue;
+            Terminal terminal = position.isWinningMove(col) ? WON
+                                : position.getMoves() + 1 == Board::CELLS ? DRAWN : NOT_TERMINAL;
+            initNode(nodes[first + i++], col, terminal);
+        }
+        node.childCount = static_cast<std::uint8_t>(count);
+        node.firstChild.store(static_cast<std::uint32_t>(first), std::memory_order_release);
+    }
+
+    // UCB1 over the children; unvisited children first
+    Node* select(const Node& node, std::uint32_t first) {
+        double logParent = std::log(static_cast<double>(node.visits.load(std::memory_order_relaxed)) + 1.0);
+        Node* best = nullptr;
+        double bestValue = -1.0;
+        for (int i = 0; i < node.childCount; ++i) {
+            Node& child = nodes[first + i];
+            std::uint32_t visits = child.visits.load(std::memory_order_relaxed);
+            if (visits == 0) return &child;
+            double value = child.score.load(std::memory_order_relaxed) / (2.0 * visits) +
+                           EXPLORATION * std::sqrt(logParent / visits);
+            if (value > bestValue) {
+                bestValue = value;
+                best = &child;
+            }
+        }
+        return best;
+    }
+
+    // One descent, playout and update
+    void playout(const Board& rootPosition, Pcg32& rng) {
+        Node* path[Board::CELLS + 1];
+        int length = 0;
+        Board position = rootPosition;
+        Node* node = &nodes[0];
+        node->visits.fetch_add(VIRTUAL_LOSS, std::memory_order_relaxed);
+        path[length++] = node;
+
+        std::uint32_t result; // for the player who moved into `node`
+        for (;;) {
+            if (node->terminal != NOT_TERMINAL) {
+                result = node->terminal == WON ? 2 : 1;
+                break;
+            }
+            std::uint32_t first = node->firstChild.load(std::memory_order_acquire);
+            if (first == UNEXPANDED && node->visits.load(std::memory_order_relaxed) >= EXPAND_VISITS + VIRTUAL_LOSS) {
+                std::uint32_t expected = UNEXPANDED;
+                if (node->firstChild.compare_exchange_strong(expected, EXPANDING, std::memory_order_acq_rel)) {
+                    expand(*node, position);
+                    first = node->firstChild.load(std::memory_order_relaxed);
+                }
+            }
+            if (first < FIRST_INDEX) {
+                result = 2 - rollout(position, rng);
+                break;
+            }
+            node = select(*node, first);
+            node->visits.fetch_add(VIRTUAL_LOSS, std::memory_order_relaxed);
+            position.play(node->column);
+            path[length++] = node;
+        }
+
+        // Each node counts one real visit: drop the rest of the virtual loss
+        for (int i = length - 1; i >= 0; --i) {
+            path[i]->score.fetch_add(result, std::memory_order_relaxed);
+            path[i]->visits.fetch_sub(VIRTUAL_LOSS - 1, std::memory_order_relaxed);
+            result = 2 - result;
+        }
+    }
+
+    // Random game from `position`; 2 if the player to move wins, 1 draw, 0 loss
+    static std::uint32_t rollout(Board position, Pcg32& rng) {
+        for (std::uint32_t side = 0;; side ^= 1) {
+            if (position.isFull()) return 1;
+            if (position.canWinNext()) return side ? 0 : 2;
+            Bitboard moves = position.possibleNonLosingMoves();
+            if (!moves) return side ? 2 : 0;
+            for (std::uint32_t skip = rng.below(static_cast<std::uint32_t>(popcount(moves))); skip; --skip)
+                moves &= moves - 1;
+            position.playMove(moves & (Bitboard(0) - moves));
+        }
+    }
+
+    static constexpr double EXPLORATION = 1.0;
+
+    std::size_t capacity;
+    std::unique_ptr<Node[]> nodes;
+    ThreadPool pool;
+    std::uint64_t seedValue;
+    std::uint64_t rounds = 0;
+
+    std::atomic<std::size_t> used{0};
+    std::atomic<long> playouts{0};
+    std::atomic<bool> stopping{false};
+    const std::atomic<bool>* abortFlag = nullptr;
+    long maxPlayouts = -1;
+    std::atomic<Clock::rep> startTicks{Clock::now().time_since_epoch().count()};
+    Clock::time_point deadline = Clock::time_point::max();
+};
+
+typedef BasicMctsPlayer<Position> MctsPlayer;
+typedef MctsPlayer::Result MctsResult;
@@ -0,0 +1,346 @@
+// Headless Connect Four solver: prints the exact score of positions given
+// as move strings (1-based column digits, e.g. "4453"), from the command
+// line or one per line on stdin. A line may carry the expected score after
+// the moves, as in J. Pons' benchmark sets; mismatches are counted.
+
+#include "mcts.hpp"
+#include "solver.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct SolveOptions {
+    bool weak = false;     // only win / draw / loss
+    bool analyze = false;  // score of every column
+    bool reset = false;    // empty the table between positions, for benchmarks
+    SearchLimits limits;   // with --depth or --ms: best move instead of the exact score
+    int tableLog2 = 23;
+    unsigned threads = 0;  // 0 = one per hardware thread
+    unsigned speedup = 0;  // > 0: time the opening suite from 1 to this many threads
+    bool selfCheck = false;
+    std::string bookPath;
+    bool mcts = false;     // best move by Monte Carlo tree search
+    long mctsMegabytes = 256;
+    int rows = ROWS, cols = COLS, connect = 4; // board for --mcts
+    std::vector<std::string> positions;
+};
+
+void printUsage() {
+    std::cout << "Usage: connect4_solve [--weak] [--analyze] [--depth D] [--ms T] [--hash-log2 N]\n"
+              << "                      [--threads N] [--book FILE] [--reset] [MOVES...]\n"
+              << "       connect4_solve --speedup N [--weak] [--hash-log2 N]\n"
+              << "       connect4_solve --self-check\n"
+              << "       connect4_solve --mcts [--ms T] [--mcts-mb M] [--threads N] [--board RxC]\n"
+              << "                      [--connect K] [MOVES...]\n"
+              << "  Solves each position (column digits 1-7, e.g. 4453) and prints its score:\n"
+              << "  0 draw, > 0 the player to move wins, higher is sooner. Without MOVES the\n"
+              << "  positions are read from stdin, one per line, optionally followed by the\n"
+              << "  expected score. --depth / --ms search for the best move within that\n"
+              << "  many plies / milliseconds instead of solving. --speedup solves a fixed\n"
+              << "  set of openings with 1, 2, 4 ... N threads and prints the speedup.\n"
+              << "  --self-check runs edge cases (full board, wins next move) through every mode.\n"
+              << "  --book uses an opening book written by connect4_book. --mcts picks a\n"
+              << "  move by Monte Carlo tree search in T ms (default 1000), with a tree of\n"
+              << "  at most M MB, showing playouts/s and tree size while it runs; it also\n"
+              << "  plays R x C boards (6x7, 7x8, 8x9) with K (4 or 5) in a row to win\n";
+}
+
+bool parseOptions(int argc, char** argv, SolveOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--weak") options.weak = true;
+        else if (arg == "--analyze") options.analyze = true;
+        else if (arg == "--reset") options.reset = true;
+        else if (arg == "--depth" && hasValue) options.limits.maxDepth = std::atoi(argv[++i]);
+        else if (arg == "--ms" && hasValue) options.limits.timeMs = std::atoi(argv[++i]);
+        else if (arg == "--hash-log2" && hasValue) options.tableLog2 = std::atoi(argv[++i]);
+        else if (arg == "--threads" && hasValue) options.threads = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if (arg == "--book" && hasValue) options.bookPath = argv[++i];
+        else if (arg == "--mcts") options.mcts = true;
+        else if (arg == "--mcts-mb" && hasValue) options.mctsMegabytes = std::atol(argv[++i]);
+        else if (arg == "--board" && hasValue) {
+            if (std::sscanf(argv[++i], "%dx%d", &options.rows, &options.cols) != 2) return false;
+        }
+        else if (arg == "--connect" && hasValue) options.connect = std::atoi(argv[++i]);
+        else if (arg == "--self-check") options.selfCheck = true;
+        else if (arg == "--speedup" && hasValue) options.speedup = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if (arg.empty() || arg[0] != '-') options.positions.push_back(arg); // "" is the empty board
+        else return false;
+    }
+    return options.tableLog2 >= 10 && options.tableLog2 <= 32 && options.limits.maxDepth >= 0 &&
+           options.limits.timeMs >= 0 && options.threads <= 256 && options.speedup <= 256 &&
+           options.mctsMegabytes > 0;
+}
+
+std::string formatScore(int score) {
+    if (isProven(score)) return std::to_string(score / SCORE_SCALE);
+    char text[32];
+    std::snprintf(text, sizeof(text), "~%+.3f", static_cast<double>(score) / SCORE_SCALE);
+    return text;
+}
+
+// Score of every playable column from the point of view of the player to move
+std::string analyze(Solver& solver, const Position& position, bool weak) {
+    std::string line;
+    for (int col = 0; col < COLS; ++col) {
+        if (col) line += " ";
+        if (!position.canPlay(col)) {
+            line += "-";
+        } else if (position.isWinningMove(col)) {
+            line += std::to_string(weak ? 1 : (CELLS + 1 - position.getMoves()) / 2);
+        } else {
+            Position child = position;
+            child.play(col);
+            line += std::to_string(-solver.solve(child, weak));
+        }
+    }
+    return line;
+}
+
+// Openings of 5 to 8 moves with their exact scores; one thread solves each
+// in 0.5 to 3 seconds, about 12 seconds for the whole set
+const char* const SPEEDUP_SUITE[][2] = {
+    {"44536", "2"},    {"3443424", "-6"},  {"4444432", "3"},  {"44444326", "0"},
+    {"43443444", "-4"}, {"33353533", "1"}, {"24444352", "4"}, {"43443332", "0"},
+};
+
+// Solve the suite with 1, 2, 4 ... maxThreads threads, each run starting
+// from an empty table, and print time, node rate and speedup against one thread
+int runSpeedup(const SolveOptions& options, unsigned maxThreads) {
+    std::printf("threads   time ms   Mnodes   Mnodes/s   speedup\n");
+    double baseline = 0;
+    bool ok = true;
+    for (unsigned threads = 1;; threads = std::min(threads * 2, maxThreads)) {
+        Solver solver(options.tableLog2, threads);
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& entry : SPEEDUP_SUITE) {
+            Position position;
+            position.playSequence(entry[0]);
+            solver.clear();
+            int score = solver.solve(position, options.weak);
+            int expected = std::atoi(entry[1]);
+            if (options.weak ? (score > 0) != (expected > 0) || (score < 0) != (expected < 0) : score != expected) {
+                std::printf("%s: %d instead of %d\n", entry[0], score, expected);
+                ok = false;
+            }
+        }
+        long nodes = solver.getNodes();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (threads == 1) baseline = seconds;
+        std::printf("%7u %9.1f %8.1f %10.2f %8.2fx\n", threads, seconds * 1000, nodes / 1e6,
+                    seconds > 0 ? nodes / seconds / 1e6 : 0.0, seconds > 0 ? baseline / seconds : 0.0);
+        std::fflush(stdout);
+        if (threads == maxThreads) break;
+    }
+    return ok ? 0 : 2;
+}
+
+// Edge cases with their expected answers. "search" answers are
+// "column score[ exact]" after a 4-ply search, column 0 meaning no move.
+const char* const SELF_CHECK[][3] = {
+    {"757341132773575647262416323134652254654611", "solve", "0"}, // full board, drawn
+    {"757341132773575647262416323134652254654611", "search", "0 0 exact"},
+    {"112233", "solve", "18"}, // the player to move wins at once
+    {"112233", "search", "4 18 exact"},
+    {"112233", "weak", "1"},
+    {"75734113277357564726241632313465225", "analyze", "-3 - - 3 -3 4 -"}, // column 6 wins at once
+    {"75734113277357564726241632313465225", "weak-analyze", "-1 - - 1 -1 1 -"},
+};
+
+int runSelfCheck(const SolveOptions& options) {
+    Solver solver(options.tableLog2, options.threads);
+    int failures = 0;
+    for (const auto& entry : SELF_CHECK) {
+        Position position;
+        position.playSequence(entry[0]);
+        std::string mode = entry[1], answer;
+        if (mode == "search") {
+            SearchResult result = solver.search(position, SearchLimits{4, 0});
+            answer = std::to_string(result.column + 1) + " " + formatScore(result.score) + (result.exact ? " exact" : "");
+        } else if (mode == "analyze" || mode == "weak-analyze") {
+            answer = analyze(solver, position, mode == "weak-analyze");
+        } else {
+            answer = std::to_string(solver.solve(position, mode == "weak"));
+        }
+        if (answer == entry[2]) {
+            std::printf("%-12s %s: %s\n", entry[1], entry[0], answer.c_str());
+        } else {
+            std::printf("%-12s %s: %s instead of %s\n", entry[1], entry[0], answer.c_str(), entry[2]);
+            failures++;
+        }
+    }
+    std::printf("%s\n", failures ? "SELF-CHECK FAILED" : "all checks passed");
+    return failures ? 2 : 0;
+}
+
+// Monte Carlo search on a second thread while this one prints its progress
+template <typename Board>
+typename BasicMctsPlayer<Board>::Result thinkLive(BasicMctsPlayer<Board>& player, const Board& position, int timeMs) {
+    typename BasicMctsPlayer<Board>::Result result;
+    std::atomic<bool> done{false};
+    std::thread search([&] {
+        result = player.think(position, MctsLimits{timeMs, 0});
+        done = true;
+    });
+    for (int tick = 1; !done; ++tick) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        if (tick % 5) continue;
+        MctsStats stats = player.getStats();
+        std::fprintf(stderr, "\r%6.1f s  %10ld playouts  %8.0f playouts/s  tree %6.1f / %zu MB", stats.seconds,
+                     stats.playouts, stats.playoutsPerSecond(), stats.bytes / 1048576.0, stats.maxBytes >> 20);
+    }
+    search.join();
+    std::fprintf(stderr, "\r%78s\r", "");
+    return result;
+}
+
+template <typename Board>
+int runMctsOn(const SolveOptions& options) {
+    BasicMctsPlayer<Board> player(static_cast<std::size_t>(options.mctsMegabytes) << 20, options.threads);
+    std::cerr << Board::ROWS << "x" << Board::COLS << ", " << Board::WIN << " in a row; tree: at most "
+              << options.mctsMegabytes << " MB, " << player.getThreadCount() << " threads\n";
+    int timeMs = options.limits.timeMs > 0 ? options.limits.timeMs : 1000;
+    bool ok = true;
+    std::vector<std::string> positions = options.positions;
+    if (positions.empty()) positions.push_back("");
+    for (const std::string& moves : positions) {
+        Board position;
+        if (!position.playSequence(moves)) {
+            std::cout << moves << " invalid\n";
+            ok = false;
+            continue;
+        }
+        auto result = thinkLive(player, position, timeMs);
+        std::printf("%s column %d expected %.3f  %ld playouts  %.0f playouts/s  tree %.1f MB, %zu nodes\n",
+                    moves.empty() ? "(empty)" : moves.c_str(), result.column + 1, result.value,
+                    result.stats.playouts, result.stats.playoutsPerSecond(), result.stats.bytes / 1048576.0,
+                    result.stats.nodes);
+        std::string visits;
+        for (int col = 0; col < Board::COLS; ++col) {
+            char text[48];
+            std::snprintf(text, sizeof(text), "  %d: %ld x %.2f", col + 1, result.visits[col], result.values[col]);
+            if (result.visits[col]) visits += text;
+        }
+        std::printf("  %s\n", visits.c_str());
+        std::fflush(stdout);
+    }
+    return ok ? 0 : 2;
+}
+
+// Each board size is its own instantiation, with its own masks and word size
+int runMcts(const SolveOptions& options) {
+    int size = options.rows * 100 + options.cols;
+    if (options.connect == 4) {
+        if (size == 607) return runMctsOn<Position>(options);
+        if (size == 708) return runMctsOn<ConnectPosition<7, 8, 4>>(options);
+        if (size == 809) return runMctsOn<ConnectPosition<8, 9, 4>>(options);
+    } else if (options.connect == 5) {
+        if (size == 607) return runMctsOn<ConnectPosition<6, 7, 5>>(options);
+        if (size == 708) return runMctsOn<ConnectPosition<7, 8, 5>>(options);
+        if (size == 809) return runMctsOn<ConnectPosition<8, 9, 5>>(options);
+    }
+    std::cerr << "unsupported board: " << options.rows << "x" << options.cols << ", " << options.connect
+              << " in a row\n";
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    SolveOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+    bool searching = options.limits.maxDepth > 0 || options.limits.timeMs > 0;
+    bool fromStdin = options.positions.empty();
+    if (options.speedup) return runSpeedup(options, options.speedup);
+    if (options.selfCheck) return runSelfCheck(options);
+    if (options.mcts) return runMcts(options);
+
+    Solver solver(options.tableLog2, options.threads);
+    OpeningBook book;
+    if (!options.bookPath.empty()) {
+        if (!book.open(options.bookPath)) {
+            std::cerr << "cannot open book " << options.bookPath << "\n";
+            return 1;
+        }
+        std::cerr << "book: " << book.size() << " positions up to ply " << book.getMaxPly() << "\n";
+        solver.setBook(&book);
+    }
+    std::cerr << "table: " << solver.getTable().size() << " entries, " << solver.getTable().bytes() / (1 << 20)
+              << " MB, " << solver.getThreadCount() << " threads\n";
+
+    long solved = 0, mismatches = 0, invalid = 0, totalNodes = 0;
+    double totalSeconds = 0;
+    std::string line;
+    size_t next = 0;
+    for (;;) {
+        if (fromStdin) {
+            if (!std::getline(std::cin, line)) break;
+        } else {
+            if (next == options.positions.size()) break;
+            line = options.positions[next++];
+        }
+        std::string moves = line, expectedText;
+        if (fromStdin) {
+            std::istringstream fields(line);
+            moves.clear();
+            fields >> moves >> expectedText;
+            if (moves.empty() || moves[0] == '#') continue;
+        }
+
+        Position position;
+        if (!position.playSequence(moves)) {
+            std::cout << moves << " invalid\n";
+            invalid++;
+            continue;
+        }
+        if (options.reset) solver.clear();
+
+        long nodesBefore = solver.getNodes();
+        auto start = std::chrono::steady_clock::now();
+        std::string answer;
+        int score = 0;
+        if (searching) {
+            SearchResult result = solver.search(position, options.limits);
+            score = result.score;
+            answer = "column " + std::to_string(result.column + 1) + " score " + formatScore(score) + " depth " +
+                     std::to_string(result.depth) + (result.exact ? " exact" : "");
+        } else if (options.analyze) {
+            answer = analyze(solver, position, options.weak);
+        } else {
+            score = solver.solve(position, options.weak);
+            answer = std::to_string(score);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        long nodes = solver.getNodes() - nodesBefore;
+        totalNodes += nodes;
+        totalSeconds += seconds;
+        solved++;
+
+        bool mismatch = false;
+        if (!expectedText.empty() && !searching && !options.analyze) {
+            int expected = std::atoi(expectedText.c_str());
+            mismatch = options.weak ? (expected > 0) != (score > 0) || (expected < 0) != (score < 0) : expected != score;
+        }
+        mismatches += mismatch;
+        std::printf("%s %s  %ld nodes  %.3f ms  %.2f Mnodes/s%s\n", moves.empty() ? "(empty)" : moves.c_str(),
+                    answer.c_str(), nodes, seconds * 1000, seconds > 0 ? nodes / seconds / 1e6 : 0.0,
+                    mismatch ? "  MISMATCH" : "");
+        std::fflush(stdout);
+    }
+
+    if (solved > 1) {
+        std::printf("%ld positions, mean %.3f ms, mean %.0f nodes, %.2f Mnodes/s", solved, totalSeconds * 1000 / solved,
+                    static_cast<double>(totalNodes) / solved, totalSeconds > 0 ? totalNodes / totalSeconds / 1e6 : 0.0);
+        if (mismatches) std::printf(", %ld MISMATCHES", mismatches);
+        std::printf("\n");
+    }
+    return mismatches || invalid ? 2 : 0;
+}
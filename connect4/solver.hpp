@@ -0,0 +1,425 @@
+#pragma once
+
+#include "bitboard.hpp"
+#include "book.hpp"
+#include "../common/thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Negamax search with alpha-beta pruning over the bitboard.
+//
+// Scores are in SCORE_SCALE units. A multiple of SCORE_SCALE is a proven
+// result (J. Pons' convention): 0 is a draw, a win scores 22 minus the
+// number of stones the winner played, so faster wins score higher, and a
+// loss is the opposite. Values in between come from the heuristic at the
+// depth horizon and prove nothing.
+//
+// solve() finds the exact score with a series of null-window searches.
+// search() is for playing: iterative deepening to a depth or time limit,
+// always keeping the best move of the last finished iteration.
+
+const int SCORE_SCALE = 1000;
+
+constexpr ColumnOrder<COLS> COLUMN_ORDER{};
+
+static_assert(sizeof(Bitboard) == 8, "the transposition table stores 64-bit keys");
+
+inline bool isProven(int score) { return score % SCORE_SCALE == 0; }
+
+// Lock-free cache of search results shared by all search threads. Each
+// entry stores check = key ^ data next to data, so a torn write reads back
+// as a miss.
+class SolverTable {
+public:
+    enum Bound : std::uint8_t { LOWER = 1, UPPER = 2, EXACT = 3 };
+
+    struct Hit {
+        int value;
+        int depth;
+        Bound bound;
+        int column; // best move, -1 if none
+    };
+
+    explicit SolverTable(int entriesLog2 = 22)
+        : mask((std::size_t(1) << entriesLog2) - 1), entries(new Entry[mask + 1]) {
+        clear();
+    }
+
+    void clear() {
+        for (std::size_t i = 0; i <= mask; ++i) {
+            entries[i].check.store(0, std::memory_order_relaxed);
+            entries[i].data.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    std::size_t size() const { return mask + 1; }
+    std::size_t bytes() const { return size() * sizeof(Entry); }
+
+    bool probe(std::uint64_t key, Hit& hit) const {
+        const Entry& e = entries[index(key)];
+        std::uint64_t data = e.data.load(std::memory_order_relaxed);
+        if ((e.check.load(std::memory_order_relaxed) ^ data) != key + 1) return false; // key + 1: never 0
+        hit.value = static_cast<std::int16_t>(data & 0xFFFF);
+        hit.depth = static_cast<int>((data >> 16) & 0xFF);
+        hit.bound = static_cast<Bound>((data >> 24) & 0xFF);
+        hit.column = static_cast<int>((data >> 32) & 0xFF) - 1;
+        return true;
+    }
+
+    void store(std::uint64_t key, int value, int depth, Bound bound, int column) {
+        std::uint64_t data = static_cast<std::uint16_t>(value) | static_cast<std::uint64_t>(depth) << 16 |
+                             static_cast<std::uint64_t>(bound) << 24 | static_cast<std::uint64_t>(column + 1) << 32;
+        Entry& e = entries[index(key)];
+        e.data.store(data, std::memory_order_relaxed);
+        e.check.store((key + 1) ^ data, std::memory_order_relaxed);
+    }
+
+private:
+    struct Entry {
+        std::atomic<std::uint64_t> check;
+        std::atomic<std::uint64_t> data;
+    };
+
+    // Keys are structured (neighbouring positions differ in a few bits), so mix them first
+    std::size_t index(std::uint64_t key) const {
+        return static_cast<std::size_t>((key * 0x9E3779B97F4A7C15ull) >> 20) & mask;
+    }
+
+    std::size_t mask;
+    std::unique_ptr<Entry[]> entries;
+};
+
+struct SearchLimits {
+    int maxDepth = 0; // plies; 0 = until the end of the game
+    int timeMs = 0;   // 0 = no limit
+};
+
+struct SearchResult {
+    int column = -1;
+    int score = 0;    // SCORE_SCALE units, see above
+    int depth = 0;    // of the last finished iteration
+    bool exact = false;
+    long nodes = 0;
+    double seconds = 0;
+};
+
+// Lazy SMP: every thread runs the whole search on the same position and
+// they share only the transposition table. Helpers break move-order ties
+// differently and some search one ply deeper, so they explore other parts
+// of the tree first and leave results there for each other; the first
+// thread to finish stops the rest.
+class Solver {
+public:
+    // 0 threads = one per hardware thread
+    explicit Solver(int tableLog2 = 22, unsigned threads = 0) : table(tableLog2), pool(threads) {}
+
+    // Exact score of the position; weak = only win (> 0), draw or loss (< 0)
+    int solve(const Position& position, bool weak = false) {
+        begin(Clock::time_point::max());
+        if (position.canWinNext()) return weak ? 1 : (CELLS + 1 - position.getMoves()) / 2;
+        int known;
+        if (book && book->lookup(position, known)) return weak ? (known > 0) - (known < 0) : known;
+        std::atomic<bool> solved{false};
+        int answer = 0;
+        pool.parallelFor(pool.size(), [&](std::size_t id) {
+            Worker worker(static_cast<unsigned>(id));
+            int score = solveWith(position, weak, worker);
+            if (!stopped() && !solved.exchange(true)) {
+                answer = score;
+                stop();
+            }
+            nodes += worker.nodes;
+        });
+        return answer;
+    }
+
+    // Best column within the limits, -1 when the game is over
+    SearchResult search(const Position& position, const SearchLimits& limits) {
+        auto start = Clock::now();
+        begin(limits.timeMs > 0 ? start + std::chrono::milliseconds(limits.timeMs) : Clock::time_point::max());
+        long nodesBefore = nodes;
+        SearchResult result;
+        int remaining = CELLS - position.getMoves();
+        int maxDepth = limits.maxDepth > 0 ? std::min(limits.maxDepth, remaining) : remaining;
+
+        if (position.isFull()) {
+            // A draw, with no move to play
+            result.exact = true;
+            finish(result, start, nodesBefore);
+            return result;
+        }
+
+        for (int col : COLUMN_ORDER.columns) {
+            if (!position.canPlay(col)) continue;
+            if (result.column < 0) result.column = col; // something to play even with no time at all
+            if (position.isWinningMove(col)) {
+                result.column = col;
+                result.score = (CELLS + 1 - position.getMoves()) / 2 * SCORE_SCALE;
+                result.exact = true;
+                result.depth = 1;
+                finish(result, start, nodesBefore);
+                return result;
+            }
+        }
+
+        std::vector<SearchResult> found(pool.size(), result);
+        pool.parallelFor(pool.size(), [&](std::size_t id) {
+            Worker worker(static_cast<unsigned>(id));
+            SearchResult& mine = found[id];
+            // Half of the helpers start one ply deeper than the main thread
+            for (int depth = std::min(1 + static_cast<int>(id % 2), maxDepth); depth <= maxDepth; ++depth) {
+                int column = -1;
+                int score = searchRoot(position, depth, mine.column, column, worker);
+                if (stopped()) break; // an unfinished iteration proves nothing
+                mine.column = column;
+                mine.score = score;
+                mine.depth = depth;
+                mine.exact = depth >= remaining || (isProven(score) && score != 0);
+                if (mine.exact) break;
+            }
+            if (!stopped()) stop(); // done: the others can stop too
+            nodes += worker.nodes;
+        });
+        // The deepest finished iteration wins, the main thread on ties
+        for (const SearchResult& r : found)
+            if (r.exact > result.exact || (r.exact == result.exact && r.depth > result.depth)) result = r;
+        finish(result, start, nodesBefore);
+        return result;
+    }
+
+    // Score of every playable column searched `depth` plies deep (unplayable
+    // columns get 0). Each column gets a full window, so every score is exact
+    // for that depth, not just the best one. The columns are shared out
+    // between the threads. False if the search was stopped.
+    bool scoreColumns(const Position& position, int depth, int scores[COLS]) {
+        begin(Clock::time_point::max());
+        const int infinity = (CELLS + 1) * SCORE_SCALE;
+        pool.parallelFor(COLS, [&](std::size_t index) {
+            int col = static_cast<int>(index);
+            scores[col] = 0;
+            if (!position.canPlay(col)) return;
+            if (position.isWinningMove(col)) {
+                scores[col] = (CELLS + 1 - position.getMoves()) / 2 * SCORE_SCALE;
+                return;
+            }
+            Worker worker(static_cast<unsigned>(index));
+            Position child = position;
+            child.play(col);
+            scores[col] = child.canWinNext() ? -(CELLS + 1 - child.getMoves()) / 2 * SCORE_SCALE
+                                             : -negamax(child, -infinity, infinity, depth - 1, worker);
+            nodes += worker.nodes;
+        });
+        return !stopped();
+    }
+
+    // Abort the running search from another thread
+    void stop() { stopping.store(true, std::memory_order_relaxed); }
+
+    void clear() { table.clear(); }
+
+    // Exact scores for the opening; the book must outlive the solver or be
+    // unset before it goes away
+    void setBook(const OpeningBook* openingBook) { book = openingBook; }
+
+    // A flag another thread raises to abort searches, checked along with the
+    // clock; unlike stop(), a raise just before a search starts is not lost
+    void setAbortFlag(const std::atomic<bool>* flag) { abortFlag = flag; }
+    long getNodes() const { return nodes.load(); }
+    unsigned getThreadCount() const { return pool.size(); }
+    const SolverTable& getTable() const { return table; }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    // One search thread. Ties in the move order are broken by `order`,
+    // the centre-first order for the main thread and a rotation of it for
+    // each helper.
+    struct Worker {
+        unsigned id;
+        long nodes = 0;
+        int order[COLS];
+
+        explicit Worker(unsigned id_) : id(id_) {
+            order[0] = COLUMN_ORDER.columns[0];
+            for (int i = 1; i < COLS; ++i) order[i] = COLUMN_ORDER.columns[1 + (i - 1 + id) % (COLS - 1)];
+        }
+    };
+
+    // Up to COLS moves, handed out best score first; among equal scores the
+    // one added last comes first, so moves are added worst column first
+    struct MoveSorter {
+        Bitboard moves[COLS];
+        int scores[COLS];
+        int count = 0;
+
+        void add(Bitboard move, int score) {
+            int pos = count++;
+            for (; pos && scores[pos - 1] > score; --pos) {
+                moves[pos] = moves[pos - 1];
+                scores[pos] = scores[pos - 1];
+            }
+            moves[pos] = move;
+            scores[pos] = score;
+        }
+        Bitboard next() { return count ? moves[--count] : 0; }
+    };
+
+    static int columnOf(Bitboard move) { return Position::columnOf(move); }
+
+    void begin(Clock::time_point until) {
+        stopping.store(false, std::memory_order_relaxed);
+        deadline = until;
+        if (aborted()) stop();
+    }
+
+    bool aborted() const { return abortFlag && abortFlag->load(std::memory_order_relaxed); }
+
+    bool stopped() const { return stopping.load(std::memory_order_relaxed); }
+
+    // Checked every few thousand nodes so the clock is not read in the inner loop
+    void countNode(Worker& worker) {
+        if ((++worker.nodes & 4095) == 0 && (Clock::now() >= deadline || aborted())) stop();
+    }
+
+    // Null windows, first around 0 and then halving towards the edges, are
+    // cheaper than one wide search
+    int solveWith(const Position& position, bool weak, Worker& worker) {
+        int lo = weak ? -1 : -(CELLS - position.getMoves()) / 2;
+        int hi = weak ? 1 : (CELLS + 1 - position.getMoves()) / 2;
+        while (lo < hi && !stopped()) {
+            int med = lo + (hi - lo) / 2;
+            if (med <= 0 && lo / 2 < med) med = lo / 2;
+            else if (med >= 0 && hi / 2 > med) med = hi / 2;
+            int r = negamax(position, med * SCORE_SCALE, med * SCORE_SCALE + 1, CELLS, worker);
+            if (r <= med * SCORE_SCALE) hi = med;
+            else lo = med + 1;
+        }
+        return lo;
+    }
+
+    // Static guess for a position at the depth horizon from open threats,
+    // then centre control. Never a multiple of SCORE_SCALE, so it cannot be
+    // mistaken for a proven score; ties go to the player to move.
+    static int heuristic(const Position& p, int lo, int hi) {
+        Bitboard mine = p.getCurrent(), theirs = p.getCurrent() ^ p.getMask();
+        int threats = popcount(p.winningPosition()) - popcount(p.opponentWinningPosition());
+        Bitboard centre = columnMask(COLS / 2);
+        int centreStones = popcount(mine & centre) - popcount(theirs & centre);
+        int value = std::max(-SCORE_SCALE + 1, std::min(SCORE_SCALE - 1, threats * 100 + centreStones * 20));
+        value = std::max(lo + 1, std::min(hi - 1, value));
+        return value == 0 ? 1 : value;
+    }
+
+    // Score of each root move, best first; `hint` (the previous best) is tried first
+    int searchRoot(const Position& position, int depth, int hint, int& bestColumn, Worker& worker) {
+        MoveSorter sorter;
+        Bitboard playable = position.possible();
+        for (int i = COLS - 1; i >= 0; --i) {
+            int col = worker.order[i];
+            Bitboard move = playable & columnMask(col);
+            if (move) sorter.add(move, col == hint ? 1000 : position.moveScore(move));
+        }
+        int alpha = -(CELLS + 1) * SCORE_SCALE, beta = -alpha;
+        int best = alpha;
+        while (Bitboard move = sorter.next()) {
+            Position child = position;
+            child.playMove(move);
+            // Replies that win on the spot are never searched below
+            int score = child.canWinNext() ? -(CELLS + 1 - child.getMoves()) / 2 * SCORE_SCALE
+                                           : -negamax(child, -beta, -alpha, depth - 1, worker);
+            if (stopped()) return 0;
+            if (score > best) {
+                best = score;
+                bestColumn = columnOf(move);
+                alpha = std::max(alpha, score);
+            }
+        }
+        return best;
+    }
+
+    // The player to move cannot win on this move (the caller checks)
+    int negamax(const Position& p, int alpha, int beta, int depth, Worker& worker) {
+        countNode(worker);
+        if (stopped()) return 0;
+
+        Bitboard next = p.possibleNonLosingMoves();
+        if (!next) return -(CELLS - p.getMoves()) / 2 * SCORE_SCALE; // the opponent wins next move
+        if (p.getMoves() >= CELLS - 2) return 0;                     // both players have one move left
+        int known;
+        if (book && book->lookup(p, known)) return known * SCORE_SCALE;
+
+        // Nobody can win on the next two moves, which bounds the score
+        int lo = -(CELLS - 2 - p.getMoves()) / 2 * SCORE_SCALE;
+        int hi = (CELLS - 1 - p.getMoves()) / 2 * SCORE_SCALE;
+        if (alpha < lo) {
+            alpha = lo;
+            if (alpha >= beta) return alpha;
+        }
+        if (beta > hi) {
+            beta = hi;
+            if (alpha >= beta) return beta;
+        }
+        if (depth <= 0) return heuristic(p, lo, hi);
+
+        // Deeper than the game lasts is the same as to the end
+        depth = std::min(depth, CELLS - p.getMoves());
+        std::uint64_t key = p.key();
+        SolverTable::Hit hit;
+        int hintColumn = -1;
+        if (table.probe(key, hit)) {
+            hintColumn = hit.column;
+            if (hit.depth >= depth) {
+                if (hit.bound == SolverTable::EXACT) return hit.value;
+                if (hit.bound == SolverTable::LOWER) alpha = std::max(alpha, hit.value);
+                else beta = std::min(beta, hit.value);
+                if (alpha >= beta) return hit.value;
+            }
+        }
+
+        MoveSorter sorter;
+        for (int i = COLS - 1; i >= 0; --i) {
+            int col = worker.order[i];
+            Bitboard move = next & columnMask(col);
+            if (move) sorter.add(move, col == hintColumn ? 1000 : p.moveScore(move));
+        }
+
+        int alphaStart = alpha;
+        int best = -(CELLS + 1) * SCORE_SCALE;
+        int bestColumn = -1;
+        while (Bitboard move = sorter.next()) {
+            Position child = p;
+            child.playMove(move);
+            int score = -negamax(child, -beta, -alpha, depth - 1, worker);
+            if (stopped()) return 0;
+            if (score > best) {
+                best = score;
+                bestColumn = columnOf(move);
+            }
+            if (score >= beta) {
+                table.store(key, score, depth, SolverTable::LOWER, bestColumn);
+                return score;
+            }
+            alpha = std::max(alpha, score);
+        }
+        table.store(key, best, depth, best > alphaStart ? SolverTable::EXACT : SolverTable::UPPER, bestColumn);
+        return best;
+    }
+
+    void finish(SearchResult& result, Clock::time_point start, long nodesBefore) const {
+        result.nodes = nodes - nodesBefore;
+        result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    SolverTable table;
+    ThreadPool pool;
+    const OpeningBook* book = nullptr;
+    const std::atomic<bool>* abortFlag = nullptr;
+    std::atomic<long> nodes{0};
+    std::atomic<bool> stopping{false};
+    Clock::time_point deadline = Clock::time_point::max();
+};
@@ -0,0 +1,582 @@
+#pragma once
+
+#include "engine.hpp"
+#include "features_simd.hpp"
+#include "../common/thread_pool.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Computer player: enumerates every reachable (rotation, x) placement of the
+// current piece and of the hold alternative, scores the resulting boards with
+// heuristic features and runs a beam search over the known queue, with an
+// optional expectation over the unknown piece that follows.
+
+// Row-wise board features. A hole is an empty cell with a filled cell above it;
+// a well cell is an open empty cell whose left and right neighbours are filled
+// (the walls count as filled).
+struct BoardFeatures {
+    int aggregateHeight = 0;
+    int holes = 0;
+    int bumpiness = 0;
+    int wells = 0;
+};
+
+inline BoardFeatures computeFeatures(const Board& board) {
+    BoardFeatures f;
+    unsigned seen = 0; // columns with a filled cell at or above the current row
+    for (int y = 0; y < GRID_HEIGHT; ++y) {
+        unsigned row = board.rows[y];
+        f.holes += __builtin_popcount(seen & ~row & FULL_ROW);
+        seen |= row;
+        f.aggregateHeight += __builtin_popcount(seen);
+        f.bumpiness += __builtin_popcount((seen ^ (seen >> 1)) & (FULL_ROW >> 1));
+        unsigned leftFilled = (row << 1) | 1u;
+        unsigned rightFilled = (row >> 1) | (1u << (GRID_WIDTH - 1));
+        f.wells += __builtin_popcount(~seen & leftFilled & rightFilled & FULL_ROW);
+    }
+    return f;
+}
+
+struct EvalWeights {
+    double aggregateHeight = -0.510066;
+    double linesCleared = 0.760666;
+    double holes = -0.35663;
+    double bumpiness = -0.184483;
+    double wells = -0.1;
+};
+
+inline double evaluateFeatures(const BoardFeatures& f, const EvalWeights& w) {
+    return w.aggregateHeight * f.aggregateHeight + w.holes * f.holes +
+           w.bumpiness * f.bumpiness + w.wells * f.wells;
+}
+
+const double LOSS_SCORE = -1e9;
+
+// Weight files hold one "name value" pair per line; missing names keep their default
+inline bool loadEvalWeights(const std::string& path, EvalWeights& w) {
+    std::ifstream in(path);
+    if (!in) return false;
+    std::string name;
+    double value;
+    while (in >> name >> value) {
+        if (name == "aggregateHeight") w.aggregateHeight = value;
+        else if (name == "linesCleared") w.linesCleared = value;
+        else if (name == "holes") w.holes = value;
+        else if (name == "bumpiness") w.bumpiness = value;
+        else if (name == "wells") w.wells = value;
+        else return false;
+    }
+    return in.eof();
+}
+
+inline bool saveEvalWeights(const std::string& path, const EvalWeights& w) {
+    std::ofstream out(path);
+    out.precision(17);
+    out << "aggregateHeight " << w.aggregateHeight << "\n"
+        << "linesCleared " << w.linesCleared << "\n"
+        << "holes " << w.holes << "\n"
+        << "bumpiness " << w.bumpiness << "\n"
+        << "wells " << w.wells << "\n";
+    return static_cast<bool>(out);
+}
+
+// A final resting position and the key presses that reach it from spawn
+struct Placement {
+    bool useHold = false;
+    int rotations = 0; // rotate presses before moving
+    int moveX = 0;     // horizontal presses after rotating, negative = left
+    Tetrimino piece = Tetrimino(0);
+};
+
+// Every position reachable from `start` by rotating, shifting sideways and hard dropping
+inline void generatePlacements(const Board& board, const Tetrimino& start, std::vector<Placement>& out) {
+    Tetrimino t = start;
+    if (!isValidPosition(t, board)) return;
+    std::uint32_t seenKeys[48];
+    int seenCount = 0;
+
+    auto addDrop = [&](Tetrimino m, int rotations, int moveX) {
+        m.y = board.landingY(m);
+        // Different rotations of I, S and Z can rest on the same cells
+        std::uint32_t cells[4];
+        auto blocks = getBlockPositions(m);
+        for (int i = 0; i < 4; ++i)
+            cells[i] = static_cast<std::uint32_t>((blocks[i].y + 4) * GRID_WIDTH + blocks[i].x);
+        std::sort(cells, cells + 4);
+        std::uint32_t key = cells[0] | cells[1] << 8 | cells[2] << 16 | cells[3] << 24;
+        for (int i = 0; i < seenCount; ++i)
+            if (seenKeys[i] == key) return;
+        if (seenCount < 48) seenKeys[seenCount++] = key;
+        Placement p;
+        p.rotations = rotations;
+        p.moveX = moveX;
+        p.piece = m;
+        out.push_back(p);
+    };
+
+    int rotationCount = t.shapeIndex == O_PIECE ? 1 : 4;
+    for (int r = 0; r < rotationCount; ++r) {
+        if (r > 0) {
+            int before = t.rotation;
+            rotateTetrimino(t, board);
+            if (t.rotation == before) break; // blocked, later rotations are unreachable too
+        }
+        addDrop(t, r, 0);
+        Tetrimino m = t;
+        for (int dx = -1;; --dx) {
+            m.x--;
+            if (!isValidPosition(m, board)) break;
+            addDrop(m, r, dx);
+        }
+        m = t;
+        for (int dx = 1;; ++dx) {
+            m.x++;
+            if (!isValidPosition(m, board)) break;
+            addDrop(m, r, dx);
+        }
+    }
+}
+
+// Zobrist keys for every cell of the playfield
+constexpr std::uint64_t splitMix64(std::uint64_t& state) {
+    std::uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+constexpr std::array<std::array<std::uint64_t, GRID_WIDTH>, GRID_HEIGHT> buildZobristKeys() {
+    std::array<std::array<std::uint64_t, GRID_WIDTH>, GRID_HEIGHT> keys{};
+    std::uint64_t state = 0x7E7215;
+    for (int y = 0; y < GRID_HEIGHT; ++y)
+        for (int x = 0; x < GRID_WIDTH; ++x)
+            keys[y][x] = splitMix64(state);
+    return keys;
+}
+
+constexpr std::array<std::array<std::uint64_t, GRID_WIDTH>, GRID_HEIGHT> ZOBRIST_KEYS = buildZobristKeys();
+
+// Keys of the cells in rows [0, lastRow]
+inline std::uint64_t hashRows(const Board& board, int lastRow) {
+    std::uint64_t hash = 0;
+    for (int y = 0; y <= lastRow; ++y)
+        for (unsigned row = board.rows[y]; row; row &= row - 1)
+            hash ^= ZOBRIST_KEYS[y][__builtin_ctz(row)];
+    return hash;
+}
+
+inline std::uint64_t hashBoard(const Board& board) {
+    // The constant keeps the empty board away from the zeroed table
+    return 0x9E3779B97F4A7C15ull ^ hashRows(board, GRID_HEIGHT - 1);
+}
+
+// Lock the piece on a copy of the board and clear full rows; false if it tops out
+inline bool applyPlacement(Board& board, const Tetrimino& piece, int& lines) {
+    for (const auto& pos : getBlockPositions(piece))
+        if (pos.y < 0) return false;
+    board.place(piece);
+    std::uint32_t full = board.fullRows();
+    lines = __builtin_popcount(full);
+    if (full) board.clearRows(full);
+    return true;
+}
+
+// Same, keeping `hash` equal to hashBoard(board) without rehashing the whole
+// board: the piece's cells are XORed in, and a clear only rehashes the rows
+// at or above the lowest cleared one, the only rows that change
+inline bool applyPlacement(Board& board, const Tetrimino& piece, int& lines, std::uint64_t& hash) {
+    auto blocks = getBlockPositions(piece);
+    for (const auto& pos : blocks)
+        if (pos.y < 0) return false;
+    board.place(piece);
+    for (const auto& pos : blocks) hash ^= ZOBRIST_KEYS[pos.y][pos.x];
+    std::uint32_t full = board.fullRows();
+    lines = __builtin_popcount(full);
+    if (full) {
+        int lowest = 31 - __builtin_clz(full);
+        hash ^= hashRows(board, lowest);
+        board.clearRows(full);
+        hash ^= hashRows(board, lowest);
+    }
+    return true;
+}
+
+// The computeFeatures() part of one lane of a batch
+inline BoardFeatures featuresAt(const FeatureBatch& batch, int lane) {
+    BoardFeatures f;
+    f.aggregateHeight = batch.aggregateHeight[lane];
+    f.holes = batch.holes[lane];
+    f.bumpiness = batch.bumpiness[lane];
+    f.wells = batch.wells[lane];
+    return f;
+}
+
+// One-piece greedy choice for the current piece only, no hold and no search.
+// Far weaker than TetrisAI but cheap enough to play thousands of games per
+// second, which is what weight tuning needs.
+inline bool greedyPlacement(const Board& board, const Tetrimino& current, const EvalWeights& weights,
+                            std::vector<Placement>& scratch, Placement& best) {
+    scratch.clear();
+    generatePlacements(board, current, scratch);
+    double bestScore = LOSS_SCORE;
+    bool found = false;
+
+    // Without SIMD the batch kernel is slower than one board at a time
+    if (bestFeatureIsa() == FeatureIsa::Scalar) {
+        for (const Placement& p : scratch) {
+            Board next = board;
+            int cleared = 0;
+            if (!applyPlacement(next, p.piece, cleared)) continue;
+            double score = evaluateFeatures(computeFeatures(next), weights) + weights.linesCleared * cleared;
+            if (!found || score > bestScore) {
+                bestScore = score;
+                best = p;
+                found = true;
+            }
+        }
+        return found;
+    }
+
+    // Candidate boards are scored FEATURE_BATCH at a time by the SIMD kernel
+    BoardBatch batch;
+    FeatureBatch features;
+    int lines[FEATURE_BATCH];
+    int placementIndex[FEATURE_BATCH];
+    int filled = 0;
+    auto scoreBatch = [&]() {
+        computeFeatureBatch(batch, features);
+        for (int lane = 0; lane < filled; ++lane) {
+            double score = evaluateFeatures(featuresAt(features, lane), weights) + weights.linesCleared * lines[lane];
+            if (!found || score > bestScore) {
+                bestScore = score;
+                best = scratch[placementIndex[lane]];
+                found = true;
+            }
+        }
+        filled = 0;
+    };
+    for (size_t i = 0; i < scratch.size(); ++i) {
+        Board next = board;
+        if (!applyPlacement(next, scratch[i].piece, lines[filled])) continue;
+        batch.set(filled, next);
+        placementIndex[filled] = static_cast<int>(i);
+        if (++filled == FEATURE_BATCH) scoreBatch();
+    }
+    if (filled) scoreBatch();
+    return found;
+}
+
+// Lock-free cache of board values shared by all search threads. Each entry
+// stores key ^ data next to data, so a torn write reads back as a miss.
+class TranspositionTable {
+public:
+    explicit TranspositionTable(std::size_t entriesLog2 = 20)
+        : mask((std::size_t(1) << entriesLog2) - 1), entries(new Entry[mask + 1]) {
+        clear();
+    }
+
+    void clear() {
+        for (std::size_t i = 0; i <= mask; ++i) {
+            entries[i].check.store(0, std::memory_order_relaxed);
+            entries[i].data.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    bool probe(std::uint64_t key, double& value) const {
+        const Entry& e = entries[key & mask];
+        std::uint64_t data = e.data.load(std::memory_order_relaxed);
+        if ((e.check.load(std::memory_order_relaxed) ^ data) != key) return false;
+        std::memcpy(&value, &data, sizeof(value));
+        return true;
+    }
+
+    void store(std::uint64_t key, double value) {
+        std::uint64_t data;
+        std::memcpy(&data, &value, sizeof(data));
+        Entry& e = entries[key & mask];
+        e.data.store(data, std::memory_order_relaxed);
+        e.check.store(key ^ data, std::memory_order_relaxed);
+    }
+
+private:
+    struct Entry {
+        std::atomic<std::uint64_t> check;
+        std::atomic<std::uint64_t> data;
+    };
+    std::size_t mask;
+    std::unique_ptr<Entry[]> entries;
+};
+
+struct AiConfig {
+    int beamWidth = 16;
+    bool lookahead = true; // average the best reply over the 7 possible pieces after the queue
+    unsigned threads = 0;  // 0 = all hardware threads
+    int tableLog2 = 20;
+    EvalWeights weights;
+};
+
+struct AiStats {
+    long evaluations = 0;
+    long tableHits = 0;
+};
+
+class TetrisAI {
+public:
+    explicit TetrisAI(const AiConfig& config_ = AiConfig())
+        : config(config_), pool(config_.threads), table(config_.tableLog2) {}
+
+    const AiConfig& getConfig() const { return config; }
+    AiStats getStats() const { return {evaluations.load(), tableHits.load()}; }
+    unsigned getThreadCount() const { return pool.size(); }
+
+    // Best placement for the engine's current piece; false when every move loses
+    bool decide(const TetrisEngine& engine, Placement& best) {
+        const Tetrimino* held = engine.getHeld();
+        return decide(engine.getGrid(), engine.getCurrent(), engine.getNext().shapeIndex,
+                      held ? held->shapeIndex : -1, engine.getCanHold(), best);
+    }
+
+    bool decide(const Board& board, int current, int next, int hold, bool canHold, Placement& best) {
+        return decide(board, Tetrimino(current), next, hold, canHold, best);
+    }
+
+    // `current` may already have moved or fallen since it spawned
+    bool decide(const Board& board, const Tetrimino& current, int next, int hold, bool canHold, Placement& best) {
+        queue[0] = current.shapeIndex;
+        queue[1] = next;
+        currentStart = current;
+
+        Node root;
+        root.board = board;
+        root.hash = hashBoard(board);
+        root.hold = hold;
+        root.queueIndex = 0;
+        root.lines = 0;
+        root.score = 0;
+        root.rootIndex = -1;
+
+        beam.clear();
+        beam.push_back(root);
+        rootPlacements.clear();
+
+        // Every level places exactly one piece so leaves stay comparable
+        for (int depth = 0; depth < QUEUE_SIZE && !beam.empty(); ++depth) {
+            children.clear();
+            for (const Node& node : beam)
+                expand(node, depth == 0 ? canHold : true);
+            // Static scores are independent per child, spread them over the
+            // pool a batch of children at a time
+            std::size_t groups = (children.size() + FEATURE_BATCH - 1) / FEATURE_BATCH;
+            pool.parallelFor(groups, [this](std::size_t group) {
+                std::size_t first = group * FEATURE_BATCH;
+                scoreChildren(first, std::min(children.size(), first + FEATURE_BATCH));
+            });
+            selectBeam();
+        }
+        leaves.swap(beam);
+        if (leaves.empty()) return false;
+
+        if (config.lookahead) {
+            pool.parallelFor(leaves.size(), [this](std::size_t i) {
+                Node& leaf = leaves[i];
+                leaf.score = lookaheadValue(leaf.board, leaf.hash) + config.weights.linesCleared * leaf.lines;
+            });
+        }
+
+        const Node* bestLeaf = &leaves[0];
+        for (const Node& leaf : leaves)
+            if (leaf.score > bestLeaf->score) bestLeaf = &leaf;
+        best = rootPlacements[bestLeaf->rootIndex];
+        return bestLeaf->score > LOSS_SCORE;
+    }
+
+private:
+    // Current and next are all the engine shows, so the beam is two pieces
+    // deep and the lookahead adds the one expectation layer after it. A
+    // second layer would cost 7 x ~34 more greedy replies per leaf, far
+    // beyond the per-piece budget of the game window.
+    static const int QUEUE_SIZE = 2;
+    static const int UNKNOWN_PIECE = -2;
+
+    struct Node {
+        Board board;
+        std::uint64_t hash; // hashBoard(board), kept up to date by applyPlacement
+        int hold;
+        int queueIndex;
+        int lines;
+        double score;
+        int rootIndex;
+    };
+
+    void expand(const Node& node, bool canHold) {
+        if (node.queueIndex >= QUEUE_SIZE) {
+            // The queue ran out after an early hold, only the held piece is left
+            addChildren(node, Tetrimino(node.hold), UNKNOWN_PIECE, node.queueIndex, false);
+            return;
+        }
+        int piece = queue[node.queueIndex];
+        Tetrimino start = node.queueIndex == 0 ? currentStart : Tetrimino(piece);
+        addChildren(node, start, node.hold, node.queueIndex + 1, false);
+        if (!canHold) return;
+        if (node.hold < 0) {
+            // Holding into an empty slot plays the piece after this one
+            if (node.queueIndex + 1 < QUEUE_SIZE)
+                addChildren(node, Tetrimino(queue[node.queueIndex + 1]), piece, node.queueIndex + 2, true);
+        } else if (node.hold != piece) {
+            addChildren(node, Tetrimino(node.hold), piece, node.queueIndex + 1, true);
+        }
+    }
+
+    void addChildren(const Node& node, const Tetrimino& start, int hold, int queueIndex, bool useHold) {
+        placements.clear();
+        generatePlacements(node.board, start, placements);
+        for (Placement& p : placements) {
+            Node child;
+            child.board = node.board;
+            child.hash = node.hash;
+            int lines = 0;
+            if (!applyPlacement(child.board, p.piece, lines, child.hash)) continue;
+            child.hold = hold;
+            child.queueIndex = queueIndex;
+            child.lines = node.lines + lines;
+            child.score = 0;
+            if (node.rootIndex < 0) {
+                p.useHold = useHold;
+                child.rootIndex = static_cast<int>(rootPlacements.size());
+                rootPlacements.push_back(p);
+            } else {
+                child.rootIndex = node.rootIndex;
+            }
+            children.push_back(child);
+        }
+    }
+
+    void selectBeam() {
+        std::size_t keep = std::min(children.size(), static_cast<std::size_t>(config.beamWidth));
+        std::partial_sort(children.begin(), children.begin() + keep, children.end(),
+                          [](const Node& a, const Node& b) { return a.score > b.score; });
+        beam.assign(children.begin(), children.begin() + keep);
+    }
+
+    // Static scores of children [first, last), at most FEATURE_BATCH: table
+    // hits are used as they are, the misses go through the batch kernel
+    // together and are stored afterwards
+    void scoreChildren(std::size_t first, std::size_t last) {
+        if (bestFeatureIsa() == FeatureIsa::Scalar) {
+            // Without SIMD the batch kernel is slower than one board at a time
+            for (std::size_t i = first; i < last; ++i)
+                children[i].score =
+                    staticValue(children[i].board, children[i].hash) + config.weights.linesCleared * children[i].lines;
+            return;
+        }
+        BoardBatch batch;
+        FeatureBatch features;
+        std::uint64_t keys[FEATURE_BATCH];
+        std::size_t missed[FEATURE_BATCH];
+        int filled = 0;
+        for (std::size_t i = first; i < last; ++i) {
+            Node& child = children[i];
+            evaluations.fetch_add(1, std::memory_order_relaxed);
+            std::uint64_t key = child.hash;
+            double value;
+            if (table.probe(key, value)) {
+                tableHits.fetch_add(1, std::memory_order_relaxed);
+                child.score = value + config.weights.linesCleared * child.lines;
+                continue;
+            }
+            batch.set(filled, child.board);
+            keys[filled] = key;
+            missed[filled++] = i;
+        }
+        if (filled == 0) return;
+        computeFeatureBatch(batch, features);
+        for (int lane = 0; lane < filled; ++lane) {
+            Node& child = children[missed[lane]];
+            double value = evaluateFeatures(featuresAt(features, lane), config.weights);
+            table.store(keys[lane], value);
+            child.score = value + config.weights.linesCleared * child.lines;
+        }
+    }
+
+    // `key` is hashBoard(board)
+    double staticValue(const Board& board, std::uint64_t key) {
+        evaluations.fetch_add(1, std::memory_order_relaxed);
+        double value;
+        if (table.probe(key, value)) {
+            tableHits.fetch_add(1, std::memory_order_relaxed);
+            return value;
+        }
+        value = evaluateFeatures(computeFeatures(board), config.weights);
+        table.store(key, value);
+        return value;
+    }
+
+    // Expected value of the best greedy reply over the 7 equally likely next pieces
+    double lookaheadValue(const Board& board, std::uint64_t hash) {
+        const std::uint64_t LOOKAHEAD_SALT = 0x5DEECE66Dull;
+        std::uint64_t key = hash ^ LOOKAHEAD_SALT;
+        double value;
+        if (table.probe(key, value)) {
+            tableHits.fetch_add(1, std::memory_order_relaxed);
+            return value;
+        }
+        thread_local std::vector<Placement> replies;
+        double total = 0;
+        for (int shape = 0; shape < 7; ++shape) {
+            replies.clear();
+            generatePlacements(board, Tetrimino(shape), replies);
+            double bestReply = LOSS_SCORE;
+            for (const Placement& p : replies) {
+                Board next = board;
+                std::uint64_t nextHash = hash;
+                int lines = 0;
+                if (!applyPlacement(next, p.piece, lines, nextHash)) continue;
+                bestReply = std::max(bestReply, staticValue(next, nextHash) + config.weights.linesCleared * lines);
+            }
+            total += bestReply;
+        }
+        value = total / 7;
+        table.store(key, value);
+        return value;
+    }
+
+    AiConfig config;
+    ThreadPool pool;
+    TranspositionTable table;
+    std::atomic<long> evaluations{0};
+    std::atomic<long> tableHits{0};
+    int queue[QUEUE_SIZE];
+    Tetrimino currentStart = Tetrimino(0);
+    std::vector<Node> beam;
+    std::vector<Node> children;
+    std::vector<Node> leaves;
+    std::vector<Placement> placements;
+    std::vector<Placement> rootPlacements;
+};
+
+// Feed the key presses of a placement to the engine within the current frame
+inline void executePlacement(TetrisEngine& engine, const Placement& placement) {
+    EngineInput press;
+    if (placement.useHold) {
+        press.hold = true;
+        engine.step(press, 0);
+        press.hold = false;
+    }
+    press.rotate = true;
+    for (int i = 0; i < placement.rotations; ++i) engine.step(press, 0);
+    press.rotate = false;
+    press.left = placement.moveX < 0;
+    press.right = placement.moveX > 0;
+    for (int i = 0; i < std::abs(placement.moveX); ++i) engine.step(press, 0);
+    press.left = press.right = false;
+    press.hardDrop = true;
+    engine.step(press, 0);
+}
@@ -0,0 +1,314 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// Game logic shared by the SFML front-end and the headless tools.
+// Nothing in here may depend on SFML.
+
+const int GRID_WIDTH = 10;
+const int GRID_HEIGHT = 20;
+
+// Update Tetrimino shapes to include all standard Tetris pieces
+constexpr std::array<std::array<int, 4>, 7> TETRIMINOS = {{
+    {1, 3, 5, 7}, // I
+    {2, 4, 5, 7}, // Z
+    {3, 5, 4, 6}, // S
+    {3, 5, 4, 7}, // T
+    {2, 3, 5, 7}, // L
+    {3, 5, 7, 6}, // J
+    {2, 3, 4, 5}  // O
+}};
+const int O_PIECE = 6;
+const std::uint8_t GARBAGE_CELL = 8; // colour of garbage rows in versus play
+
+struct Tetrimino
+{
+    int shapeIndex;
+    int rotation; // 0, 1, 2, 3
+    int x, y;
+    Tetrimino(int shapeIndex_) : shapeIndex(shapeIndex_), rotation(0), x(GRID_WIDTH / 2 - 1), y(0) {}
+};
+
+struct Cell
+{
+    int x, y;
+};
+
+// One bit per column: bit x is set when cell (x, y) is occupied
+typedef std::uint16_t RowBits;
+const RowBits FULL_ROW = (1u << GRID_WIDTH) - 1;
+
+const int MAX_KICKS = 5;
+
+// Everything placement code needs to know about one piece in one rotation.
+// Offsets are relative to Tetrimino::x/y; the row masks are relative to the
+// top-left corner of the bounding box.
+struct PieceRotation
+{
+    std::array<Cell, 4> blocks;
+    int minX, maxX, minY, maxY;
+    std::array<RowBits, 4> rows;
+    std::array<int, 4> columnBottoms; // lowest block offset in each column from minX, used for drops
+    int kickCount;
+    std::array<Cell, MAX_KICKS> kicks; // tried in order when rotating into this rotation fails
+};
+
+constexpr std::array<std::array<PieceRotation, 4>, 7> buildPieceTable()
+{
+    std::array<std::array<PieceRotation, 4>, 7> table{};
+    for (int shape = 0; shape < 7; ++shape)
+    {
+        for (int rotation = 0; rotation < 4; ++rotation)
+        {
+            PieceRotation &r = table[shape][rotation];
+            for (int i = 0; i < 4; ++i)
+            {
+                int px = TETRIMINOS[shape][i] % 2;
+                int py = TETRIMINOS[shape][i] / 2;
+                // Rotate around (1,1) as pivot
+                for (int n = 0; n < rotation; ++n)
+                {
+                    int tmp = px;
+                    px = 1 - (py - 1);
+                    py = tmp;
+                }
+                r.blocks[i] = Cell{px, py};
+            }
+            r.minX = r.maxX = r.blocks[0].x;
+            r.minY = r.maxY = r.blocks[0].y;
+            for (const Cell &b : r.blocks)
+            {
+                r.minX = b.x < r.minX ? b.x : r.minX;
+                r.maxX = b.x > r.maxX ? b.x : r.maxX;
+                r.minY = b.y < r.minY ? b.y : r.minY;
+                r.maxY = b.y > r.maxY ? b.y : r.maxY;
+            }
+            for (const Cell &b : r.blocks)
+                r.rows[b.y - r.minY] |= static_cast<RowBits>(1u << (b.x - r.minX));
+            for (int &bottom : r.columnBottoms)
+                bottom = -1;
+            for (const Cell &b : r.blocks)
+                r.columnBottoms[b.x - r.minX] = b.y > r.columnBottoms[b.x - r.minX] ? b.y : r.columnBottoms[b.x - r.minX];
+
+            // The O piece never rotates, the others share the same wall kicks
+            if (shape != O_PIECE)
+            {
+                r.kickCount = MAX_KICKS;
+                r.kicks = {{{-1, 0}, {1, 0}, {0, -1}, {-2, 0}, {2, 0}}};
+            }
+        }
+    }
+    return table;
+}
+
+constexpr std::array<std::array<PieceRotation, 4>, 7> PIECE_TABLE = buildPieceTable();
+
+static_assert(PIECE_TABLE[0][1].maxX - PIECE_TABLE[0][1].minX == 3, "I piece must lie flat after one rotation");
+static_assert(PIECE_TABLE[O_PIECE][0].kickCount == 0, "O piece has no kicks");
+static_assert(PIECE_TABLE[0][0].columnBottoms[0] == 3, "vertical I piece reaches three rows below its pivot");
+
+inline const PieceRotation &pieceRotation(const Tetrimino &t)
+{
+    return PIECE_TABLE[t.shapeIndex][t.rotation];
+}
+
+// Helper to get rotated block positions
+inline std::array<Cell, 4> getBlockPositions(const Tetrimino &t)
+{
+    const PieceRotation &r = pieceRotation(t);
+    std::array<Cell, 4> positions;
+    for (int i = 0; i < 4; ++i)
+        positions[i] = Cell{t.x + r.blocks[i].x, t.y + r.blocks[i].y};
+    return positions;
+}
+
+// Packed playfield: occupancy as one bitmask per row, colours in a parallel plane
+struct Board
+{
+    std::array<RowBits, GRID_HEIGHT> rows{};
+    std::array<std::array<std::uint8_t, GRID_WIDTH>, GRID_HEIGHT> colors{}; // 0 = empty, shapeIndex + 1 or GARBAGE_CELL otherwise
+    std::uint32_t dirtyRows = ~0u; // rows changed since the renderer last looked (bit y for row y)
+    // Topmost occupied row of each column, GRID_HEIGHT when the column is empty
+    std::array<std::int8_t, GRID_WIDTH> surface = makeEmptySurface();
+
+    static constexpr std::array<std::int8_t, GRID_WIDTH> makeEmptySurface()
+    {
+        std::array<std::int8_t, GRID_WIDTH> empty{};
+        for (auto &y : empty)
+            y = GRID_HEIGHT;
+        return empty;
+    }
+
+    int cell(int x, int y) const { return colors[y][x]; }
+
+    void reset()
+    {
+        rows.fill(0);
+        for (auto &row : colors)
+            row.fill(0);
+        surface = makeEmptySurface();
+        dirtyRows = ~0u;
+    }
+
+    // Rows above the top of the board are open, walls and floor are solid
+    bool collides(const Tetrimino &t) const
+    {
+        const PieceRotation &m = pieceRotation(t);
+        int left = t.x + m.minX;
+        if (left < 0 || t.x + m.maxX >= GRID_WIDTH || t.y + m.maxY >= GRID_HEIGHT)
+            return true;
+        int top = t.y + m.minY;
+        for (int i = 0; i <= m.maxY - m.minY; ++i)
+        {
+            int y = top + i;
+            if (y >= 0 && (rows[y] & (m.rows[i] << left)))
+                return true;
+        }
+        return false;
+    }
+
+    void place(const Tetrimino &t)
+    {
+        for (const auto &pos : getBlockPositions(t))
+        {
+            if (pos.y < 0)
+                continue;
+            rows[pos.y] |= static_cast<RowBits>(1u << pos.x);
+            colors[pos.y][pos.x] = static_cast<std::uint8_t>(t.shapeIndex + 1);
+            dirtyRows |= 1u << pos.y;
+            if (pos.y < surface[pos.x])
+                surface[pos.x] = static_cast<std::int8_t>(pos.y);
+        }
+    }
+
+    // Row the piece comes to rest on when dropped straight down (its final y).
+    // Constant time while the piece is above the surface of every column it
+    // covers; a piece tucked under an overhang falls back to stepping down.
+    int landingY(const Tetrimino &t) const
+    {
+        const PieceRotation &m = pieceRotation(t);
+        int landing = GRID_HEIGHT;
+        for (int i = 0; i <= m.maxX - m.minX; ++i)
+        {
+            int x = t.x + m.minX + i;
+            if (t.y + m.columnBottoms[i] >= surface[x])
+                return steppedLandingY(t);
+            int rest = surface[x] - 1 - m.columnBottoms[i];
+            landing = rest < landing ? rest : landing;
+        }
+        return landing;
+    }
+
+    int steppedLandingY(Tetrimino t) const
+    {
+        do
+            t.y++;
+        while (!collides(t));
+        return t.y - 1;
+    }
+
+    // Bit y is set for every complete row
+    std::uint32_t fullRows() const
+    {
+        std::uint32_t full = 0;
+        for (int y = 0; y < GRID_HEIGHT; ++y)
+            full |= static_cast<std::uint32_t>(rows[y] == FULL_ROW) << y;
+        return full;
+    }
+
+    // Remove the rows in `mask` in place, shifting the rows above down
+    void clearRows(std::uint32_t mask)
+    {
+        if (!mask)
+            return;
+        // Every row above the lowest cleared one moves
+        dirtyRows |= (2u << (31 - __builtin_clz(mask))) - 1;
+        int dest = GRID_HEIGHT - 1;
+        for (int y = GRID_HEIGHT - 1; y >= 0; --y)
+        {
+            if (mask & (1u << y))
+                continue;
+            if (dest != y)
+            {
+                rows[dest] = rows[y];
+                colors[dest] = colors[y];
+            }
+            --dest;
+        }
+        for (; dest >= 0; --dest)
+        {
+            rows[dest] = 0;
+            colors[dest].fill(0);
+        }
+        updateSurface();
+    }
+
+    // Push the stack up one row and fill the bottom row except for `hole`.
+    // Returns false when a filled cell is pushed off the top.
+    bool raiseGarbageRow(int hole)
+    {
+        bool fits = rows[0] == 0;
+        for (int y = 0; y < GRID_HEIGHT - 1; ++y)
+        {
+            rows[y] = rows[y + 1];
+            colors[y] = colors[y + 1];
+        }
+        rows[GRID_HEIGHT - 1] = static_cast<RowBits>(FULL_ROW & ~(1u << hole));
+        colors[GRID_HEIGHT - 1].fill(GARBAGE_CELL);
+        colors[GRID_HEIGHT - 1][hole] = 0;
+        dirtyRows = ~0u;
+        updateSurface();
+        return fits;
+    }
+
+    // Rebuild the column heights from the rows, top down, stopping once every column is covered
+    void updateSurface()
+    {
+        surface = makeEmptySurface();
+        RowBits seen = 0;
+        for (int y = 0; y < GRID_HEIGHT && seen != FULL_ROW; ++y)
+        {
+            for (RowBits fresh = rows[y] & ~seen; fresh; fresh &= fresh - 1)
+                surface[__builtin_ctz(fresh)] = static_cast<std::int8_t>(y);
+            seen |= rows[y];
+        }
+    }
+};
+
+inline bool isValidPosition(const Tetrimino &tetrimino, const Board &board)
+{
+    return !board.collides(tetrimino);
+}
+
+inline void placeTetrimino(const Tetrimino &tetrimino, Board &board)
+{
+    board.place(tetrimino);
+}
+
+inline void rotateTetrimino(Tetrimino &tetrimino, const Board &grid)
+{
+    // Do not rotate the O (square) piece
+    if (tetrimino.shapeIndex == O_PIECE)
+        return;
+    Tetrimino temp = tetrimino;
+    temp.rotation = (temp.rotation + 1) % 4;
+    if (isValidPosition(temp, grid))
+    {
+        tetrimino = temp;
+        return;
+    }
+    const PieceRotation &target = pieceRotation(temp);
+    for (int i = 0; i < target.kickCount; ++i)
+    {
+        Tetrimino kicked = temp;
+        kicked.x += target.kicks[i].x;
+        kicked.y += target.kicks[i].y;
+        if (isValidPosition(kicked, grid))
+        {
+            tetrimino = kicked;
+            return;
+        }
+    }
+    // If all fail, do not rotate
+}
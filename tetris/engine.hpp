@@ -0,0 +1,358 @@
+#pragma once
+
+#include "board.hpp"
+#include "../common/rng.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+// Window-free Tetris rules: gravity, locking, line clears, scoring, hold and
+// level progression. The SFML front-end and the headless tools both drive it
+// through step().
+//
+// Time advances in fixed ticks, never in wall-clock seconds, so a game is
+// fully determined by its seed and the inputs applied at each tick.
+
+const int TICK_RATE = 120; // ticks per second
+const float TICK_SECONDS = 1.0f / TICK_RATE;
+const int LINES_PER_LEVEL = 10;
+const int CLEAR_ANIM_TICKS = 18;          // 0.15 s
+const int INITIAL_FALL_DELAY_TICKS = 60;  // 0.5 s
+const int MIN_FALL_DELAY_TICKS = 6;       // 0.05 s
+const int FALL_DELAY_STEP_TICKS = 6;      // 0.05 s de moins par niveau
+// In high-gravity mode, levels past this one fall every tick and the number of
+// rows per tick doubles each level until pieces drop instantly (20G)
+const int HIGH_GRAVITY_LEVEL = 10;
+// Versus play: garbage rows sent for clearing 0, 1, 2, 3 or 4 lines at once
+const int GARBAGE_ATTACK[5] = {0, 0, 1, 2, 4};
+const float CLEAR_ANIM_DURATION = CLEAR_ANIM_TICKS * TICK_SECONDS; // seconds
+
+// Système de score amélioré
+struct ScoreSystem {
+    // Points pour les lignes complétées (selon niveau)
+    int getSingleLineClear(int level) const { return 100 * level; }
+    int getDoubleLineClear(int level) const { return 300 * level; }
+    int getTripleLineClear(int level) const { return 500 * level; }
+    int getTetrisLineClear(int level) const { return 800 * level; } // Bonus pour Tetris (4 lignes)
+
+    // Points par cellule descendue
+    int getSoftDropPoints() const { return 1; }     // 1 point par cellule en soft drop
+    int getHardDropPoints() const { return 2; }     // 2 points par cellule en hard drop
+
+    int getLinesClearPoints(int numLines, int level) const {
+        switch(numLines) {
+            case 1: return getSingleLineClear(level);
+            case 2: return getDoubleLineClear(level);
+            case 3: return getTripleLineClear(level);
+            case 4: return getTetrisLineClear(level);
+            default: return 0;
+        }
+    }
+};
+
+// Actions requested for one step, applied in declaration order
+struct EngineInput {
+    bool hold = false;
+    bool rotate = false;
+    bool left = false;
+    bool right = false;
+    bool softDrop = false;
+    bool hardDrop = false;
+
+    // One bit per action, in declaration order; used by input logs
+    std::uint8_t toBits() const {
+        return static_cast<std::uint8_t>(hold | rotate << 1 | left << 2 | right << 3 | softDrop << 4 | hardDrop << 5);
+    }
+    static EngineInput fromBits(std::uint8_t bits) {
+        EngineInput input;
+        input.hold = bits & 1;
+        input.rotate = bits & 2;
+        input.left = bits & 4;
+        input.right = bits & 8;
+        input.softDrop = bits & 16;
+        input.hardDrop = bits & 32;
+        return input;
+    }
+    bool any() const { return toBits() != 0; }
+};
+
+// An input applied before tick `tick` was simulated
+struct InputEvent {
+    std::uint32_t tick;
+    std::uint8_t keys;
+};
+
+// 16 bytes, so a copy of the whole game stays small
+typedef Pcg32 PieceRng;
+
+// Everything that decides how a game continues. It is trivially copyable, so
+// a game can be saved and restored with a plain copy, e.g. every tick for
+// rollback netcode.
+struct EngineState {
+    unsigned gameSeed = 0;
+    PieceRng rng;
+    Board grid;
+    Tetrimino currentTetrimino = Tetrimino(0);
+    Tetrimino nextTetrimino = Tetrimino(0);
+    Tetrimino heldTetrimino = Tetrimino(0);
+    bool hasHeld = false;
+    bool canHold = true;
+    int score = 0;
+    int level = 1;
+    int linesCleared = 0;
+    long piecesPlaced = 0;
+    bool highGravity = false;
+    int fallDelay = INITIAL_FALL_DELAY_TICKS; // ticks
+    int rowsPerFall = 1;
+    int fallTimer = 0;      // ticks
+    std::uint32_t clearingRows = 0;
+    int clearAnimTimer = 0; // ticks
+    std::uint32_t tick = 0;
+    bool gameOver = false;
+    std::array<std::int8_t, GRID_HEIGHT> garbageHoles{}; // oldest first
+    int garbagePending = 0;
+    int garbageOut = 0;
+};
+
+static_assert(std::is_trivially_copyable<EngineState>::value, "engine state must be copyable as raw bytes");
+
+class TetrisEngine : private EngineState {
+public:
+    explicit TetrisEngine(unsigned seed = 0) {
+        reset(seed);
+    }
+
+    // Snapshot of the game; loadState() puts it back. The recorder and the
+    // high gravity setting are not part of it.
+    const EngineState& saveState() const { return *this; }
+    void loadState(const EngineState& saved) {
+        static_cast<EngineState&>(*this) = saved;
+        grid.dirtyRows = ~0u; // the renderer must redraw everything
+    }
+
+    void reset(unsigned seed) {
+        gameSeed = seed;
+        rng.seed(seed, STREAM_GAMEPLAY);
+        grid.reset();
+        currentTetrimino = Tetrimino(randomShape());
+        nextTetrimino = Tetrimino(randomShape());
+        heldTetrimino = Tetrimino(0);
+        hasHeld = false;
+        canHold = true;
+        score = 0;
+        level = 1;
+        linesCleared = 0;
+        piecesPlaced = 0;
+        highGravity = highGravityMode;
+        fallDelay = INITIAL_FALL_DELAY_TICKS;
+        rowsPerFall = 1;
+        fallTimer = 0;
+        clearingRows = 0;
+        clearAnimTimer = 0;
+        tick = 0;
+        gameOver = false;
+        garbagePending = 0;
+        garbageOut = 0;
+        if (recording) recording->clear();
+    }
+
+    // Apply the input, then advance gravity and the line clear animation by
+    // `ticks` fixed ticks. ticks = 0 applies a key press between two ticks.
+    void step(const EngineInput& input, int ticks = 1) {
+        if (gameOver) return;
+        if (recording && input.any()) recording->push_back(InputEvent{tick, input.toBits()});
+        applyInput(input);
+        for (int i = 0; i < ticks && !gameOver; ++i) advance();
+    }
+
+    // High gravity changes the game, so it is part of a recorded log; it takes
+    // effect from the next reset()
+    void setHighGravity(bool enabled) { highGravityMode = enabled; }
+    bool getHighGravity() const { return highGravity; } // mode of the current game
+
+    // Every non-empty input passed to step() is appended to `log` until the
+    // recorder is removed with nullptr. reset() clears the log.
+    void setRecorder(std::vector<InputEvent>* log) { recording = log; }
+
+    // Versus play: queue `lines` garbage rows with a hole in `holeColumn`. They
+    // rise under the stack when the next piece locks without clearing a line;
+    // line clears cancel queued rows before attacking.
+    void addGarbage(int lines, int holeColumn) {
+        for (int i = 0; i < lines && garbagePending < GRID_HEIGHT; ++i)
+            garbageHoles[garbagePending++] = static_cast<std::int8_t>(holeColumn);
+    }
+    int getGarbagePending() const { return garbagePending; }
+    // Garbage rows this player sent since the last call
+    int takeGarbageOut() {
+        int out = garbageOut;
+        garbageOut = 0;
+        return out;
+    }
+
+    const Board& getGrid() const { return grid; }
+    const Tetrimino& getCurrent() const { return currentTetrimino; }
+    const Tetrimino& getNext() const { return nextTetrimino; }
+    // The `count` shapes that will follow the next piece, drawn from a copy of the generator
+    std::vector<int> previewShapes(int count) const {
+        PieceRng copy = rng;
+        std::vector<int> shapes;
+        for (int i = 0; i < count; ++i) shapes.push_back(static_cast<int>(copy.below(7)));
+        return shapes;
+    }
+    const Tetrimino* getHeld() const { return hasHeld ? &heldTetrimino : nullptr; }
+    bool getCanHold() const { return canHold; }
+    int getScore() const { return score; }
+    int getLevel() const { return level; }
+    int getLinesCleared() const { return linesCleared; }
+    long getPiecesPlaced() const { return piecesPlaced; }
+    unsigned getSeed() const { return gameSeed; }
+    std::uint32_t getTick() const { return tick; }
+    int getFallDelayTicks() const { return fallDelay; }
+    int getRowsPerFall() const { return rowsPerFall; }
+    float getFallDelay() const { return fallDelay * TICK_SECONDS; }
+    bool isGameOver() const { return gameOver; }
+    // Rows waiting for the clear animation to finish (bit y set for row y)
+    std::uint32_t getClearingRows() const { return clearingRows; }
+    float getClearAnimTimer() const { return clearAnimTimer * TICK_SECONDS; }
+    // Rows of the grid changed since the last call, for renderers that cache the board
+    std::uint32_t takeDirtyRows() {
+        std::uint32_t dirty = grid.dirtyRows;
+        grid.dirtyRows = 0;
+        return dirty;
+    }
+
+private:
+    int randomShape() { return static_cast<int>(rng.below(7)); }
+
+    void applyInput(const EngineInput& input) {
+        // The locked piece stays put while its lines are being cleared
+        if (clearingRows) return;
+
+        if (input.hold && canHold) {
+            if (!hasHeld) {
+                heldTetrimino = Tetrimino(currentTetrimino.shapeIndex);
+                hasHeld = true;
+                spawnNext();
+            } else {
+                std::swap(currentTetrimino.shapeIndex, heldTetrimino.shapeIndex);
+                currentTetrimino.rotation = 0;
+                currentTetrimino.x = GRID_WIDTH / 2 - 1;
+                currentTetrimino.y = 0;
+            }
+            canHold = false;  // Désactiver le hold jusqu'au prochain placement
+        }
+        if (input.rotate) {
+            Tetrimino temp = currentTetrimino;
+            rotateTetrimino(temp, grid);
+            if (isValidPosition(temp, grid)) currentTetrimino = temp;
+        }
+        if (input.left) tryMove(-1, 0);
+        if (input.right) tryMove(1, 0);
+        if (input.softDrop && tryMove(0, 1)) {
+            // Points pour soft drop
+            score += scoreSystem.getSoftDropPoints();
+        }
+        if (input.hardDrop) {
+            int dropDistance = dropCurrent(GRID_HEIGHT);
+            // Ajouter des points pour le hard drop
+            score += dropDistance * scoreSystem.getHardDropPoints();
+            lockPiece();
+        }
+    }
+
+    void advance() {
+        tick++;
+        fallTimer++;
+
+        if (clearingRows) {
+            clearAnimTimer++;
+            if (clearAnimTimer >= CLEAR_ANIM_TICKS) finishLineClear();
+        }
+        // Only process falling if not animating line clear
+        else if (fallTimer >= fallDelay) {
+            fallTimer = 0;
+            if (!dropCurrent(rowsPerFall)) lockPiece();
+        }
+    }
+
+    // Move the current piece down by up to `maxRows`, returns the rows moved
+    int dropCurrent(int maxRows) {
+        int target = std::min(grid.landingY(currentTetrimino), currentTetrimino.y + maxRows);
+        int moved = target - currentTetrimino.y;
+        currentTetrimino.y = target;
+        return moved;
+    }
+
+    bool tryMove(int dx, int dy) {
+        Tetrimino temp = currentTetrimino;
+        temp.x += dx;
+        temp.y += dy;
+        if (!isValidPosition(temp, grid)) return false;
+        currentTetrimino = temp;
+        return true;
+    }
+
+    void lockPiece() {
+        placeTetrimino(currentTetrimino, grid);
+        piecesPlaced++;
+        clearingRows = grid.fullRows();
+        clearAnimTimer = 0;
+        // If no lines to clear, continue with next piece, otherwise start animation
+        if (!clearingRows) {
+            riseGarbage();
+            if (!gameOver) spawnNext();
+        }
+    }
+
+    void riseGarbage() {
+        for (int i = 0; i < garbagePending; ++i)
+            if (!grid.raiseGarbageRow(garbageHoles[i])) gameOver = true;
+        garbagePending = 0;
+    }
+
+    void finishLineClear() {
+        int numLinesCleared = 0;
+        for (std::uint32_t rows = clearingRows; rows; rows &= rows - 1) numLinesCleared++;
+
+        // Ajouter les points selon le nombre de lignes
+        score += scoreSystem.getLinesClearPoints(numLinesCleared, level);
+        linesCleared += numLinesCleared;
+
+        // Les lignes envoyées annulent d'abord les lignes reçues en attente
+        int attack = GARBAGE_ATTACK[std::min(numLinesCleared, 4)];
+        int cancelled = std::min(attack, garbagePending);
+        std::copy(garbageHoles.begin() + cancelled, garbageHoles.begin() + garbagePending, garbageHoles.begin());
+        garbagePending -= cancelled;
+        garbageOut += attack - cancelled;
+
+        // Vérifier si on doit augmenter le niveau
+        if (linesCleared >= level * LINES_PER_LEVEL) {
+            level++;
+            // Accélérer la vitesse de chute
+            fallDelay = std::max(MIN_FALL_DELAY_TICKS, INITIAL_FALL_DELAY_TICKS - (level-1) * FALL_DELAY_STEP_TICKS);
+            if (highGravity && level > HIGH_GRAVITY_LEVEL) {
+                fallDelay = 1;
+                rowsPerFall = std::min(GRID_HEIGHT, 1 << std::min(level - HIGH_GRAVITY_LEVEL, 5));
+            }
+        }
+
+        grid.clearRows(clearingRows);
+        clearingRows = 0;
+        clearAnimTimer = 0;
+        spawnNext();
+    }
+
+    void spawnNext() {
+        currentTetrimino = nextTetrimino;
+        nextTetrimino = Tetrimino(randomShape());
+        if (!isValidPosition(currentTetrimino, grid))
+            gameOver = true;
+        canHold = true;  // Réactiver le hold pour la nouvelle pièce
+    }
+
+    ScoreSystem scoreSystem;
+    bool highGravityMode = false; // setting, copied into highGravity by reset()
+    std::vector<InputEvent>* recording = nullptr;
+};
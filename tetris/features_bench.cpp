@@ -0,0 +1,97 @@
+// Microbenchmark for the batched board feature kernels: checks every ISA
+// against computeFeatures() on the same boards, then reports boards/sec.
+
+#include "ai.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+// Mid-game looking boards: random pieces dropped at random columns, with the
+// occasional piece left floating to create holes and overhangs
+std::vector<Board> makeBoards(int count, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::vector<Board> boards(count);
+    for (Board& board : boards) {
+        int pieces = static_cast<int>(rng() % 40);
+        for (int i = 0; i < pieces; ++i) {
+            Tetrimino t(static_cast<int>(rng() % 7));
+            t.rotation = static_cast<int>(rng() % 4);
+            t.x = static_cast<int>(rng() % GRID_WIDTH);
+            t.y = 2;
+            if (!isValidPosition(t, board)) continue;
+            if (rng() % 8) t.y = board.landingY(t);
+            else t.y += static_cast<int>(rng() % 6);
+            if (!isValidPosition(t, board)) continue;
+            int lines;
+            applyPlacement(board, t, lines);
+        }
+    }
+    return boards;
+}
+
+int main(int argc, char** argv) {
+    int boardCount = argc > 1 ? std::atoi(argv[1]) : 4096;
+    int rounds = argc > 2 ? std::atoi(argv[2]) : 500;
+    if (boardCount < FEATURE_BATCH || rounds <= 0) {
+        std::printf("Usage: tetris_features_bench [BOARDS] [ROUNDS]\n");
+        return 1;
+    }
+    boardCount -= boardCount % FEATURE_BATCH;
+
+    std::vector<Board> boards = makeBoards(boardCount, 12345);
+    std::vector<BoardBatch> batches(boardCount / FEATURE_BATCH);
+    for (int i = 0; i < boardCount; ++i) batches[i / FEATURE_BATCH].set(i % FEATURE_BATCH, boards[i]);
+    std::vector<FeatureBatch> reference(batches.size());
+    for (size_t b = 0; b < batches.size(); ++b) computeFeatureBatchScalar(batches[b], reference[b]);
+
+    typedef std::chrono::steady_clock Clock;
+    double total = static_cast<double>(boardCount) * rounds;
+    volatile long sink = 0;
+
+    // Baseline: the one-board-at-a-time features used by the search
+    auto start = Clock::now();
+    for (int r = 0; r < rounds; ++r)
+        for (const Board& board : boards) {
+            BoardFeatures f = computeFeatures(board);
+            sink = sink + f.aggregateHeight + f.holes;
+        }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::printf("%-16s %12.0f boards/s\n", "single board", total / seconds);
+
+    int failures = 0;
+    const FeatureIsa isas[] = {FeatureIsa::Scalar, FeatureIsa::Sse, FeatureIsa::Avx2};
+    for (FeatureIsa isa : isas) {
+        std::string name = std::string("batch ") + featureIsaName(isa);
+        if (!featureIsaSupported(isa)) {
+            std::printf("%-16s  not supported on this CPU\n", name.c_str());
+            continue;
+        }
+
+        // Every lane must match the scalar kernel, and the shared features computeFeatures()
+        FeatureBatch out;
+        bool ok = true;
+        for (size_t b = 0; b < batches.size(); ++b) {
+            computeFeatureBatch(batches[b], out, isa);
+            ok = ok && std::memcmp(&out, &reference[b], sizeof(out)) == 0;
+            for (int lane = 0; lane < FEATURE_BATCH; ++lane) {
+                BoardFeatures f = computeFeatures(boards[b * FEATURE_BATCH + lane]);
+                ok = ok && f.aggregateHeight == out.aggregateHeight[lane] && f.holes == out.holes[lane] &&
+                     f.bumpiness == out.bumpiness[lane] && f.wells == out.wells[lane];
+            }
+        }
+        if (!ok) failures++;
+
+        start = Clock::now();
+        for (int r = 0; r < rounds; ++r)
+            for (const BoardBatch& batch : batches) {
+                computeFeatureBatch(batch, out, isa);
+                sink = sink + out.aggregateHeight[0] + out.holes[FEATURE_BATCH - 1];
+            }
+        seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        std::printf("%-16s %12.0f boards/s%s\n", name.c_str(), total / seconds, ok ? "" : "  MISMATCH");
+    }
+    return failures ? 2 : 0;
+}
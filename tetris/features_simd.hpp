@@ -0,0 +1,216 @@
+#pragma once
+
+#include "board.hpp"
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TETRIS_FEATURES_X86 1
+#endif
+
+// Batched board feature extraction. FEATURE_BATCH boards are stored
+// transposed, row y of every board next to each other, so one 256-bit AVX2
+// register holds the same row of 16 boards (two SSE registers, or a plain
+// loop for the scalar fallback) and every feature is a few lane-wise bit
+// operations and popcounts per row.
+//
+// The definitions match computeFeatures() in ai.hpp, plus:
+//  - column heights, GRID_HEIGHT minus the topmost filled row of each column
+//  - row transitions, filled/empty changes along each row with the walls
+//    counted as filled (an empty row has two)
+//
+// The kernels are compiled with per-function target attributes and picked at
+// run time, so the binary still runs on CPUs without AVX2.
+
+const int FEATURE_BATCH = 16;
+
+struct BoardBatch {
+    alignas(32) std::uint16_t rows[GRID_HEIGHT][FEATURE_BATCH];
+
+    void clear() { std::memset(rows, 0, sizeof(rows)); }
+
+    void set(int lane, const Board& board) {
+        for (int y = 0; y < GRID_HEIGHT; ++y) rows[y][lane] = board.rows[y];
+    }
+};
+
+// One array per feature, indexed by batch lane
+struct FeatureBatch {
+    alignas(32) std::uint16_t aggregateHeight[FEATURE_BATCH];
+    alignas(32) std::uint16_t holes[FEATURE_BATCH];
+    alignas(32) std::uint16_t bumpiness[FEATURE_BATCH];
+    alignas(32) std::uint16_t wells[FEATURE_BATCH];
+    alignas(32) std::uint16_t rowTransitions[FEATURE_BATCH];
+    alignas(32) std::uint16_t heights[GRID_WIDTH][FEATURE_BATCH];
+};
+
+enum class FeatureIsa { Scalar, Sse, Avx2 };
+
+inline const char* featureIsaName(FeatureIsa isa) {
+    switch (isa) {
+        case FeatureIsa::Avx2: return "avx2";
+        case FeatureIsa::Sse: return "ssse3";
+        default: return "scalar";
+    }
+}
+
+inline bool featureIsaSupported(FeatureIsa isa) {
+#ifdef TETRIS_FEATURES_X86
+    if (isa == FeatureIsa::Avx2) return __builtin_cpu_supports("avx2");
+    if (isa == FeatureIsa::Sse) return __builtin_cpu_supports("ssse3");
+#endif
+    return isa == FeatureIsa::Scalar;
+}
+
+inline FeatureIsa bestFeatureIsa() {
+    static const FeatureIsa best = featureIsaSupported(FeatureIsa::Avx2) ? FeatureIsa::Avx2
+                                   : featureIsaSupported(FeatureIsa::Sse) ? FeatureIsa::Sse
+                                                                          : FeatureIsa::Scalar;
+    return best;
+}
+
+// Walls on both sides of a row shifted one column to the right
+const unsigned WALLED_ROW = 1u | (1u << (GRID_WIDTH + 1));
+const unsigned TRANSITION_MASK = (1u << (GRID_WIDTH + 1)) - 1;
+
+inline void computeFeatureBatchScalar(const BoardBatch& in, FeatureBatch& out) {
+    for (int lane = 0; lane < FEATURE_BATCH; ++lane) {
+        unsigned seen = 0;
+        int aggregate = 0, holes = 0, bumpiness = 0, wells = 0, transitions = 0;
+        int heights[GRID_WIDTH] = {};
+        for (int y = 0; y < GRID_HEIGHT; ++y) {
+            unsigned row = in.rows[y][lane];
+            holes += __builtin_popcount(seen & ~row & FULL_ROW);
+            // Columns reached for the first time get their height here
+            for (unsigned fresh = row & ~seen & FULL_ROW; fresh; fresh &= fresh - 1)
+                heights[__builtin_ctz(fresh)] = GRID_HEIGHT - y;
+            seen |= row;
+            aggregate += __builtin_popcount(seen);
+            bumpiness += __builtin_popcount((seen ^ (seen >> 1)) & (FULL_ROW >> 1));
+            unsigned leftFilled = (row << 1) | 1u;
+            unsigned rightFilled = (row >> 1) | (1u << (GRID_WIDTH - 1));
+            wells += __builtin_popcount(~seen & leftFilled & rightFilled & FULL_ROW);
+            unsigned walled = (row << 1) | WALLED_ROW;
+            transitions += __builtin_popcount((walled ^ (walled >> 1)) & TRANSITION_MASK);
+        }
+        out.aggregateHeight[lane] = static_cast<std::uint16_t>(aggregate);
+        out.holes[lane] = static_cast<std::uint16_t>(holes);
+        out.bumpiness[lane] = static_cast<std::uint16_t>(bumpiness);
+        out.wells[lane] = static_cast<std::uint16_t>(wells);
+        out.rowTransitions[lane] = static_cast<std::uint16_t>(transitions);
+        for (int x = 0; x < GRID_WIDTH; ++x) out.heights[x][lane] = static_cast<std::uint16_t>(heights[x]);
+    }
+}
+
+#ifdef TETRIS_FEATURES_X86
+
+// Popcount of every 16-bit lane: nibble lookup with pshufb, then add the two bytes
+__attribute__((target("ssse3"))) inline __m128i popcount16Sse(__m128i v) {
+    const __m128i lut = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    __m128i lo = _mm_and_si128(v, nibble);
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), nibble);
+    __m128i bytes = _mm_add_epi8(_mm_shuffle_epi8(lut, lo), _mm_shuffle_epi8(lut, hi));
+    return _mm_add_epi16(_mm_and_si128(bytes, _mm_set1_epi16(0xFF)), _mm_srli_epi16(bytes, 8));
+}
+
+// Eight boards per register, the batch takes two passes
+__attribute__((target("ssse3"))) inline void computeFeatureBatchSse(const BoardBatch& in, FeatureBatch& out) {
+    const __m128i full = _mm_set1_epi16(FULL_ROW);
+    const __m128i bumpMask = _mm_set1_epi16(FULL_ROW >> 1);
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i rightWall = _mm_set1_epi16(1 << (GRID_WIDTH - 1));
+    const __m128i walls = _mm_set1_epi16(WALLED_ROW);
+    const __m128i transitionMask = _mm_set1_epi16(TRANSITION_MASK);
+    for (int half = 0; half < FEATURE_BATCH; half += 8) {
+        __m128i seen = _mm_setzero_si128();
+        __m128i aggregate = seen, holes = seen, bumpiness = seen, wells = seen, transitions = seen;
+        __m128i heights[GRID_WIDTH];
+        for (__m128i& h : heights) h = _mm_setzero_si128();
+        for (int y = 0; y < GRID_HEIGHT; ++y) {
+            __m128i row = _mm_load_si128(reinterpret_cast<const __m128i*>(&in.rows[y][half]));
+            holes = _mm_add_epi16(holes, popcount16Sse(_mm_andnot_si128(row, seen)));
+            seen = _mm_or_si128(seen, row);
+            aggregate = _mm_add_epi16(aggregate, popcount16Sse(seen));
+            __m128i steps = _mm_and_si128(_mm_xor_si128(seen, _mm_srli_epi16(seen, 1)), bumpMask);
+            bumpiness = _mm_add_epi16(bumpiness, popcount16Sse(steps));
+            __m128i leftFilled = _mm_or_si128(_mm_slli_epi16(row, 1), one);
+            __m128i rightFilled = _mm_or_si128(_mm_srli_epi16(row, 1), rightWall);
+            __m128i wellCells = _mm_andnot_si128(seen, _mm_and_si128(_mm_and_si128(leftFilled, rightFilled), full));
+            wells = _mm_add_epi16(wells, popcount16Sse(wellCells));
+            __m128i walled = _mm_or_si128(_mm_slli_epi16(row, 1), walls);
+            __m128i changes = _mm_and_si128(_mm_xor_si128(walled, _mm_srli_epi16(walled, 1)), transitionMask);
+            transitions = _mm_add_epi16(transitions, popcount16Sse(changes));
+            for (int x = 0; x < GRID_WIDTH; ++x)
+                heights[x] = _mm_add_epi16(heights[x], _mm_and_si128(_mm_srli_epi16(seen, x), one));
+        }
+        _mm_store_si128(reinterpret_cast<__m128i*>(&out.aggregateHeight[half]), aggregate);
+        _mm_store_si128(reinterpret_cast<__m128i*>(&out.holes[half]), holes);
+        _mm_store_si128(reinterpret_cast<__m128i*>(&out.bumpiness[half]), bumpiness);
+        _mm_store_si128(reinterpret_cast<__m128i*>(&out.wells[half]), wells);
+        _mm_store_si128(reinterpret_cast<__m128i*>(&out.rowTransitions[half]), transitions);
+        for (int x = 0; x < GRID_WIDTH; ++x)
+            _mm_store_si128(reinterpret_cast<__m128i*>(&out.heights[x][half]), heights[x]);
+    }
+}
+
+__attribute__((target("avx2"))) inline __m256i popcount16Avx2(__m256i v) {
+    const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                         0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    __m256i lo = _mm256_and_si256(v, nibble);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble);
+    __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(lut, lo), _mm256_shuffle_epi8(lut, hi));
+    return _mm256_add_epi16(_mm256_and_si256(bytes, _mm256_set1_epi16(0xFF)), _mm256_srli_epi16(bytes, 8));
+}
+
+// The whole batch in one register per row
+__attribute__((target("avx2"))) inline void computeFeatureBatchAvx2(const BoardBatch& in, FeatureBatch& out) {
+    const __m256i full = _mm256_set1_epi16(FULL_ROW);
+    const __m256i bumpMask = _mm256_set1_epi16(FULL_ROW >> 1);
+    const __m256i one = _mm256_set1_epi16(1);
+    const __m256i rightWall = _mm256_set1_epi16(1 << (GRID_WIDTH - 1));
+    const __m256i walls = _mm256_set1_epi16(WALLED_ROW);
+    const __m256i transitionMask = _mm256_set1_epi16(TRANSITION_MASK);
+    __m256i seen = _mm256_setzero_si256();
+    __m256i aggregate = seen, holes = seen, bumpiness = seen, wells = seen, transitions = seen;
+    __m256i heights[GRID_WIDTH];
+    for (__m256i& h : heights) h = _mm256_setzero_si256();
+    for (int y = 0; y < GRID_HEIGHT; ++y) {
+        __m256i row = _mm256_load_si256(reinterpret_cast<const __m256i*>(in.rows[y]));
+        holes = _mm256_add_epi16(holes, popcount16Avx2(_mm256_andnot_si256(row, seen)));
+        seen = _mm256_or_si256(seen, row);
+        aggregate = _mm256_add_epi16(aggregate, popcount16Avx2(seen));
+        __m256i steps = _mm256_and_si256(_mm256_xor_si256(seen, _mm256_srli_epi16(seen, 1)), bumpMask);
+        bumpiness = _mm256_add_epi16(bumpiness, popcount16Avx2(steps));
+        __m256i leftFilled = _mm256_or_si256(_mm256_slli_epi16(row, 1), one);
+        __m256i rightFilled = _mm256_or_si256(_mm256_srli_epi16(row, 1), rightWall);
+        __m256i wellCells = _mm256_andnot_si256(seen, _mm256_and_si256(_mm256_and_si256(leftFilled, rightFilled), full));
+        wells = _mm256_add_epi16(wells, popcount16Avx2(wellCells));
+        __m256i walled = _mm256_or_si256(_mm256_slli_epi16(row, 1), walls);
+        __m256i changes = _mm256_and_si256(_mm256_xor_si256(walled, _mm256_srli_epi16(walled, 1)), transitionMask);
+        transitions = _mm256_add_epi16(transitions, popcount16Avx2(changes));
+        for (int x = 0; x < GRID_WIDTH; ++x)
+            heights[x] = _mm256_add_epi16(heights[x], _mm256_and_si256(_mm256_srli_epi16(seen, x), one));
+    }
+    _mm256_store_si256(reinterpret_cast<__m256i*>(out.aggregateHeight), aggregate);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(out.holes), holes);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(out.bumpiness), bumpiness);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(out.wells), wells);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(out.rowTransitions), transitions);
+    for (int x = 0; x < GRID_WIDTH; ++x)
+        _mm256_store_si256(reinterpret_cast<__m256i*>(out.heights[x]), heights[x]);
+}
+
+#endif
+
+// Features of every board in the batch; unused lanes just produce garbage
+inline void computeFeatureBatch(const BoardBatch& in, FeatureBatch& out, FeatureIsa isa = bestFeatureIsa()) {
+#ifdef TETRIS_FEATURES_X86
+    if (isa == FeatureIsa::Avx2) return computeFeatureBatchAvx2(in, out);
+    if (isa == FeatureIsa::Sse) return computeFeatureBatchSse(in, out);
+#endif
+    (void)isa;
+    computeFeatureBatchScalar(in, out);
+}
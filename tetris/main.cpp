@@ -1,156 +1,260 @@
 #include <SFML/Graphics.hpp>
 #include <array>
 #include <vector>
-#include <ctime>
 #include <cstdlib>
 #include <map>
 #include <string>
 #include <iostream>
 #include <cmath>
+#include <functional>
+#include <random>
+#include <thread>
+#include "ai.hpp"
+#include "pc_hint.hpp"
+#include "replay.hpp"
+#include "shm_bridge.hpp"
+#include "versus_net.hpp"
 
-const int GRID_WIDTH = 10;
-const int GRID_HEIGHT = 20;
 const int TILE_SIZE = 30;
 const std::string FONT_PATH = "extern/fonts/PixelatedElegance.ttf";
-const int LINES_PER_LEVEL = 10;
-const float CLEAR_ANIM_DURATION = 0.15f; // seconds
 
 // Couleurs des Tetriminos
 const std::array<sf::Color, 7> TETRIMINO_COLORS = {
     sf::Color::Cyan, sf::Color::Red, sf::Color::Green, sf::Color::Magenta,
     sf::Color::Blue, sf::Color::Yellow, sf::Color::White};
 
-// Système de particules
-struct Particle {
-    sf::Vector2f position;
-    sf::Vector2f velocity;
-    sf::Color color;
-    float size;
-    float lifetime;
-    float maxLifetime;
-    
-    Particle(sf::Vector2f pos, sf::Vector2f vel, sf::Color col, float sz = 2.0f, float life = 1.0f) 
-        : position(pos), velocity(vel), color(col), size(sz), lifetime(life), maxLifetime(life) {}
-    
-    void update(float deltaTime) {
-        position += velocity * deltaTime;
-        lifetime -= deltaTime;
-        
-        // Ralentissement progressif
-        velocity *= 0.98f;
-        
-        // Diminution de la taille
-        size = std::max(0.5f, size * (lifetime / maxLifetime));
+// Fenêtre qui compte les appels de dessin pour le compteur de debug (F3)
+class GameWindow : public sf::RenderWindow {
+public:
+    using sf::RenderWindow::RenderWindow;
+    int drawCalls = 0;
+
+    void draw(const sf::Drawable& drawable, const sf::RenderStates& states = sf::RenderStates::Default) {
+        drawCalls++;
+        sf::RenderWindow::draw(drawable, states);
     }
-    
-    bool isDead() const {
-        return lifetime <= 0;
+};
+
+// Système de particules
+// Les particules sont stockées en structure de tableaux (SoA) pour que la mise
+// à jour soit une simple boucle vectorisable, et tout l'effet (ondes de choc
+// comprises) est dessiné en un seul appel depuis un sf::VertexArray réutilisé.
+// Tous les tableaux sont alloués une fois à la capacité du pool : aucune
+// allocation pendant la partie, les particules mortes sont retirées par échange
+// avec la dernière.
+const int PARTICLE_TEXTURE_SIZE = 32;
+const int RING_MAX_SEGMENTS = 128;
+const size_t DEFAULT_PARTICLE_CAPACITY = 4096;
+const size_t MAX_SHOCKWAVES = 32;
+
+// Que faire quand une explosion ne tient plus dans le pool
+enum class OverflowPolicy {
+    DropOldest,  // les nouvelles particules remplacent les plus anciennes
+    ScaleBurst   // l'explosion est réduite à la place restante
+};
+
+class ParticleSystem {
+private:
+    size_t capacity;
+    OverflowPolicy policy;
+    size_t liveCount = 0;
+    size_t peakCount = 0;
+    size_t droppedCount = 0;
+    float elapsed = 0.0f;
+
+    // Particules
+    std::vector<float> posX, posY;
+    std::vector<float> velX, velY;
+    std::vector<float> sizes;
+    std::vector<float> lifetimes, maxLifetimes;
+    std::vector<float> births;
+    std::vector<sf::Color> colors;
+    std::vector<size_t> scratch; // indices triés lors d'un débordement
+
+    // Flux aléatoire propre aux effets : le nombre de particules ne change
+    // jamais la suite des pièces
+    static const int RANDOMS_PER_PARTICLE = 9;
+    Pcg32 effectsRng = makeRng(0, STREAM_EFFECTS);
+    std::vector<float> randoms;
+
+    // Ondes de choc
+    struct ShockWave {
+        sf::Vector2f center;
+        float radius;
+        float maxRadius;
+        float thickness;
+        sf::Color color;
+        float lifetime;
+        float maxLifetime;
+    };
+    std::array<ShockWave, MAX_SHOCKWAVES> shockWaves;
+    size_t shockWaveCount = 0;
+
+    // Maillage partagé : un quad par particule, un quad par segment d'anneau
+    sf::VertexArray vertices{sf::Quads};
+    sf::Texture discTexture;
+    std::array<sf::Vector2f, RING_MAX_SEGMENTS + 1> unitCircle;
+
+    void createDiscTexture() {
+        // Disque blanc aux bords adoucis, teinté par la couleur des sommets
+        sf::Image image;
+        image.create(PARTICLE_TEXTURE_SIZE, PARTICLE_TEXTURE_SIZE, sf::Color::Transparent);
+        float half = PARTICLE_TEXTURE_SIZE / 2.0f;
+        for (int y = 0; y < PARTICLE_TEXTURE_SIZE; ++y) {
+            for (int x = 0; x < PARTICLE_TEXTURE_SIZE; ++x) {
+                float dx = x + 0.5f - half, dy = y + 0.5f - half;
+                float coverage = std::min(1.0f, std::max(0.0f, half - std::sqrt(dx * dx + dy * dy)));
+                image.setPixel(x, y, sf::Color(255, 255, 255, static_cast<sf::Uint8>(255 * coverage)));
+            }
+        }
+        discTexture.loadFromImage(image);
+        discTexture.setSmooth(true);
     }
-    
-    void draw(sf::RenderWindow& window) {
-        sf::CircleShape shape(size);
-        shape.setPosition(position);
-        shape.setOrigin(size, size);
-        
-        // Ajuster l'opacité en fonction de la durée de vie restante
-        sf::Color fadingColor = color;
-        fadingColor.a = static_cast<sf::Uint8>(255 * (lifetime / maxLifetime));
-        shape.setFillColor(fadingColor);
-        
-        window.draw(shape);
+
+    void setQuad(size_t& v, sf::Vector2f a, sf::Vector2f b, sf::Vector2f c, sf::Vector2f d, sf::Color color,
+                 sf::Vector2f ta, sf::Vector2f tb, sf::Vector2f tc, sf::Vector2f td) {
+        vertices[v++] = sf::Vertex(a, color, ta);
+        vertices[v++] = sf::Vertex(b, color, tb);
+        vertices[v++] = sf::Vertex(c, color, tc);
+        vertices[v++] = sf::Vertex(d, color, td);
     }
-};
 
-// Structure pour l'effet d'onde de choc
-struct ShockWave {
-    sf::Vector2f center;
-    float radius;
-    float maxRadius;
-    float thickness;
-    sf::Color color;
-    float lifetime;
-    float maxLifetime;
-    
-    ShockWave(sf::Vector2f pos, float maxRad, sf::Color col, float life)
-        : center(pos), radius(0), maxRadius(maxRad), thickness(3.0f), color(col), lifetime(life), maxLifetime(life) {}
-        
-    void update(float deltaTime) {
-        radius += (maxRadius / maxLifetime) * deltaTime * 2.5f; // Vitesse de propagation
-        lifetime -= deltaTime;
-        
-        // Réduire l'épaisseur avec le temps
-        thickness = std::max(0.5f, 3.0f * (lifetime / maxLifetime));
+    // Plus l'anneau est grand, plus il a de segments (environ un par pixel de
+    // rayon, en puissance de deux entre 16 et RING_MAX_SEGMENTS)
+    static int ringStep(float radius) {
+        int step = RING_MAX_SEGMENTS / 16;
+        while (step > 1 && RING_MAX_SEGMENTS / step < radius) step /= 2;
+        return step;
     }
-    
-    bool isDead() const {
-        return lifetime <= 0 || radius >= maxRadius;
+
+    // Libère de la place pour `requested` particules selon la politique de
+    // débordement ; renvoie combien peuvent être créées
+    size_t makeRoom(size_t requested) {
+        size_t freeSlots = capacity - liveCount;
+        if (requested <= freeSlots) return requested;
+        if (requested > capacity) {
+            droppedCount += requested - capacity;
+            requested = capacity;
+        }
+        size_t overflow = requested - freeSlots;
+        if (policy == OverflowPolicy::ScaleBurst) {
+            droppedCount += overflow;
+            return freeSlots;
+        }
+        // Retirer les plus anciennes : les regrouper en tête des indices triés
+        scratch.resize(liveCount);
+        for (size_t i = 0; i < liveCount; ++i) scratch[i] = i;
+        std::nth_element(scratch.begin(), scratch.begin() + (overflow - 1), scratch.end(),
+            [this](size_t a, size_t b) { return births[a] < births[b]; });
+        // Supprimer d'abord les indices les plus grands pour que l'échange reste valide
+        std::sort(scratch.begin(), scratch.begin() + overflow, std::greater<size_t>());
+        for (size_t i = 0; i < overflow; ++i) removeParticle(scratch[i]);
+        droppedCount += overflow;
+        return requested;
     }
-    
-    void draw(sf::RenderWindow& window) {
-        sf::CircleShape shape(radius);
-        shape.setPosition(center.x - radius, center.y - radius);
-        shape.setOrigin(0, 0);
-        
-        // Ajuster l'opacité en fonction de la durée de vie restante
-        sf::Color wavingColor = color;
-        wavingColor.a = static_cast<sf::Uint8>(155 * (lifetime / maxLifetime));
-        shape.setFillColor(sf::Color::Transparent);
-        shape.setOutlineColor(wavingColor);
-        shape.setOutlineThickness(thickness);
-        
-        window.draw(shape);
+
+    void removeParticle(size_t i) {
+        size_t last = --liveCount;
+        posX[i] = posX[last]; posY[i] = posY[last];
+        velX[i] = velX[last]; velY[i] = velY[last];
+        sizes[i] = sizes[last]; lifetimes[i] = lifetimes[last];
+        maxLifetimes[i] = maxLifetimes[last]; births[i] = births[last];
+        colors[i] = colors[last];
     }
-};
 
-class ParticleSystem {
-private:
-    std::vector<Particle> particles;
-    std::vector<ShockWave> shockWaves;
-    
 public:
-    void addParticle(const Particle& particle) {
-        particles.push_back(particle);
+    explicit ParticleSystem(size_t capacity_ = DEFAULT_PARTICLE_CAPACITY,
+                            OverflowPolicy policy_ = OverflowPolicy::DropOldest)
+        : capacity(capacity_), policy(policy_),
+          posX(capacity_), posY(capacity_), velX(capacity_), velY(capacity_),
+          sizes(capacity_), lifetimes(capacity_), maxLifetimes(capacity_), births(capacity_),
+          colors(capacity_) {
+        scratch.reserve(capacity);
+        // Assez de sommets pour le pool plein et toutes les ondes au maximum de segments
+        vertices.resize(4 * (capacity + MAX_SHOCKWAVES * RING_MAX_SEGMENTS));
+        vertices.clear();
+        createDiscTexture();
+        for (int i = 0; i <= RING_MAX_SEGMENTS; ++i) {
+            float angle = 2.0f * 3.14159265f * i / RING_MAX_SEGMENTS;
+            unitCircle[i] = sf::Vector2f(std::cos(angle), std::sin(angle));
+        }
+    }
+
+    void seedEffects(std::uint64_t seed) { effectsRng.seed(seed, STREAM_EFFECTS); }
+
+    size_t getLiveCount() const { return liveCount; }
+    size_t getPeakCount() const { return peakCount; }
+    size_t getDroppedCount() const { return droppedCount; }
+    size_t getCapacity() const { return capacity; }
+
+    void addParticle(sf::Vector2f position, sf::Vector2f velocity, sf::Color color, float size = 2.0f, float lifetime = 1.0f) {
+        if (makeRoom(1) == 0) return;
+        size_t i = liveCount++;
+        posX[i] = position.x;
+        posY[i] = position.y;
+        velX[i] = velocity.x;
+        velY[i] = velocity.y;
+        sizes[i] = size;
+        lifetimes[i] = lifetime;
+        maxLifetimes[i] = lifetime;
+        births[i] = elapsed;
+        colors[i] = color;
+        peakCount = std::max(peakCount, liveCount);
     }
     
-    void addShockWave(const ShockWave& wave) {
-        shockWaves.push_back(wave);
+    void addShockWave(sf::Vector2f center, float maxRadius, sf::Color color, float lifetime) {
+        if (shockWaveCount == MAX_SHOCKWAVES) return;
+        shockWaves[shockWaveCount++] = ShockWave{center, 0.0f, maxRadius, 3.0f, color, lifetime, lifetime};
     }
     
     void createExplosion(sf::Vector2f position, sf::Color color, int count, float speed) {
-        for (int i = 0; i < count; ++i) {
+        count = static_cast<int>(makeRoom(static_cast<size_t>(count)));
+        // Tous les tirages de l'explosion d'un coup, RANDOMS_PER_PARTICLE par particule
+        randoms.resize(static_cast<size_t>(count) * RANDOMS_PER_PARTICLE);
+        effectsRng.fill(randoms.data(), randoms.size());
+        const float* r = randoms.data();
+        const float variation = 30.0f;
+        for (int i = 0; i < count; ++i, r += RANDOMS_PER_PARTICLE) {
             // Direction aléatoire
-            float angle = static_cast<float>(rand() % 360) * 3.14159f / 180.0f;
-            float velocity = speed * (0.5f + static_cast<float>(rand() % 100) / 100.0f);
-            sf::Vector2f direction(std::cos(angle) * velocity, std::sin(angle) * velocity);
-            
+            float velocity = speed * (0.5f + r[1]);
+            sf::Vector2f direction(fastCosTurns(r[0]) * velocity, fastSinTurns(r[0]) * velocity);
+
             // Légère variation de position
-            sf::Vector2f offset(
-                (static_cast<float>(rand() % 100) - 50.0f) / 50.0f * TILE_SIZE / 4.0f,
-                (static_cast<float>(rand() % 100) - 50.0f) / 50.0f * TILE_SIZE / 4.0f
-            );
-            
+            sf::Vector2f offset((r[2] * 2.0f - 1.0f) * TILE_SIZE / 4.0f, (r[3] * 2.0f - 1.0f) * TILE_SIZE / 4.0f);
+
             // Légère variation de couleur
-            sf::Color particleColor = color;
-            int variation = 30;
-            particleColor.r = std::min(255, std::max(0, particleColor.r + (rand() % variation - variation/2)));
-            particleColor.g = std::min(255, std::max(0, particleColor.g + (rand() % variation - variation/2)));
-            particleColor.b = std::min(255, std::max(0, particleColor.b + (rand() % variation - variation/2)));
-            
+            auto vary = [variation](sf::Uint8 channel, float u) {
+                int value = channel + static_cast<int>(u * variation) - static_cast<int>(variation) / 2;
+                return static_cast<sf::Uint8>(std::min(255, std::max(0, value)));
+            };
+            sf::Color particleColor(vary(color.r, r[4]), vary(color.g, r[5]), vary(color.b, r[6]), color.a);
+
             // Taille et durée de vie aléatoires
-            float size = 1.0f + static_cast<float>(rand() % 30) / 10.0f;
-            float lifetime = 0.5f + static_cast<float>(rand() % 100) / 100.0f;
-            
-            addParticle(Particle(position + offset, direction, particleColor, size, lifetime));
+            float size = 1.0f + r[7] * 3.0f;
+            float lifetime = 0.5f + r[8];
+
+            addParticle(position + offset, direction, particleColor, size, lifetime);
         }
     }
     
-    void createLineExplosion(int lineY, const std::vector<std::vector<int>>& grid) {
+    void createLineExplosion(int lineY, const Board& grid) {
+        const int particlesPerTile = 15; // 15 particules par tuile
+        int perTile = particlesPerTile;
+        if (policy == OverflowPolicy::ScaleBurst) {
+            // Répartir la place restante sur toute la ligne plutôt que de priver les dernières tuiles
+            size_t freeSlots = capacity - liveCount;
+            size_t requested = static_cast<size_t>(GRID_WIDTH * particlesPerTile);
+            if (requested > freeSlots) {
+                perTile = static_cast<int>(freeSlots / GRID_WIDTH);
+                droppedCount += requested - static_cast<size_t>(perTile * GRID_WIDTH);
+            }
+        }
         for (int x = 0; x < GRID_WIDTH; ++x) {
-            if (grid[lineY][x] != 0) {
-                int colorIndex = grid[lineY][x] - 1;
+            if (grid.cell(x, lineY) != 0) {
+                int colorIndex = grid.cell(x, lineY) - 1;
                 sf::Color color = TETRIMINO_COLORS[colorIndex];
                 sf::Vector2f tileCenter(x * TILE_SIZE + TILE_SIZE / 2, lineY * TILE_SIZE + TILE_SIZE / 2);
-                createExplosion(tileCenter, color, 15, 100.0f); // 15 particules par tuile
+                createExplosion(tileCenter, color, perTile, 100.0f);
             }
         }
     }
@@ -158,332 +262,652 @@ public:
     // Créer une onde de choc au centre d'une ligne
     void createShockWaveForLine(int lineY, sf::Color color, float maxRadius = 300.0f) {
         sf::Vector2f center(GRID_WIDTH * TILE_SIZE / 2, lineY * TILE_SIZE + TILE_SIZE / 2);
-        addShockWave(ShockWave(center, maxRadius, color, 0.7f));
+        addShockWave(center, maxRadius, color, 0.7f);
     }
     
     void update(float deltaTime) {
-        // Mettre à jour toutes les particules
-        for (auto& particle : particles) {
-            particle.update(deltaTime);
+        elapsed += deltaTime;
+
+        // Mettre à jour toutes les particules, un tableau à la fois
+        const size_t count = liveCount;
+        float* __restrict px = posX.data();
+        float* __restrict py = posY.data();
+        float* __restrict vx = velX.data();
+        float* __restrict vy = velY.data();
+        float* __restrict sz = sizes.data();
+        float* __restrict life = lifetimes.data();
+        const float* __restrict maxLife = maxLifetimes.data();
+        for (size_t i = 0; i < count; ++i) {
+            px[i] += vx[i] * deltaTime;
+            py[i] += vy[i] * deltaTime;
+            life[i] -= deltaTime;
+            // Ralentissement progressif
+            vx[i] *= 0.98f;
+            vy[i] *= 0.98f;
+            // Diminution de la taille
+            sz[i] = std::max(0.5f, sz[i] * (life[i] / maxLife[i]));
         }
         
-        // Supprimer les particules mortes
-        particles.erase(
-            std::remove_if(particles.begin(), particles.end(), 
-                [](const Particle& p) { return p.isDead(); }),
-            particles.end()
-        );
+        // Supprimer les particules mortes par échange avec la dernière
+        for (size_t i = 0; i < liveCount;) {
+            if (lifetimes[i] <= 0) removeParticle(i);
+            else ++i;
+        }
         
         // Mettre à jour les ondes de choc
-        for (auto& wave : shockWaves) {
-            wave.update(deltaTime);
+        for (size_t i = 0; i < shockWaveCount;) {
+            ShockWave& wave = shockWaves[i];
+            wave.radius += (wave.maxRadius / wave.maxLifetime) * deltaTime * 2.5f; // Vitesse de propagation
+            wave.lifetime -= deltaTime;
+            // Réduire l'épaisseur avec le temps
+            wave.thickness = std::max(0.5f, 3.0f * (wave.lifetime / wave.maxLifetime));
+            // Supprimer les ondes de choc terminées
+            if (wave.lifetime <= 0 || wave.radius >= wave.maxRadius) wave = shockWaves[--shockWaveCount];
+            else ++i;
         }
-        
-        // Supprimer les ondes de choc terminées
-        shockWaves.erase(
-            std::remove_if(shockWaves.begin(), shockWaves.end(),
-                [](const ShockWave& w) { return w.isDead(); }),
-            shockWaves.end()
-        );
     }
     
-    void draw(sf::RenderWindow& window) {
+    void draw(GameWindow& window) {
+        if (isEmpty()) return;
+
+        // Compter les sommets avant de remplir (resize ne réalloue jamais : capacité réservée)
+        size_t vertexCount = 4 * liveCount;
+        for (size_t w = 0; w < shockWaveCount; ++w)
+            vertexCount += 4 * (RING_MAX_SEGMENTS / ringStep(shockWaves[w].radius + shockWaves[w].thickness));
+        vertices.resize(vertexCount);
+        size_t v = 0;
+        
+        // Les anneaux échantillonnent le centre opaque de la texture
+        const sf::Vector2f solid(PARTICLE_TEXTURE_SIZE / 2.0f, PARTICLE_TEXTURE_SIZE / 2.0f);
+        
         // Dessiner d'abord les ondes de choc (arrière-plan)
-        for (auto& wave : shockWaves) {
-            wave.draw(window);
+        for (size_t w = 0; w < shockWaveCount; ++w) {
+            const ShockWave& wave = shockWaves[w];
+            sf::Color wavingColor = wave.color;
+            wavingColor.a = static_cast<sf::Uint8>(155 * (wave.lifetime / wave.maxLifetime));
+            float outer = wave.radius + wave.thickness;
+            int step = ringStep(outer);
+            for (int i = 0; i < RING_MAX_SEGMENTS; i += step) {
+                sf::Vector2f a = unitCircle[i], b = unitCircle[i + step];
+                setQuad(v, wave.center + a * wave.radius, wave.center + a * outer,
+                        wave.center + b * outer, wave.center + b * wave.radius,
+                        wavingColor, solid, solid, solid, solid);
+            }
         }
         
         // Puis dessiner les particules (premier plan)
-        for (auto& particle : particles) {
-            particle.draw(window);
+        const float t = static_cast<float>(PARTICLE_TEXTURE_SIZE);
+        for (size_t i = 0; i < liveCount; ++i) {
+            // Ajuster l'opacité en fonction de la durée de vie restante
+            sf::Color fadingColor = colors[i];
+            fadingColor.a = static_cast<sf::Uint8>(255 * (lifetimes[i] / maxLifetimes[i]));
+            float s = sizes[i];
+            setQuad(v, sf::Vector2f(posX[i] - s, posY[i] - s), sf::Vector2f(posX[i] + s, posY[i] - s),
+                    sf::Vector2f(posX[i] + s, posY[i] + s), sf::Vector2f(posX[i] - s, posY[i] + s),
+                    fadingColor, sf::Vector2f(0, 0), sf::Vector2f(t, 0), sf::Vector2f(t, t), sf::Vector2f(0, t));
         }
+        
+        window.draw(vertices, sf::RenderStates(&discTexture));
     }
     
     bool isEmpty() const {
-        return particles.empty() && shockWaves.empty();
+        return liveCount == 0 && shockWaveCount == 0;
     }
 };
 
-// Update Tetrimino shapes to include all standard Tetris pieces
-const std::array<std::array<int, 4>, 7> TETRIMINOS = {{
-    {1, 3, 5, 7}, // I
-    {2, 4, 5, 7}, // Z
-    {3, 5, 4, 6}, // S
-    {3, 5, 4, 7}, // T
-    {2, 3, 5, 7}, // L
-    {3, 5, 7, 6}, // J
-    {2, 3, 4, 5}  // O
-}};
-
-struct Tetrimino
-{
-    int shapeIndex;
-    int rotation; // 0, 1, 2, 3
-    int x, y;
-    Tetrimino(int shapeIndex_) : shapeIndex(shapeIndex_), rotation(0), x(GRID_WIDTH / 2 - 1), y(0) {}
-};
+// Panneau latéral (score, next, hold, level) mis en cache dans une texture.
+// Le fond, les boîtes et les libellés sont dessinés une seule fois ; seules les
+// zones dont la valeur change sont redessinées, et le panneau est affiché en
+// un seul sprite.
+const int SCORE_PANEL_WIDTH = 150;
 
-// Helper to get rotated block positions
-std::array<sf::Vector2i, 4> getBlockPositions(const Tetrimino &t)
-{
-    std::array<sf::Vector2i, 4> positions;
-    for (int i = 0; i < 4; ++i)
-    {
-        int px = TETRIMINOS[t.shapeIndex][i] % 2;
-        int py = TETRIMINOS[t.shapeIndex][i] / 2;
-        // Rotate around (1,1) as pivot
-        for (int r = 0; r < t.rotation; ++r)
-        {
-            int tmp = px;
-            px = 1 - (py - 1);
-            py = tmp;
-        }
-        positions[i] = sf::Vector2i(t.x + px, t.y + py);
+class SidePanel {
+private:
+    // Disposition, en coordonnées locales au panneau
+    static const int panelTop = 20;
+    static const int scoreBoxHeight = 60;
+    static const int bigBoxHeight = 170;
+    static const int boxSpacing = 30;
+    static const int scoreBoxY = panelTop;
+    static const int nextBoxY = scoreBoxY + scoreBoxHeight + boxSpacing;
+    static const int holdBoxY = nextBoxY + bigBoxHeight + boxSpacing;
+    static const int boxX = 15;
+    static const int boxWidth = SCORE_PANEL_WIDTH - 30;
+    static const int levelBoxHeight = 60;
+    static const int levelBoxY = GRID_HEIGHT * TILE_SIZE - levelBoxHeight - 15; // Position en bas avec une marge
+    static const int pieceTileSize = TILE_SIZE - 1;
+
+    sf::Font& font;
+    sf::RenderTexture staticLayer; // fond, boîtes et libellés
+    sf::RenderTexture layer;       // panneau complet affiché à l'écran
+    sf::Sprite sprite;
+    sf::Text scoreValue;
+    sf::Text levelValue;
+
+    // Valeurs affichées, -2 = jamais dessiné
+    int shownScore = -2, shownLevel = -2, shownNext = -2, shownHold = -2;
+
+    void drawBox(sf::RenderTarget& target, int y, int height, sf::Color fill) {
+        sf::RectangleShape box(sf::Vector2f(boxWidth, height));
+        box.setPosition(boxX, y);
+        box.setFillColor(fill);
+        box.setOutlineColor(sf::Color::White);
+        box.setOutlineThickness(2);
+        target.draw(box);
     }
-    return positions;
-}
 
-bool isValidPosition(const Tetrimino &tetrimino, const std::vector<std::vector<int>> &grid)
-{
-    auto positions = getBlockPositions(tetrimino);
-    for (const auto &pos : positions)
-    {
-        int x = pos.x, y = pos.y;
-        if (x < 0 || x >= GRID_WIDTH || y >= GRID_HEIGHT || (y >= 0 && grid[y][x] != 0))
-            return false;
+    void drawLabel(sf::RenderTarget& target, const char* text, int y, sf::Color color) {
+        sf::Text label;
+        label.setFont(font);
+        label.setString(text);
+        label.setCharacterSize(18);
+        label.setFillColor(color);
+        label.setStyle(sf::Text::Bold);
+        label.setPosition(35, y + 6);
+        target.draw(label);
     }
-    return true;
-}
 
-void placeTetrimino(const Tetrimino &tetrimino, std::vector<std::vector<int>> &grid)
-{
-    auto positions = getBlockPositions(tetrimino);
-    for (const auto &pos : positions)
-    {
-        if (pos.y >= 0)
-            grid[pos.y][pos.x] = tetrimino.shapeIndex + 1;
+    void drawStaticParts() {
+        staticLayer.clear(sf::Color::Transparent);
+
+        // Draw the score panel background
+        sf::RectangleShape scorePanel(sf::Vector2f(SCORE_PANEL_WIDTH, GRID_HEIGHT * TILE_SIZE));
+        scorePanel.setFillColor(sf::Color(25, 25, 25));
+        staticLayer.draw(scorePanel);
+
+        // Draw the SCORE, NEXT, HOLD and LEVEL boxes with their labels
+        drawBox(staticLayer, scoreBoxY, scoreBoxHeight, sf::Color(40, 40, 60));
+        drawLabel(staticLayer, "SCORE", scoreBoxY, sf::Color(200, 200, 255));
+        drawBox(staticLayer, nextBoxY, bigBoxHeight, sf::Color(40, 60, 40));
+        drawLabel(staticLayer, "NEXT", nextBoxY, sf::Color(200, 255, 200));
+        drawBox(staticLayer, holdBoxY, bigBoxHeight, sf::Color(60, 40, 40));
+        drawLabel(staticLayer, "HOLD", holdBoxY, sf::Color(255, 200, 200));
+        drawBox(staticLayer, levelBoxY, levelBoxHeight, sf::Color(60, 60, 80));
+        drawLabel(staticLayer, "LEVEL", levelBoxY, sf::Color(220, 220, 255));
+
+        staticLayer.display();
     }
-}
 
-void rotateTetrimino(Tetrimino &tetrimino, const std::vector<std::vector<int>> &grid)
-{
-    // Do not rotate the O (square) piece
-    if (tetrimino.shapeIndex == 6)
-        return;
-    Tetrimino temp = tetrimino;
-    temp.rotation = (temp.rotation + 1) % 4;
-    if (isValidPosition(temp, grid))
-    {
-        tetrimino = temp;
-        return;
+    // Recopier le fond statique d'une boîte avant d'y redessiner la valeur
+    void restoreBox(int y, int height) {
+        sf::IntRect region(boxX, y, boxWidth, height);
+        sf::Sprite background(staticLayer.getTexture(), region);
+        background.setPosition(boxX, y);
+        layer.draw(background, sf::RenderStates(sf::BlendNone));
     }
-    const std::array<sf::Vector2i, 5> kicks = {
-        sf::Vector2i(-1, 0), sf::Vector2i(1, 0), sf::Vector2i(0, -1), sf::Vector2i(-2, 0), sf::Vector2i(2, 0)};
-    for (const auto &kick : kicks)
-    {
-        Tetrimino kicked = temp;
-        kicked.x += kick.x;
-        kicked.y += kick.y;
-        if (isValidPosition(kicked, grid))
-        {
-            tetrimino = kicked;
-            return;
+
+    // Center the piece in the box, but move it higher
+    void drawPiecePreview(int boxY, int shapeIndex) {
+        int boxCenterX = boxX + boxWidth / 2;
+        int boxCenterY = boxY + 55;
+        for (const Cell& block : PIECE_TABLE[shapeIndex][0].blocks) {
+            sf::RectangleShape tile(sf::Vector2f(pieceTileSize, pieceTileSize));
+            tile.setPosition(boxCenterX + (block.x - 1) * pieceTileSize, boxCenterY + (block.y - 1) * pieceTileSize);
+            tile.setFillColor(TETRIMINO_COLORS[shapeIndex]);
+            tile.setOutlineColor(sf::Color::Black);
+            tile.setOutlineThickness(2);
+            layer.draw(tile);
         }
     }
-    // If all fail, do not rotate
-}
 
-// Système de score amélioré
-struct ScoreSystem {
-    // Points pour les lignes complétées (selon niveau)
-    int getSingleLineClear(int level) { return 100 * level; }
-    int getDoubleLineClear(int level) { return 300 * level; }
-    int getTripleLineClear(int level) { return 500 * level; }
-    int getTetrisLineClear(int level) { return 800 * level; } // Bonus pour Tetris (4 lignes)
-    
-    // Points par cellule descendue
-    int getSoftDropPoints() { return 1; }     // 1 point par cellule en soft drop
-    int getHardDropPoints() { return 2; }     // 2 points par cellule en hard drop
-};
+public:
+    explicit SidePanel(sf::Font& font_) : font(font_) {
+        staticLayer.create(SCORE_PANEL_WIDTH, GRID_HEIGHT * TILE_SIZE);
+        layer.create(SCORE_PANEL_WIDTH, GRID_HEIGHT * TILE_SIZE);
+        drawStaticParts();
+
+        layer.clear(sf::Color::Transparent);
+        layer.draw(sf::Sprite(staticLayer.getTexture()), sf::RenderStates(sf::BlendNone));
 
-// Variables globales pour le score et le niveau
-ScoreSystem scoreSystem;
-int level = 1;
-int linesCleared = 0;
-float fallDelay = 0.5f; 
+        scoreValue.setFont(font);
+        scoreValue.setCharacterSize(28);
+        scoreValue.setFillColor(sf::Color::White);
+        scoreValue.setStyle(sf::Text::Bold);
+        scoreValue.setPosition(35, scoreBoxY + 28);
 
-// Add scoring system
-int score = 0;
+        levelValue.setFont(font);
+        levelValue.setCharacterSize(30);
+        levelValue.setFillColor(sf::Color::Yellow);
+        levelValue.setStyle(sf::Text::Bold);
 
-// Remplacer la map SCORE_TABLE par la fonction suivante
-int getLinesClearPoints(int numLines, int level) {
-    switch(numLines) {
-        case 1: return scoreSystem.getSingleLineClear(level);
-        case 2: return scoreSystem.getDoubleLineClear(level);
-        case 3: return scoreSystem.getTripleLineClear(level);
-        case 4: return scoreSystem.getTetrisLineClear(level);
-        default: return 0;
+        sprite.setTexture(layer.getTexture());
+        sprite.setPosition(GRID_WIDTH * TILE_SIZE, 0);
     }
-}
 
-// Helper to draw the side panel (score, next, hold)
-void drawSidePanel(sf::RenderWindow& window, sf::Font& font, int score, const Tetrimino& nextTetrimino, Tetrimino* heldTetrimino) {
-    const int SCORE_PANEL_WIDTH = 150;
-    const int panelTop = 20;
-    const int scoreBoxHeight = 60;
-    const int bigBoxHeight = 170;
-    const int boxSpacing = 30;
-    const int scoreBoxY = panelTop;
-    const int nextBoxY = scoreBoxY + scoreBoxHeight + boxSpacing;
-    const int holdBoxY = nextBoxY + bigBoxHeight + boxSpacing;
-    const int boxWidth = SCORE_PANEL_WIDTH - 30;
-    const int pieceTileSize = TILE_SIZE - 1;
-
-    // Draw the score panel background
-    sf::RectangleShape scorePanel(sf::Vector2f(SCORE_PANEL_WIDTH, GRID_HEIGHT * TILE_SIZE));
-    scorePanel.setPosition(GRID_WIDTH * TILE_SIZE, 0);
-    scorePanel.setFillColor(sf::Color(25, 25, 25));
-    window.draw(scorePanel);
-
-    // Draw the SCORE box
-    sf::RectangleShape scoreBox(sf::Vector2f(boxWidth, scoreBoxHeight));
-    scoreBox.setPosition(GRID_WIDTH * TILE_SIZE + 15, scoreBoxY);
-    scoreBox.setFillColor(sf::Color(40, 40, 60));
-    scoreBox.setOutlineColor(sf::Color::White);
-    scoreBox.setOutlineThickness(2);
-    window.draw(scoreBox);
-    sf::Text scoreLabel;
-    scoreLabel.setFont(font);
-    scoreLabel.setString("SCORE");
-    scoreLabel.setCharacterSize(18);
-    scoreLabel.setFillColor(sf::Color(200, 200, 255));
-    scoreLabel.setStyle(sf::Text::Bold);
-    scoreLabel.setPosition(GRID_WIDTH * TILE_SIZE + 35, scoreBoxY + 6);
-    window.draw(scoreLabel);
-    sf::Text scoreValue;
-    scoreValue.setFont(font);
-    scoreValue.setString(std::to_string(score));
-    scoreValue.setCharacterSize(28);
-    scoreValue.setFillColor(sf::Color::White);
-    scoreValue.setStyle(sf::Text::Bold);
-    scoreValue.setPosition(GRID_WIDTH * TILE_SIZE + 35, scoreBoxY + 28);
-    window.draw(scoreValue);
-
-    // Draw the NEXT box
-    sf::RectangleShape nextBox(sf::Vector2f(boxWidth, bigBoxHeight));
-    nextBox.setPosition(GRID_WIDTH * TILE_SIZE + 15, nextBoxY);
-    nextBox.setFillColor(sf::Color(40, 60, 40));
-    nextBox.setOutlineColor(sf::Color::White);
-    nextBox.setOutlineThickness(2);
-    window.draw(nextBox);
-    sf::Text nextLabel;
-    nextLabel.setFont(font);
-    nextLabel.setString("NEXT");
-    nextLabel.setCharacterSize(18);
-    nextLabel.setFillColor(sf::Color(200, 255, 200));
-    nextLabel.setStyle(sf::Text::Bold);
-    nextLabel.setPosition(GRID_WIDTH * TILE_SIZE + 35, nextBoxY + 6);
-    window.draw(nextLabel);
-    // Center the next piece in the box, but move it higher
-    int nextBoxCenterX = GRID_WIDTH * TILE_SIZE + 15 + boxWidth / 2;
-    int nextBoxCenterY = nextBoxY + 55;
-    for (int i = 0; i < 4; ++i) {
-        int px = TETRIMINOS[nextTetrimino.shapeIndex][i] % 2;
-        int py = TETRIMINOS[nextTetrimino.shapeIndex][i] / 2;
-        sf::RectangleShape tile(sf::Vector2f(pieceTileSize, pieceTileSize));
-        tile.setPosition(nextBoxCenterX + (px - 1) * pieceTileSize, nextBoxCenterY + (py - 1) * pieceTileSize);
-        tile.setFillColor(TETRIMINO_COLORS[nextTetrimino.shapeIndex]);
-        tile.setOutlineColor(sf::Color::Black);
-        tile.setOutlineThickness(2);
-        window.draw(tile);
-    }
-
-    // Draw the HOLD box
-    sf::RectangleShape holdBox(sf::Vector2f(boxWidth, bigBoxHeight));
-    holdBox.setPosition(GRID_WIDTH * TILE_SIZE + 15, holdBoxY);
-    holdBox.setFillColor(sf::Color(60, 40, 40));
-    holdBox.setOutlineColor(sf::Color::White);
-    holdBox.setOutlineThickness(2);
-    window.draw(holdBox);
-    sf::Text holdLabel;
-    holdLabel.setFont(font);
-    holdLabel.setString("HOLD");
-    holdLabel.setCharacterSize(18);
-    holdLabel.setFillColor(sf::Color(255, 200, 200));
-    holdLabel.setStyle(sf::Text::Bold);
-    holdLabel.setPosition(GRID_WIDTH * TILE_SIZE + 35, holdBoxY + 6);
-    window.draw(holdLabel);
-    int holdBoxCenterX = GRID_WIDTH * TILE_SIZE + 15 + boxWidth / 2;
-    int holdBoxCenterY = holdBoxY + 55;
-    if (heldTetrimino) {
-        for (int i = 0; i < 4; ++i) {
-            int px = TETRIMINOS[heldTetrimino->shapeIndex][i] % 2;
-            int py = TETRIMINOS[heldTetrimino->shapeIndex][i] / 2;
-            sf::RectangleShape tile(sf::Vector2f(pieceTileSize, pieceTileSize));
-            tile.setPosition(holdBoxCenterX + (px - 1) * pieceTileSize, holdBoxCenterY + (py - 1) * pieceTileSize);
-            tile.setFillColor(TETRIMINO_COLORS[heldTetrimino->shapeIndex]);
-            tile.setOutlineColor(sf::Color::Black);
-            tile.setOutlineThickness(2);
-            window.draw(tile);
+    // Redessine seulement les zones dont la valeur a changé ; heldShape = -1 si rien n'est en réserve
+    void update(int score, int level, int nextShape, int heldShape) {
+        bool changed = false;
+        if (score != shownScore) {
+            restoreBox(scoreBoxY, scoreBoxHeight);
+            scoreValue.setString(std::to_string(score));
+            layer.draw(scoreValue);
+            shownScore = score;
+            changed = true;
+        }
+        if (nextShape != shownNext) {
+            restoreBox(nextBoxY, bigBoxHeight);
+            drawPiecePreview(nextBoxY, nextShape);
+            shownNext = nextShape;
+            changed = true;
         }
+        if (heldShape != shownHold) {
+            restoreBox(holdBoxY, bigBoxHeight);
+            if (heldShape >= 0) drawPiecePreview(holdBoxY, heldShape);
+            shownHold = heldShape;
+            changed = true;
+        }
+        if (level != shownLevel) {
+            restoreBox(levelBoxY, levelBoxHeight);
+            levelValue.setString(std::to_string(level));
+            // Centrer le nombre du niveau
+            sf::FloatRect textRect = levelValue.getLocalBounds();
+            levelValue.setOrigin(textRect.left + textRect.width / 2.0f, textRect.top + textRect.height / 2.0f);
+            levelValue.setPosition(boxX + boxWidth / 2, levelBoxY + 40);
+            layer.draw(levelValue);
+            shownLevel = level;
+            changed = true;
+        }
+        if (changed) layer.display();
     }
-    
-    // Draw LEVEL box at the bottom of the screen
-    const int levelBoxHeight = 60;
-    const int levelBoxY = GRID_HEIGHT * TILE_SIZE - levelBoxHeight - 15; // Position en bas avec une marge
-    
-    sf::RectangleShape levelBox(sf::Vector2f(boxWidth, levelBoxHeight));
-    levelBox.setPosition(GRID_WIDTH * TILE_SIZE + 15, levelBoxY);
-    levelBox.setFillColor(sf::Color(60, 60, 80));
-    levelBox.setOutlineColor(sf::Color::White);
-    levelBox.setOutlineThickness(2);
-    window.draw(levelBox);
-    
-    sf::Text levelLabel;
-    levelLabel.setFont(font);
-    levelLabel.setString("LEVEL");
-    levelLabel.setCharacterSize(18);
-    levelLabel.setFillColor(sf::Color(220, 220, 255));
-    levelLabel.setStyle(sf::Text::Bold);
-    levelLabel.setPosition(GRID_WIDTH * TILE_SIZE + 35, levelBoxY + 6);
-    window.draw(levelLabel);
-    
-    sf::Text levelValue;
-    levelValue.setFont(font);
-    levelValue.setString(std::to_string(level));
-    levelValue.setCharacterSize(30);
-    levelValue.setFillColor(sf::Color::Yellow);
-    levelValue.setStyle(sf::Text::Bold);
-    
-    // Centrer le nombre du niveau
-    sf::FloatRect textRect = levelValue.getLocalBounds();
-    levelValue.setOrigin(textRect.left + textRect.width / 2.0f, textRect.top + textRect.height / 2.0f);
-    levelValue.setPosition(GRID_WIDTH * TILE_SIZE + 15 + boxWidth / 2, levelBoxY + 40);
-    window.draw(levelValue);
-}
+
+    void draw(GameWindow& window) {
+        window.draw(sprite);
+    }
+};
 
 // Helper to get ghost piece position
 template<typename T>
-T getGhostTetrimino(const T& t, const std::vector<std::vector<int>>& grid) {
+T getGhostTetrimino(const T& t, const Board& grid) {
     T ghost = t;
-    while (true) {
-        T next = ghost;
-        next.y += 1;
-        if (!isValidPosition(next, grid)) break;
-        ghost = next;
-    }
+    ghost.y = grid.landingY(t);
     return ghost;
 }
 
+// Rendu du plateau en un seul tampon de sommets : un quad par case, plus la
+// pièce fantôme et la pièce courante. Les quads du plateau ne bougent jamais,
+// seules les rangées modifiées par le dernier verrouillage ou effacement sont
+// réécrites. Toutes les tuiles viennent d'un atlas généré au démarrage.
+const int ATLAS_MARGIN = 2;                         // place pour le contour de la pièce fantôme
+const int ATLAS_CELL = TILE_SIZE + 2 * ATLAS_MARGIN;
+const int FLASH_TILE = 7;                           // tuile blanche du clignotement
+const int GHOST_TILE = 8;
+const int GARBAGE_TILE = 9;                         // lignes reçues en mode versus
+const int ATLAS_TILES = 10;
+const sf::Color GARBAGE_COLOR(110, 110, 110);
+
+class BoardRenderer {
+private:
+    static const size_t BOARD_QUADS = GRID_WIDTH * GRID_HEIGHT;
+    static const size_t GHOST_QUAD = BOARD_QUADS;
+    static const size_t PIECE_QUAD = BOARD_QUADS + 4;
+
+    sf::Texture atlas;
+    sf::VertexArray vertices{sf::Quads, (BOARD_QUADS + 8) * 4};
+    std::uint32_t flashingRows = 0; // rangées réécrites à chaque image pendant l'animation
+
+    void createAtlas() {
+        sf::Image image;
+        image.create(ATLAS_CELL * ATLAS_TILES, ATLAS_CELL, sf::Color::Transparent);
+        auto fill = [&image](int tile, int from, int to, sf::Color color) {
+            for (int y = from; y < to; ++y)
+                for (int x = from; x < to; ++x)
+                    image.setPixel(tile * ATLAS_CELL + x, y, color);
+        };
+        const int tileEnd = ATLAS_MARGIN + TILE_SIZE - 1;
+        for (int i = 0; i < 7; ++i) fill(i, ATLAS_MARGIN, tileEnd, TETRIMINO_COLORS[i]);
+        fill(FLASH_TILE, ATLAS_MARGIN, tileEnd, sf::Color::White);
+        fill(GARBAGE_TILE, ATLAS_MARGIN, tileEnd, GARBAGE_COLOR);
+        // Pièce fantôme : contour de 2 pixels autour d'un remplissage translucide
+        fill(GHOST_TILE, 0, tileEnd + ATLAS_MARGIN, sf::Color(100, 100, 100, 120));
+        fill(GHOST_TILE, ATLAS_MARGIN, tileEnd, sf::Color(200, 200, 200, 80));
+        atlas.loadFromImage(image);
+    }
+
+    // Place le quad `quad` sur la case (x, y) avec la tuile `tile` de l'atlas, ou le cache si tile < 0
+    void setTile(size_t quad, int x, int y, int tile) {
+        sf::Vertex* v = &vertices[quad * 4];
+        float left = static_cast<float>(x * TILE_SIZE - ATLAS_MARGIN);
+        float top = static_cast<float>(y * TILE_SIZE - ATLAS_MARGIN);
+        v[0].position = sf::Vector2f(left, top);
+        v[1].position = sf::Vector2f(left + ATLAS_CELL, top);
+        v[2].position = sf::Vector2f(left + ATLAS_CELL, top + ATLAS_CELL);
+        v[3].position = sf::Vector2f(left, top + ATLAS_CELL);
+        float u = static_cast<float>(std::max(tile, 0) * ATLAS_CELL);
+        v[0].texCoords = sf::Vector2f(u, 0);
+        v[1].texCoords = sf::Vector2f(u + ATLAS_CELL, 0);
+        v[2].texCoords = sf::Vector2f(u + ATLAS_CELL, ATLAS_CELL);
+        v[3].texCoords = sf::Vector2f(u, ATLAS_CELL);
+        sf::Color color = tile < 0 ? sf::Color::Transparent : sf::Color::White;
+        for (int i = 0; i < 4; ++i) v[i].color = color;
+    }
+
+    void writeRow(const Board& grid, int y, bool flash) {
+        for (int x = 0; x < GRID_WIDTH; ++x) {
+            int cell = grid.cell(x, y);
+            int tile = cell == GARBAGE_CELL ? GARBAGE_TILE : cell - 1;
+            setTile(static_cast<size_t>(y * GRID_WIDTH + x), x, y, cell == 0 ? -1 : (flash ? FLASH_TILE : tile));
+        }
+    }
+
+    void writePiece(size_t firstQuad, const Tetrimino& piece, int tile, bool visible) {
+        auto positions = getBlockPositions(piece);
+        for (size_t i = 0; i < 4; ++i) {
+            const auto& pos = positions[i];
+            setTile(firstQuad + i, pos.x, pos.y, visible && pos.y >= 0 ? tile : -1);
+        }
+    }
+
+public:
+    // Statistiques pour le compteur de debug
+    int rowsWrittenLastFrame = 0;
+
+    BoardRenderer() {
+        createAtlas();
+    }
+
+    void update(TetrisEngine& engine) {
+        const Board& grid = engine.getGrid();
+        std::uint32_t dirty = engine.takeDirtyRows();
+        std::uint32_t clearing = engine.getClearingRows();
+        // Animate clearing lines - flash between white and the original color
+        float flashRate = 15.0f; // Flash speed
+        bool flash = static_cast<int>(engine.getClearAnimTimer() * flashRate) % 2 == 0;
+        // Les rangées qui clignotent, ou qui viennent d'arrêter, sont réécrites
+        dirty |= clearing | flashingRows;
+        flashingRows = clearing;
+
+        rowsWrittenLastFrame = 0;
+        for (int y = 0; y < GRID_HEIGHT; ++y) {
+            if (!(dirty & (1u << y))) continue;
+            writeRow(grid, y, flash && (clearing & (1u << y)));
+            rowsWrittenLastFrame++;
+        }
+
+        // Pièce fantôme et pièce courante : 8 quads réécrits à chaque image
+        const Tetrimino& current = engine.getCurrent();
+        bool showGhost = !engine.isGameOver() && !clearing;
+        writePiece(GHOST_QUAD, getGhostTetrimino(current, grid), GHOST_TILE, showGhost);
+        writePiece(PIECE_QUAD, current, current.shapeIndex, true);
+    }
+
+    void draw(GameWindow& window) {
+        window.draw(vertices, sf::RenderStates(&atlas));
+    }
+};
+
 // Animation state for line clear
 std::vector<int> clearingLines; // y indices of lines being cleared
 float clearAnimTimer = 0.0f;
 
-int main()
+// Collect the rows the engine is clearing into clearingLines
+void updateClearingLines(const TetrisEngine& engine) {
+    clearingLines.clear();
+    std::uint32_t rows = engine.getClearingRows();
+    for (int y = 0; y < GRID_HEIGHT; ++y)
+        if (rows & (1u << y)) clearingLines.push_back(y);
+    clearAnimTimer = engine.getClearAnimTimer();
+}
+
+// Map a key press to the engine action it triggers
+EngineInput inputForKey(sf::Keyboard::Key key) {
+    EngineInput input;
+    input.left = key == sf::Keyboard::Left;
+    input.right = key == sf::Keyboard::Right;
+    input.softDrop = key == sf::Keyboard::Down;
+    input.rotate = key == sf::Keyboard::Up;
+    input.hardDrop = key == sf::Keyboard::Space;
+    input.hold = key == sf::Keyboard::C;
+    return input;
+}
+
+// Aide "perfect clear" (touche H) : à chaque nouvelle pièce, cherche un
+// perfect clear en `maxPieces` pièces au plus (courante, suivante, réserve,
+// puis celles que le générateur va donner) et montre où poser la première.
+// La recherche tourne sur le thread de PcHintService, la fenêtre ne fait que
+// poster le problème et relever la réponse à chaque frame.
+class PerfectClearHint {
+private:
+    PcHintService service;
+    int maxPieces;
+    std::uint32_t postedId = 0;
+    bool shown = false;
+    bool found = false;
+    long solvedPiece = -1;
+    bool solvedCanHold = false;
+    sf::VertexArray quads{sf::Quads, 16};
+    sf::Text text;
+
+    static unsigned solverThreads() {
+        // Un cœur reste au rendu
+        unsigned hardware = std::thread::hardware_concurrency();
+        return hardware > 1 ? hardware - 1 : 1;
+    }
+
+    void show(const PcResult& result) {
+        shown = true;
+        found = result.found;
+        if (!result.found) {
+            text.setString(result.complete ? "No perfect clear within " + std::to_string(maxPieces) + " pieces"
+                                           : "Perfect clear search gave up");
+            return;
+        }
+        const Placement& first = result.steps[0];
+        text.setString("Perfect clear in " + std::to_string(result.steps.size()) +
+                       (first.useHold ? " (hold first)" : ""));
+        auto blocks = getBlockPositions(first.piece);
+        for (int i = 0; i < 4; ++i) {
+            float left = static_cast<float>(blocks[i].x * TILE_SIZE);
+            float top = static_cast<float>(blocks[i].y * TILE_SIZE);
+            sf::Vertex* quad = &quads[i * 4];
+            quad[0].position = sf::Vector2f(left, top);
+            quad[1].position = sf::Vector2f(left + TILE_SIZE, top);
+            quad[2].position = sf::Vector2f(left + TILE_SIZE, top + TILE_SIZE);
+            quad[3].position = sf::Vector2f(left, top + TILE_SIZE);
+            for (int v = 0; v < 4; ++v) quad[v].color = sf::Color(255, 215, 0, 110);
+        }
+    }
+
+public:
+    bool enabled = false;
+
+    PerfectClearHint(const sf::Font& font, int maxPieces_)
+        : service(solverThreads(), 20), maxPieces(std::max(1, maxPieces_)) {
+        text.setFont(font);
+        text.setCharacterSize(16);
+        text.setFillColor(sf::Color(255, 215, 0));
+        text.setPosition(4, GRID_HEIGHT * TILE_SIZE - 24);
+    }
+
+    void toggle() {
+        enabled = !enabled;
+        solvedPiece = -1;
+        shown = false;
+        if (!enabled) service.cancel();
+    }
+
+    void update(const TetrisEngine& engine) {
+        if (!enabled) return;
+        // Seule la réponse au dernier problème posté compte
+        PcHint hint;
+        if (service.poll(hint) && hint.id == postedId) show(hint.result);
+
+        if (engine.isGameOver() || engine.getClearingRows()) return;
+        if (engine.getPiecesPlaced() == solvedPiece && engine.getCanHold() == solvedCanHold) return;
+        solvedPiece = engine.getPiecesPlaced();
+        solvedCanHold = engine.getCanHold();
+
+        PcProblem problem;
+        problem.board = engine.getGrid();
+        problem.queue = {engine.getCurrent().shapeIndex, engine.getNext().shapeIndex};
+        for (int shape : engine.previewShapes(std::max(0, maxPieces - 2))) problem.queue.push_back(shape);
+        problem.hold = engine.getHeld() ? engine.getHeld()->shapeIndex : -1;
+        problem.canHold = engine.getCanHold();
+        problem.maxPieces = maxPieces;
+        postedId = service.post(problem);
+        shown = true;
+        found = false;
+        text.setString("Searching for a perfect clear...");
+    }
+
+    void draw(GameWindow& window) {
+        if (!enabled || !shown) return;
+        if (found) window.draw(quads);
+        window.draw(text);
+    }
+};
+
+// Mode versus (--connect) : plateau de l'adversaire en petit à droite du
+// panneau, lignes reçues en attente et état du match
+const int MINI_TILE = 15;
+const int OPPONENT_PANEL_WIDTH = GRID_WIDTH * MINI_TILE + 30;
+
+class OpponentView {
+private:
+    static const int left = GRID_WIDTH * TILE_SIZE + SCORE_PANEL_WIDTH + 15;
+    static const int top = 50;
+    sf::VertexArray quads{sf::Quads, (GRID_WIDTH * GRID_HEIGHT + 4) * 4};
+    sf::RectangleShape frame;
+    sf::Text label;
+    sf::Text status;
+
+    void setQuad(size_t quad, int x, int y, sf::Color color) {
+        sf::Vertex* v = &quads[quad * 4];
+        float px = static_cast<float>(left + x * MINI_TILE), py = static_cast<float>(top + y * MINI_TILE);
+        v[0].position = sf::Vector2f(px, py);
+        v[1].position = sf::Vector2f(px + MINI_TILE - 1, py);
+        v[2].position = sf::Vector2f(px + MINI_TILE - 1, py + MINI_TILE - 1);
+        v[3].position = sf::Vector2f(px, py + MINI_TILE - 1);
+        for (int i = 0; i < 4; ++i) v[i].color = color;
+    }
+
+public:
+    explicit OpponentView(const sf::Font& font) {
+        frame.setSize(sf::Vector2f(GRID_WIDTH * MINI_TILE, GRID_HEIGHT * MINI_TILE));
+        frame.setPosition(left, top);
+        frame.setFillColor(sf::Color(20, 20, 20));
+        frame.setOutlineColor(sf::Color(120, 120, 120));
+        frame.setOutlineThickness(2);
+        label.setFont(font);
+        label.setCharacterSize(18);
+        label.setFillColor(sf::Color(255, 200, 200));
+        label.setString("OPPONENT");
+        label.setPosition(left, 15);
+        status.setFont(font);
+        status.setCharacterSize(16);
+        status.setFillColor(sf::Color::White);
+        status.setPosition(left, top + GRID_HEIGHT * MINI_TILE + 15);
+    }
+
+    void update(const VersusConnection& connection) {
+        const VersusReplica& replica = connection.replica;
+        bool started = replica.state != VersusReplica::Idle;
+        const TetrisEngine& opponent = replica.match.player(1 - std::max(replica.you, 0));
+        const Board& grid = opponent.getGrid();
+        for (int y = 0; y < GRID_HEIGHT; ++y)
+            for (int x = 0; x < GRID_WIDTH; ++x) {
+                int cell = started ? grid.cell(x, y) : 0;
+                sf::Color color = cell == 0 ? sf::Color::Transparent
+                                  : cell == GARBAGE_CELL ? GARBAGE_COLOR : TETRIMINO_COLORS[cell - 1];
+                setQuad(static_cast<size_t>(y * GRID_WIDTH + x), x, y, color);
+            }
+        auto blocks = getBlockPositions(opponent.getCurrent());
+        bool showPiece = started && !opponent.isGameOver() && !opponent.getClearingRows();
+        for (int i = 0; i < 4; ++i)
+            setQuad(GRID_WIDTH * GRID_HEIGHT + i, blocks[i].x, std::max(blocks[i].y, 0),
+                    showPiece && blocks[i].y >= 0 ? TETRIMINO_COLORS[opponent.getCurrent().shapeIndex] : sf::Color::Transparent);
+
+        std::string text;
+        if (!connection.isOpen()) text = "Disconnected";
+        else if (connection.searching) text = "Waiting for\nan opponent...";
+        else if (started) {
+            const TetrisEngine& self = replica.match.player(replica.you);
+            text = "Incoming: " + std::to_string(self.getGarbagePending()) +
+                   "\nTheir lines: " + std::to_string(opponent.getLinesCleared());
+        }
+        status.setString(text);
+    }
+
+    void draw(GameWindow& window) {
+        window.draw(frame);
+        window.draw(quads);
+        window.draw(label);
+        window.draw(status);
+    }
+};
+
+// Envoie au serveur les touches d'un placement de l'IA, comme executePlacement()
+void sendPlacement(VersusConnection& connection, const Placement& placement) {
+    EngineInput press;
+    if (placement.useHold) {
+        press.hold = true;
+        connection.sendKeys(press.toBits());
+        press.hold = false;
+    }
+    press.rotate = true;
+    for (int i = 0; i < placement.rotations; ++i) connection.sendKeys(press.toBits());
+    press.rotate = false;
+    press.left = placement.moveX < 0;
+    press.right = placement.moveX > 0;
+    for (int i = 0; i < std::abs(placement.moveX); ++i) connection.sendKeys(press.toBits());
+    press.left = press.right = false;
+    press.hardDrop = true;
+    connection.sendKeys(press.toBits());
+}
+
+// Au plus 1/4 s de simulation rattrapée par image après un blocage
+const int MAX_TICKS_PER_FRAME = TICK_RATE / 4;
+
+// Save the game being recorded, if --record was given
+void saveRecording(const std::string& path, const TetrisEngine& engine, const std::vector<InputEvent>& events) {
+    if (path.empty() || events.empty()) return;
+    if (saveInputLog(path, makeInputLog(engine, events)))
+        std::cout << "Input log saved to " << path << " (seed " << engine.getSeed() << ")\n";
+    else
+        std::cerr << "Failed to write input log: " << path << "\n";
+}
+
+// Titre de la fenêtre selon le mode (versus) et le pilote automatique
+std::string windowTitle(bool versus, bool autoplay) {
+    if (versus && autoplay) return "Tetris (versus, autoplay)";
+    if (versus) return "Tetris (versus)";
+    return autoplay ? "Tetris (autoplay)" : "Tetris";
+}
+
+int main(int argc, char** argv)
 {
+    // Options : --seed N pour rejouer une partie, --record FILE pour enregistrer les entrées,
+    // --high-gravity pour la gravité 20G après le niveau 10, --weights FILE pour les poids de l'IA,
+    // --shm NAME pour publier l'état en mémoire partagée et recevoir les actions d'un bot externe,
+    // --connect HOST:PORT pour jouer en versus sur un tetris_server,
+    // --pc-pieces N pour l'horizon de l'aide perfect clear (10 par défaut)
+    std::string recordPath;
+    std::string serverAddress;
+    std::string shmName;
+    bool fixedSeed = false;
+    bool highGravity = false;
+    int pcPieces = 10;
+    unsigned seed = 0;
+    AiConfig aiConfig;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--record" && hasValue) recordPath = argv[++i];
+        else if (arg == "--seed" && hasValue) {
+            seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+            fixedSeed = true;
+        }
+        else if (arg == "--high-gravity") highGravity = true;
+        else if (arg == "--shm" && hasValue) shmName = argv[++i];
+        else if (arg == "--connect" && hasValue) serverAddress = argv[++i];
+        else if (arg == "--pc-pieces" && hasValue) pcPieces = std::atoi(argv[++i]);
+        else if (arg == "--weights" && hasValue && !loadEvalWeights(argv[++i], aiConfig.weights))
+            std::cerr << "Failed to load AI weights from: " << argv[i] << "\n";
+    }
+
     // Extend the window width to fit the score display
-    const int SCORE_PANEL_WIDTH = 150;
-    sf::RenderWindow window(sf::VideoMode(GRID_WIDTH * TILE_SIZE + SCORE_PANEL_WIDTH, GRID_HEIGHT * TILE_SIZE), "Tetris");
+    bool versus = !serverAddress.empty();
+    int windowWidth = GRID_WIDTH * TILE_SIZE + SCORE_PANEL_WIDTH + (versus ? OPPONENT_PANEL_WIDTH : 0);
+    GameWindow window(sf::VideoMode(windowWidth, GRID_HEIGHT * TILE_SIZE), windowTitle(versus, false));
     window.setFramerateLimit(60);
 
     sf::Font font;
@@ -493,30 +917,68 @@ int main()
         return -1;
     }
 
-    // Initialize grid
-    std::vector<std::vector<int>> grid(GRID_HEIGHT, std::vector<int>(GRID_WIDTH, 0));
+    std::random_device seedSource;
+    if (!fixedSeed) seed = seedSource();
 
-    // Initialize random seed
-    std::srand(static_cast<unsigned>(std::time(nullptr)));
+    // Toutes les règles du jeu vivent dans le moteur, à pas fixe
+    TetrisEngine engine;
+    engine.setHighGravity(highGravity);
+    engine.reset(seed);
+    std::vector<InputEvent> recordedInputs;
+    if (!recordPath.empty()) engine.setRecorder(&recordedInputs);
+    bool recordingSaved = false;
+    double tickAccumulator = 0.0;
 
-    // Création des tetriminos
-    Tetrimino currentTetrimino(std::rand() % 7);
-    Tetrimino nextTetrimino(std::rand() % 7);
+    // Joueur automatique, activé avec la touche A
+    TetrisAI ai(aiConfig);
+    bool autoplay = false;
 
-    Tetrimino* heldTetrimino = nullptr;
-    bool canHold = true;
-    // Variable holdUsedSincePlacement supprimée car non utilisée
+    // Interface pour les bots externes : état publié à chaque frame, actions lues dans l'anneau
+    SharedMemoryLink botLink;
+    GameSnapshot botSnapshot;
+    if (!shmName.empty()) {
+        if (botLink.create(shmName)) std::cout << "Bot interface on shared memory " << shmName << "\n";
+        else std::cerr << "Failed to create shared memory: " << shmName << "\n";
+    }
+
+    // Client versus : le serveur fait foi, le plateau affiché est notre copie du match
+    VersusConnection connection;
+    long sentForPiece = -1; // pièce pour laquelle l'IA a déjà envoyé ses touches
+    if (versus) {
+        std::string host;
+        int port;
+        parseHostPort(serverAddress, host, port);
+        if (!connection.connectTo(host, port)) {
+            std::cerr << "Failed to connect to " << host << ":" << port << "\n";
+            return -1;
+        }
+        connection.findMatch();
+    }
 
     sf::Clock clock;
-    float fallTimer = 0.0f;
 
     bool paused = false;
-    bool gameOver = false;
     clearingLines.clear();
     clearAnimTimer = 0.0f;
 
-    // Création du système de particules
+    // Création du système de particules, sur son propre flux de la graine de la partie
     ParticleSystem particleSystem;
+    particleSystem.seedEffects(seed);
+
+    // Rendu du plateau et compteur de debug
+    BoardRenderer boardRenderer;
+    SidePanel sidePanel(font);
+    PerfectClearHint pcHint(font, pcPieces);
+    OpponentView opponentView(font);
+    bool showDebug = false;
+    sf::Clock frameClock;
+    float frameCpuMs = 0.0f;
+    int lastDrawCalls = 0;
+    sf::Text debugText;
+    debugText.setFont(font);
+    debugText.setCharacterSize(14);
+    debugText.setFillColor(sf::Color::Green);
+    debugText.setPosition(4, 4);
 
     // Main game loop
     while (window.isOpen())
@@ -526,327 +988,184 @@ int main()
         {
             if (event.type == sf::Event::Closed)
             {
+                if (!recordingSaved) saveRecording(recordPath, engine, recordedInputs);
                 window.close();
             }
             if (event.type == sf::Event::KeyPressed)
             {
                 if (event.key.code == sf::Keyboard::Escape)
                 {
+                    if (!recordingSaved) saveRecording(recordPath, engine, recordedInputs);
                     window.close();
                 }
-                if (gameOver) {
+                if (versus && event.key.code == sf::Keyboard::R) {
+                    // Nouveau match une fois le précédent terminé
+                    if (!connection.playing()) {
+                        connection.findMatch();
+                        sentForPiece = -1;
+                    }
+                    continue;
+                }
+                if (!versus && engine.isGameOver()) {
                     if (event.key.code == sf::Keyboard::R) {
                         // Reset game state
-                        grid = std::vector<std::vector<int>>(GRID_HEIGHT, std::vector<int>(GRID_WIDTH, 0));
-                        score = 0;
-                        level = 1; // Réinitialiser le niveau
-                        linesCleared = 0; // Réinitialiser les lignes
-                        fallDelay = 0.5f; // Réinitialiser la vitesse
-                        currentTetrimino = Tetrimino(std::rand() % 7);
-                        nextTetrimino = Tetrimino(std::rand() % 7);
-                        if (heldTetrimino) { delete heldTetrimino; heldTetrimino = nullptr; } // Reset hold
-                        gameOver = false;
+                        engine.reset(seedSource());
+                        recordingSaved = false;
                         paused = false;
+                        tickAccumulator = 0.0;
                         clock.restart();
                     }
                     continue;
                 }
-                if (paused) continue;
-                Tetrimino temp = currentTetrimino;
-                if (event.key.code == sf::Keyboard::Left)
-                {
-                    temp.x -= 1;
-                    if (isValidPosition(temp, grid)) currentTetrimino = temp;
-                }
-                else if (event.key.code == sf::Keyboard::Right)
-                {
-                    temp.x += 1;
-                    if (isValidPosition(temp, grid)) currentTetrimino = temp;
-                }
-                else if (event.key.code == sf::Keyboard::Down)
-                {
-                    temp.y += 1;
-                    if (isValidPosition(temp, grid)) {
-                        currentTetrimino = temp;
-                        // Points pour soft drop
-                        score += scoreSystem.getSoftDropPoints();
-                    }
+                if (event.key.code == sf::Keyboard::F3) {
+                    showDebug = !showDebug;
+                    continue;
                 }
-                else if (event.key.code == sf::Keyboard::Up)
-                {
-                    rotateTetrimino(temp, grid);
-                    if (isValidPosition(temp, grid)) currentTetrimino = temp;
+                if (event.key.code == sf::Keyboard::H) {
+                    pcHint.toggle();
+                    continue;
                 }
-                else if (event.key.code == sf::Keyboard::Space)
-                {
-                    // Hard drop effect
-                    Tetrimino drop = currentTetrimino;
-                    int dropDistance = 0; // Compter la distance parcourue
-                    
-                    while (true) {
-                        Tetrimino next = drop;
-                        next.y += 1;
-                        if (!isValidPosition(next, grid)) break;
-                        drop = next;
-                        dropDistance++; // Augmenter la distance
-                    }
-                    
-                    // Ajouter des points pour le hard drop
-                    score += dropDistance * scoreSystem.getHardDropPoints();
-                    
-                    // Place the Tetrimino on the grid
-                    placeTetrimino(drop, grid);
-                    
-                    // Detect lines to clear
-                    clearingLines.clear();
-                    for (int y = 0; y < GRID_HEIGHT; ++y) {
-                        bool full = true;
-                        for (int x = 0; x < GRID_WIDTH; ++x)
-                            if (grid[y][x] == 0) { full = false; break; }
-                        if (full) clearingLines.push_back(y);
-                    }
-                    
-                    // Gérer les points pour les lignes complétées
-                    if (!clearingLines.empty()) {
-                        // Les points seront ajoutés après l'animation
-                        clearAnimTimer = 0.0f;
-                    } else {
-                        currentTetrimino = nextTetrimino;
-                        nextTetrimino = Tetrimino(std::rand() % 7);
-                        if (!isValidPosition(currentTetrimino, grid))
-                            gameOver = true;
-                        canHold = true;  // Réactiver le hold pour la nouvelle pièce
-                    }
+                if (event.key.code == sf::Keyboard::A) {
+                    autoplay = !autoplay;
+                    window.setTitle(windowTitle(versus, autoplay));
+                    continue;
                 }
-                if (!gameOver && !paused && event.key.code == sf::Keyboard::C && canHold) {
-                    if (!heldTetrimino) {
-                        heldTetrimino = new Tetrimino(currentTetrimino.shapeIndex);
-                        currentTetrimino = nextTetrimino;
-                        nextTetrimino = Tetrimino(std::rand() % 7);
-                    } else {
-                        std::swap(currentTetrimino.shapeIndex, heldTetrimino->shapeIndex);
-                        currentTetrimino.rotation = 0;
-                        currentTetrimino.x = GRID_WIDTH / 2 - 1;
-                        currentTetrimino.y = 0;
-                    }
-                    canHold = false;  // Désactiver le hold jusqu'au prochain placement
+                if (paused || autoplay) continue;
+                if (versus) {
+                    // Le serveur applique la touche, on la verra revenir avec son numéro de tick
+                    connection.sendKeys(inputForKey(event.key.code).toBits());
+                    continue;
                 }
+                // Appliquée entre deux ticks, et enregistrée avec le numéro du tick
+                engine.step(inputForKey(event.key.code), 0);
             }
         }
 
-        // Clear the window
-        window.clear(sf::Color::Black);
+        frameClock.restart();
+        window.drawCalls = 0;
 
         // Calculer deltaTime même si on est en pause ou game over pour les animations de particules
         float deltaTime = clock.restart().asSeconds();
         
-        if (!paused && !gameOver) {
-            fallTimer += deltaTime;
-            
-            // Update line clear animation if active
-            if (!clearingLines.empty()) {
-                clearAnimTimer += deltaTime;
-                
-                // Générer des effets pendant l'animation
-                if (clearAnimTimer < CLEAR_ANIM_DURATION / 2) {
-                    // Animation standard pour les autres modes d'effacement
-                    if (clearAnimTimer < 0.05f) {
-                        // Génération de particules standard pour chaque ligne complète
-                        for (int lineY : clearingLines) {
-                            particleSystem.createLineExplosion(lineY, grid);
-                        }
-                        
-                        // Ajouter des ondes de choc si plusieurs lignes sont complétées
-                        if (clearingLines.size() >= 2) {
-                            // Couleurs différentes selon le nombre de lignes
-                            sf::Color shockColor;
-                            float maxRadius = 200.0f;
-                            
-                            if (clearingLines.size() == 4) {
-                                // Tetris (4 lignes) - Onde dorée plus grande
-                                shockColor = sf::Color(255, 215, 0); // Or
-                                maxRadius = 400.0f;
-                            } else if (clearingLines.size() == 3) {
-                                // 3 lignes - Onde violette
-                                shockColor = sf::Color(200, 0, 255);
-                                maxRadius = 350.0f;
-                            } else {
-                                // 2 lignes - Onde bleue
-                                shockColor = sf::Color(30, 144, 255);
-                                maxRadius = 300.0f;
-                            }
-                            
-                            // Créer une onde pour chaque ligne, mais avec des tailles différentes pour un effet en cascade
-                            for (size_t i = 0; i < clearingLines.size(); i++) {
-                                float scaleFactor = 0.7f + (0.3f * (i / static_cast<float>(clearingLines.size())));
-                                particleSystem.createShockWaveForLine(clearingLines[i], shockColor, maxRadius * scaleFactor);
-                            }
-                            
-                            // Pour un Tetris, ajouter une onde de choc supplémentaire au centre
-                            if (clearingLines.size() == 4) {
-                                // Calculer le centre approximatif des 4 lignes
-                                int avgY = 0;
-                                for (int lineY : clearingLines) {
-                                    avgY += lineY;
-                                }
-                                avgY /= 4;
-                                
-                                sf::Vector2f centerPos(GRID_WIDTH * TILE_SIZE / 2, avgY * TILE_SIZE + TILE_SIZE / 2);
-                                particleSystem.addShockWave(ShockWave(centerPos, 450.0f, sf::Color::White, 1.0f));
-                            }
-                        }
-                    }
+        if (versus) {
+            // Rejouer les entrées reçues, puis afficher notre joueur
+            connection.pump();
+            const VersusReplica& replica = connection.replica;
+            if (replica.state != VersusReplica::Idle) {
+                TetrisEngine& self = connection.replica.match.player(replica.you);
+                engine = self;
+                self.takeDirtyRows(); // la copie affichée les a déjà
+                if (autoplay && connection.playing() && !engine.isGameOver() && !engine.getClearingRows() &&
+                    engine.getPiecesPlaced() != sentForPiece) {
+                    Placement placement;
+                    if (ai.decide(engine, placement)) sendPlacement(connection, placement);
+                    sentForPiece = engine.getPiecesPlaced();
+                }
+            }
+        } else if (!paused) {
+            // L'IA pose la pièce dès qu'elle apparaît
+            if (autoplay && !engine.isGameOver() && !engine.getClearingRows()) {
+                Placement placement;
+                if (ai.decide(engine, placement)) executePlacement(engine, placement);
+            }
+            // Actions des bots, appliquées entre deux ticks comme les touches
+            BotAction botAction;
+            while (botLink.isOpen() && botLink.poll(botAction))
+                if (!engine.isGameOver()) applyBotAction(engine, botAction);
+            // Simulation à pas fixe, indépendante de la fréquence d'affichage
+            tickAccumulator += deltaTime;
+            int ticks = static_cast<int>(tickAccumulator * TICK_RATE);
+            if (ticks > MAX_TICKS_PER_FRAME) {
+                ticks = MAX_TICKS_PER_FRAME;
+                tickAccumulator = 0.0;
+            } else {
+                tickAccumulator -= ticks / static_cast<double>(TICK_RATE);
+            }
+            engine.step(EngineInput(), ticks);
+        } else {
+            clock.restart();
+        }
+        if (botLink.isOpen()) {
+            fillSnapshot(engine, botSnapshot);
+            botLink.publish(botSnapshot);
+        }
+        if (engine.isGameOver() && !recordingSaved) {
+            saveRecording(recordPath, engine, recordedInputs);
+            recordingSaved = true;
+        }
+
+        const Board& grid = engine.getGrid();
+        bool gameOver = engine.isGameOver() || connection.replica.state == VersusReplica::Ended;
+        updateClearingLines(engine);
+
+        // Générer des effets pendant l'animation
+        if (!clearingLines.empty() && clearAnimTimer < CLEAR_ANIM_DURATION / 2) {
+            // Animation standard pour les autres modes d'effacement
+            if (clearAnimTimer < 0.05f) {
+                // Génération de particules standard pour chaque ligne complète
+                for (int lineY : clearingLines) {
+                    particleSystem.createLineExplosion(lineY, grid);
                 }
                 
-                if (clearAnimTimer >= CLEAR_ANIM_DURATION) {
-                    // Animation finished - clear lines and update score
-                    int numLinesCleared = clearingLines.size();
-                    
-                    // Ajouter les points selon le nombre de lignes
-                    score += getLinesClearPoints(numLinesCleared, level);
+                // Ajouter des ondes de choc si plusieurs lignes sont complétées
+                if (clearingLines.size() >= 2) {
+                    // Couleurs différentes selon le nombre de lignes
+                    sf::Color shockColor;
+                    float maxRadius = 200.0f;
                     
-                    // Mettre à jour le total des lignes complétées
-                    linesCleared += numLinesCleared;
-                    
-                    // Vérifier si on doit augmenter le niveau
-                    if (linesCleared >= level * LINES_PER_LEVEL) {
-                        level++;
-                        // Accélérer la vitesse de chute
-                        fallDelay = std::max(0.05f, 0.5f - (level-1) * 0.05f);
+                    if (clearingLines.size() == 4) {
+                        // Tetris (4 lignes) - Onde dorée plus grande
+                        shockColor = sf::Color(255, 215, 0); // Or
+                        maxRadius = 400.0f;
+                    } else if (clearingLines.size() == 3) {
+                        // 3 lignes - Onde violette
+                        shockColor = sf::Color(200, 0, 255);
+                        maxRadius = 350.0f;
+                    } else {
+                        // 2 lignes - Onde bleue
+                        shockColor = sf::Color(30, 144, 255);
+                        maxRadius = 300.0f;
                     }
                     
-                    // Créer une nouvelle grille temporaire sans les lignes complètes
-                    std::vector<std::vector<int>> newGrid(GRID_HEIGHT, std::vector<int>(GRID_WIDTH, 0));
-                    int destRow = GRID_HEIGHT - 1;
-                    
-                    // Copier uniquement les lignes non complètes de bas en haut
-                    for (int y = GRID_HEIGHT - 1; y >= 0; --y) {
-                        if (std::find(clearingLines.begin(), clearingLines.end(), y) == std::end(clearingLines)) {
-                            // Cette ligne n'est pas pleine, la copier
-                            for (int x = 0; x < GRID_WIDTH; ++x) {
-                                newGrid[destRow][x] = grid[y][x];
-                            }
-                            destRow--;
-                        }
-                        // Si c'est une ligne pleine, ne pas la copier (sauter)
+                    // Créer une onde pour chaque ligne, mais avec des tailles différentes pour un effet en cascade
+                    for (size_t i = 0; i < clearingLines.size(); i++) {
+                        float scaleFactor = 0.7f + (0.3f * (i / static_cast<float>(clearingLines.size())));
+                        particleSystem.createShockWaveForLine(clearingLines[i], shockColor, maxRadius * scaleFactor);
                     }
                     
-                    // Remplacer la grille d'origine par la nouvelle grille
-                    grid = newGrid;
-                    
-                    // Reset animation state
-                    clearingLines.clear();
-                    clearAnimTimer = 0.0f;
-                    
-                    // Get next tetrimino
-                    currentTetrimino = nextTetrimino;
-                    nextTetrimino = Tetrimino(std::rand() % 7);
-                    if (!isValidPosition(currentTetrimino, grid))
-                        gameOver = true;
-                    canHold = true;  // Réactiver le hold pour la nouvelle pièce
-                }
-            }
-            // Only process falling if not animating line clear
-            else if (fallTimer >= fallDelay) {
-                fallTimer = 0.0f;
-                Tetrimino temp = currentTetrimino;
-                temp.y += 1;
-                if (isValidPosition(temp, grid))
-                {
-                    currentTetrimino = temp;
-                }
-                else
-                {
-                    placeTetrimino(currentTetrimino, grid);
-                    // Detect lines to clear
-                    clearingLines.clear();
-                    for (int y = 0; y < GRID_HEIGHT; ++y) {
-                        bool full = true;
-                        for (int x = 0; x < GRID_WIDTH; ++x)
-                            if (grid[y][x] == 0) { full = false; break; }
-                        if (full) clearingLines.push_back(y);
-                    }
-                    
-                    // If no lines to clear, continue with next piece
-                    if (clearingLines.empty()) {
-                        currentTetrimino = nextTetrimino;
-                        nextTetrimino = Tetrimino(std::rand() % 7);
-                        if (!isValidPosition(currentTetrimino, grid))
-                            gameOver = true;
-                        canHold = true;  // Réactiver le hold pour la nouvelle pièce
-                    }
-                    // Otherwise start animation
-                    else {
-                        clearAnimTimer = 0.0f;
+                    // Pour un Tetris, ajouter une onde de choc supplémentaire au centre
+                    if (clearingLines.size() == 4) {
+                        // Calculer le centre approximatif des 4 lignes
+                        int avgY = 0;
+                        for (int lineY : clearingLines) {
+                            avgY += lineY;
+                        }
+                        avgY /= 4;
+                        
+                        sf::Vector2f centerPos(GRID_WIDTH * TILE_SIZE / 2, avgY * TILE_SIZE + TILE_SIZE / 2);
+                        particleSystem.addShockWave(centerPos, 450.0f, sf::Color::White, 1.0f);
                     }
                 }
             }
-        } else if (paused) {
-            clock.restart();
         }
 
         // Clear the window
         window.clear(sf::Color::Black);
 
-        // Draw the grid with line clear animation
-        for (int y = 0; y < GRID_HEIGHT; ++y)
-        {
-            for (int x = 0; x < GRID_WIDTH; ++x)
-            {
-                if (grid[y][x] != 0)
-                {
-                    sf::RectangleShape tile(sf::Vector2f(TILE_SIZE - 1, TILE_SIZE - 1));
-                    tile.setPosition(x * TILE_SIZE, y * TILE_SIZE);
-                    
-                    // Animate clearing lines - flash between white and the original color
-                    bool isClearing = std::find(clearingLines.begin(), clearingLines.end(), y) != clearingLines.end();
-                    if (isClearing) {
-                        float flashRate = 15.0f; // Flash speed
-                        bool flash = static_cast<int>(clearAnimTimer * flashRate) % 2 == 0;
-                        if (flash) {
-                            tile.setFillColor(sf::Color::White);
-                        } else {
-                            tile.setFillColor(TETRIMINO_COLORS[grid[y][x] - 1]);
-                        }
-                    } else {
-                        tile.setFillColor(TETRIMINO_COLORS[grid[y][x] - 1]);
-                    }
-                    window.draw(tile);
-                }
-            }
-        }
-
-        // Draw the ghost piece
-        if (!gameOver && clearingLines.empty()) {
-            Tetrimino ghost = getGhostTetrimino(currentTetrimino, grid);
-            auto ghostPositions = getBlockPositions(ghost);
-            for (const auto& pos : ghostPositions) {
-                if (pos.y >= 0) {
-                    sf::RectangleShape tile(sf::Vector2f(TILE_SIZE - 1, TILE_SIZE - 1));
-                    tile.setPosition(pos.x * TILE_SIZE, pos.y * TILE_SIZE);
-                    tile.setFillColor(sf::Color(200, 200, 200, 80));
-                    tile.setOutlineColor(sf::Color(100, 100, 100, 120));
-                    tile.setOutlineThickness(2);
-                    window.draw(tile);
-                }
-            }
-        }
+        // Draw the grid, ghost and current piece in one call
+        boardRenderer.update(engine);
+        boardRenderer.draw(window);
+        pcHint.update(engine);
+        pcHint.draw(window);
 
-        // Draw the current Tetrimino
-        auto positions = getBlockPositions(currentTetrimino);
-        for (const auto &pos : positions)
-        {
-            if (pos.y >= 0)
-            {
-                sf::RectangleShape tile(sf::Vector2f(TILE_SIZE - 1, TILE_SIZE - 1));
-                tile.setPosition(pos.x * TILE_SIZE, pos.y * TILE_SIZE);
-                tile.setFillColor(TETRIMINO_COLORS[currentTetrimino.shapeIndex]);
-                window.draw(tile);
-            }
+        const Tetrimino* held = engine.getHeld();
+        sidePanel.update(engine.getScore(), engine.getLevel(), engine.getNext().shapeIndex, held ? held->shapeIndex : -1);
+        sidePanel.draw(window);
+        if (versus) {
+            opponentView.update(connection);
+            opponentView.draw(window);
         }
 
-        drawSidePanel(window, font, score, nextTetrimino, heldTetrimino);
-
         // Draw pause overlay if paused
         if (paused) {
             sf::RectangleShape overlay(sf::Vector2f(GRID_WIDTH * TILE_SIZE + SCORE_PANEL_WIDTH, GRID_HEIGHT * TILE_SIZE));
@@ -880,6 +1199,16 @@ int main()
             overText.setString("GAME OVER");
             overText.setCharacterSize(48);
             overText.setFillColor(sf::Color::Red);
+            const VersusReplica& replica = connection.replica;
+            if (versus && replica.state == VersusReplica::Ended) {
+                if (replica.winner == DRAW) overText.setString("DRAW");
+                else if (replica.winner == replica.you) {
+                    overText.setString(replica.endReason == END_OPPONENT_LEFT ? "THEY LEFT" : "YOU WIN");
+                    overText.setFillColor(sf::Color::Green);
+                } else {
+                    overText.setString("YOU LOSE");
+                }
+            }
             overText.setStyle(sf::Text::Bold);
             sf::FloatRect overRect = overText.getLocalBounds();
             overText.setOrigin(overRect.left + overRect.width / 2.0f, overRect.top + overRect.height / 2.0f);
@@ -891,7 +1220,8 @@ int main()
             // Draw restart instruction text, smaller and just below GAME OVER
             sf::Text restartText;
             restartText.setFont(font);
-            restartText.setString("Press R to restart");
+            restartText.setString(versus ? (connection.searching ? "Waiting for an opponent" : "Press R for a new match")
+                                         : "Press R to restart");
             restartText.setCharacterSize(22);
             restartText.setFillColor(sf::Color::White);
             restartText.setStyle(sf::Text::Regular);
@@ -905,11 +1235,22 @@ int main()
         particleSystem.update(deltaTime);
         particleSystem.draw(window);
 
+        // Compteur de debug : appels de dessin et temps CPU de l'image précédente
+        if (showDebug) {
+            debugText.setString("draw calls: " + std::to_string(lastDrawCalls) +
+                                "\ncpu: " + std::to_string(frameCpuMs).substr(0, 5) + " ms" +
+                                "\nrows: " + std::to_string(boardRenderer.rowsWrittenLastFrame) +
+                                "\nparticles: " + std::to_string(particleSystem.getLiveCount()) +
+                                " (peak " + std::to_string(particleSystem.getPeakCount()) +
+                                ", dropped " + std::to_string(particleSystem.getDroppedCount()) + ")");
+            window.draw(debugText);
+        }
+        lastDrawCalls = window.drawCalls;
+        frameCpuMs = frameClock.getElapsedTime().asMicroseconds() / 1000.0f;
+
         // Display the window
         window.display();
     }
 
-    if (heldTetrimino) delete heldTetrimino;
-
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,178 @@
+// Perfect-clear solver CLI: searches a position given on the command line or
+// taken from a recorded game, and prints the placements or proves there are none.
+
+#include "pc_solver.hpp"
+#include "replay.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+const char PIECE_LETTERS[] = "IZSTLJO"; // same order as TETRIMINOS
+
+struct PcOptions {
+    std::string field;       // rows top to bottom, '/' between rows
+    std::string queue;       // piece letters, first = current piece
+    int hold = -1;
+    bool canHold = true;
+    std::string replayPath;
+    long piece = 0;          // position in the recorded game
+    int preview = 5;         // pieces seen after the next one in a recorded game
+    int maxPieces = 10;
+    unsigned threads = 0;
+    long nodeLimit = 0;
+};
+
+void printUsage() {
+    std::cout << "Usage: tetris_pc --field ROWS --queue PIECES [--hold P] [--no-hold]\n"
+              << "       tetris_pc --replay FILE [--piece K] [--preview N]\n"
+              << "       common: [--max-pieces N] [--threads T] [--node-limit N]\n"
+              << "  ROWS lists the bottom rows, top to bottom, separated by '/', with X for\n"
+              << "  a filled cell and . for an empty one, e.g. XXXXXX..../XXXXXXX...\n"
+              << "  PIECES are letters from IZSTLJO, the first one is the current piece\n"
+              << "  --replay solves the position where piece K of a recorded game spawns,\n"
+              << "  with the current, next and N more pieces of that game as the queue\n";
+}
+
+int pieceFromLetter(char c) {
+    for (int i = 0; i < 7; ++i)
+        if (PIECE_LETTERS[i] == c) return i;
+    return -1;
+}
+
+bool parseOptions(int argc, char** argv, PcOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--field" && hasValue) options.field = argv[++i];
+        else if (arg == "--queue" && hasValue) options.queue = argv[++i];
+        else if (arg == "--hold" && hasValue) options.hold = pieceFromLetter(argv[++i][0]);
+        else if (arg == "--no-hold") options.canHold = false;
+        else if (arg == "--replay" && hasValue) options.replayPath = argv[++i];
+        else if (arg == "--piece" && hasValue) options.piece = std::atol(argv[++i]);
+        else if (arg == "--preview" && hasValue) options.preview = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--max-pieces" && hasValue) options.maxPieces = std::atoi(argv[++i]);
+        else if (arg == "--threads" && hasValue) options.threads = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if (arg == "--node-limit" && hasValue) options.nodeLimit = std::atol(argv[++i]);
+        else return false;
+    }
+    return options.maxPieces > 0 && (!options.replayPath.empty() || !options.queue.empty());
+}
+
+// Bottom-aligned rows from the "XX../X..." notation
+bool parseField(const std::string& text, Board& board) {
+    std::vector<std::string> rows;
+    std::string row;
+    for (char c : text + "/") {
+        if (c != '/') {
+            row += c;
+            continue;
+        }
+        if (!row.empty()) rows.push_back(row);
+        row.clear();
+    }
+    if (rows.size() > static_cast<size_t>(GRID_HEIGHT)) return false;
+    board.reset();
+    int y = GRID_HEIGHT - static_cast<int>(rows.size());
+    for (const std::string& r : rows) {
+        if (r.size() != static_cast<size_t>(GRID_WIDTH)) return false;
+        for (int x = 0; x < GRID_WIDTH; ++x) {
+            if (r[x] == '.') continue;
+            if (r[x] != 'X' && r[x] != '#') return false;
+            board.rows[y] |= static_cast<RowBits>(1u << x);
+            board.colors[y][x] = 1;
+        }
+        ++y;
+    }
+    board.updateSurface();
+    return true;
+}
+
+void printField(const Board& board) {
+    int top = GRID_HEIGHT;
+    for (int y = 0; y < GRID_HEIGHT; ++y)
+        if (board.rows[y]) {
+            top = y;
+            break;
+        }
+    for (int y = top; y < GRID_HEIGHT; ++y) {
+        std::cout << "  |";
+        for (int x = 0; x < GRID_WIDTH; ++x) std::cout << ((board.rows[y] >> x) & 1 ? 'X' : '.');
+        std::cout << "|\n";
+    }
+    std::cout << "  +----------+\n";
+}
+
+int main(int argc, char** argv) {
+    PcOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+
+    PcProblem problem;
+    problem.maxPieces = options.maxPieces;
+    problem.nodeLimit = options.nodeLimit;
+    if (!options.replayPath.empty()) {
+        InputLog log;
+        if (!loadInputLog(options.replayPath, log)) {
+            std::cerr << "Cannot read input log " << options.replayPath << "\n";
+            return 1;
+        }
+        TetrisEngine engine;
+        replayInputLog(log, engine, options.piece);
+        if (engine.isGameOver() || engine.getPiecesPlaced() < options.piece) {
+            std::cerr << "The recorded game ends after " << engine.getPiecesPlaced() << " pieces\n";
+            return 1;
+        }
+        problem.board = engine.getGrid();
+        problem.queue.push_back(engine.getCurrent().shapeIndex);
+        problem.queue.push_back(engine.getNext().shapeIndex);
+        for (int shape : engine.previewShapes(options.preview)) problem.queue.push_back(shape);
+        problem.hold = engine.getHeld() ? engine.getHeld()->shapeIndex : -1;
+        problem.canHold = engine.getCanHold();
+        std::cout << "position: piece " << engine.getPiecesPlaced() << " of " << options.replayPath << "\n";
+    } else {
+        if (!parseField(options.field, problem.board)) {
+            std::cerr << "Bad --field, expected rows of " << GRID_WIDTH << " X/. cells separated by '/'\n";
+            return 1;
+        }
+        for (char c : options.queue) {
+            int shape = pieceFromLetter(c);
+            if (shape < 0) {
+                std::cerr << "Unknown piece '" << c << "', use IZSTLJO\n";
+                return 1;
+            }
+            problem.queue.push_back(shape);
+        }
+        problem.hold = options.hold;
+        problem.canHold = options.canHold;
+    }
+
+    std::string queueText;
+    for (int shape : problem.queue) queueText += PIECE_LETTERS[shape];
+    std::cout << "queue:    " << queueText << "  hold: " << (problem.hold >= 0 ? PIECE_LETTERS[problem.hold] : '-')
+              << (problem.canHold ? "" : " (used)") << "\n";
+    printField(problem.board);
+
+    PerfectClearSolver solver(options.threads);
+    PcResult result = solver.solve(problem);
+
+    if (result.found) {
+        std::cout << "perfect clear: " << result.steps.size() << " pieces, " << result.height << " rows\n";
+        for (size_t i = 0; i < result.steps.size(); ++i) {
+            const Placement& step = result.steps[i];
+            std::cout << "  " << i + 1 << ". " << PIECE_LETTERS[step.piece.shapeIndex] << "  rotate " << step.rotations
+                      << "  move " << (step.moveX > 0 ? "+" : "") << step.moveX << (step.useHold ? "  (hold first)" : "")
+                      << "\n";
+        }
+    } else if (result.complete) {
+        std::cout << "no perfect clear within " << options.maxPieces << " pieces\n";
+    } else {
+        std::cout << "unknown: node limit reached\n";
+    }
+    std::cout << "threads:  " << solver.getThreadCount() << "\n"
+              << "nodes:    " << result.nodes << " (" << result.memoHits << " memo hits)\n"
+              << "time:     " << result.seconds * 1000.0 << " ms\n";
+    return result.found ? 0 : 2;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "pc_solver.hpp"
+#include "../common/mailbox.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+// Perfect-clear search for the game window, on its own thread. A horizon of
+// ten or more pieces can take far longer than a frame, so the render loop
+// only posts problems and polls for answers, the same way the Connect Four
+// window talks to its AnalysisService:
+//  - window to service: the latest problem goes through a Mailbox, and an
+//    interrupt flag makes the solver drop the problem it is working on
+//  - service to window: each finished search comes back through a second
+//    Mailbox, tagged with the id of the problem it answers
+
+struct PcHintRequest {
+    PcProblem problem;
+    std::uint32_t id = 0;
+    bool active = false;  // false only cancels the running search
+};
+
+struct PcHint {
+    std::uint32_t id = 0;  // request the result belongs to
+    PcResult result;
+};
+
+class PcHintService {
+public:
+    PcHintService(unsigned threads, int memoLog2) : solver(threads, memoLog2) {
+        solver.setAbortFlag(&interrupt);
+        worker = std::thread([this] { run(); });
+    }
+
+    ~PcHintService() {
+        quitting.store(true);
+        interrupt.store(true);
+        wake.notify_one();
+        worker.join();
+        solver.setAbortFlag(nullptr);
+    }
+
+    PcHintService(const PcHintService&) = delete;
+    PcHintService& operator=(const PcHintService&) = delete;
+
+    // Window thread: solve this problem from now on; returns the id its
+    // answer will carry
+    std::uint32_t post(const PcProblem& problem) { return send(problem, true); }
+
+    // Window thread: stop searching, the hint is no longer shown
+    void cancel() { send(PcProblem(), false); }
+
+    // Window thread, every frame
+    bool poll(PcHint& hint) { return hints.fetch(hint); }
+
+private:
+    std::uint32_t send(const PcProblem& problem, bool active) {
+        PcHintRequest request;
+        request.problem = problem;
+        request.id = ++lastId;
+        request.active = active;
+        requests.publish(request);
+        interrupt.store(true, std::memory_order_release);
+        // No lock here: a missed wake-up only costs one idle timeout
+        wake.notify_one();
+        return request.id;
+    }
+
+    void run() {
+        PcHintRequest request;
+        bool pending = false;
+        while (!quitting.load()) {
+            // The flag can go up after the request it announces was already
+            // taken, so an empty mailbox keeps the current request
+            if (interrupt.exchange(false, std::memory_order_acquire) && requests.fetch(request)) pending = true;
+            if (!pending || !request.active) {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait_for(lock, std::chrono::milliseconds(20), [this] { return interrupt.load() || quitting.load(); });
+                continue;
+            }
+            PcHint hint;
+            hint.id = request.id;
+            hint.result = solver.solve(request.problem);
+            // Interrupted: pick up the new request, or redo this one
+            if (interrupt.load()) continue;
+            hints.publish(hint);
+            pending = false;
+        }
+    }
+
+    PerfectClearSolver solver;
+    std::uint32_t lastId = 0;  // window thread only
+
+    Mailbox<PcHintRequest> requests;
+    Mailbox<PcHint> hints;
+    std::atomic<bool> interrupt{false};
+    std::atomic<bool> quitting{false};
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::thread worker;
+};
@@ -0,0 +1,294 @@
+#pragma once
+
+#include "ai.hpp"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+// Perfect-clear solver: looks for a sequence of hard-drop placements (the
+// moves generatePlacements() produces, with hold) that empties the board,
+// or proves that the given queue cannot do it.
+//
+// A perfect clear of height h fills exactly the bottom h rows, so the
+// search fixes h up front from the cell count and never lets a piece stick
+// out above it. Every node is then checked before it is expanded:
+//  - cell count: the empty cells left in the field need exactly empty / 4
+//    more pieces, which must fit in the queue and the piece budget
+//  - fillable regions: a column that is filled in every field row can never
+//    be crossed, and it stays full through line clears, so the empty cells
+//    between two such columns must be a multiple of 4
+// An empty board looks for the next perfect clear.
+// Positions already proven dead are remembered in a lock-free table keyed
+// on the field, queue position and hold. The top of the tree is expanded
+// breadth-first and the subtrees are searched on the thread pool.
+
+struct PcProblem {
+    Board board;
+    std::vector<int> queue;   // queue[0] is the piece to place now
+    int hold = -1;            // held shape, -1 when the hold slot is empty
+    bool canHold = true;      // false when hold was already used for queue[0]
+    int maxPieces = 10;
+    long nodeLimit = 0;       // 0 = search until solved or proven impossible
+};
+
+struct PcResult {
+    bool found = false;
+    bool complete = true;     // false when the node limit stopped the search
+    int height = 0;           // rows of the perfect clear
+    std::vector<Placement> steps; // useHold is set on steps that swap with hold
+    long nodes = 0;
+    long memoHits = 0;
+    double seconds = 0.0;
+};
+
+class PerfectClearSolver {
+public:
+    explicit PerfectClearSolver(unsigned threads = 0, int memoLog2 = 20) : pool(threads), memo(memoLog2) {}
+
+    unsigned getThreadCount() const { return pool.size(); }
+
+    // A flag another thread raises to abandon the running solve, which then
+    // returns with complete = false
+    void setAbortFlag(const std::atomic<bool>* flag) { abortFlag = flag; }
+
+    PcResult solve(const PcProblem& problem) {
+        auto start = std::chrono::steady_clock::now();
+        PcResult result;
+        setup(problem);
+        auto finish = [&]() {
+            result.nodes = nodes.load();
+            result.memoHits = memoHits.load();
+            result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            return result;
+        };
+
+        int cells = 0, top = GRID_HEIGHT;
+        for (int y = 0; y < GRID_HEIGHT; ++y) {
+            cells += __builtin_popcount(problem.board.rows[y]);
+            if (problem.board.rows[y] && y < top) top = y;
+        }
+        int maxPieces = std::min(problem.maxPieces, availablePieces(0, problem.hold));
+        // Cell parity picks the possible heights: 10h - cells must be 4 pieces each
+        for (int height = std::max(1, GRID_HEIGHT - top); height <= GRID_HEIGHT; ++height) {
+            int empty = height * 10 - cells;
+            if (empty / 4 > maxPieces) break;
+            if (empty % 4 != 0) continue;
+            if (search(problem, height, result)) {
+                result.found = true;
+                result.height = height;
+                break;
+            }
+            if (nodeLimitHit.load() || aborted()) {
+                result.complete = false;
+                break;
+            }
+        }
+        return finish();
+    }
+
+private:
+    struct Node {
+        Board board;
+        int height;  // field rows still to clear
+        int index;   // next queue entry
+        int hold;
+        Placement move; // how this node was reached
+    };
+
+    void setup(const PcProblem& problem) {
+        queue = problem.queue;
+        rootHold = problem.hold;
+        maxPieces = problem.maxPieces;
+        nodeLimit = problem.nodeLimit;
+        searchId++; // entries from earlier solves stop matching, no need to clear the table
+        nodes.store(0);
+        memoHits.store(0);
+        nodeLimitHit.store(false);
+    }
+
+    int availablePieces(int index, int hold) const {
+        return static_cast<int>(queue.size()) - index + (hold >= 0 ? 1 : 0);
+    }
+
+    int piecesPlaced(int index, int hold) const {
+        return index + (rootHold >= 0 ? 1 : 0) - (hold >= 0 ? 1 : 0);
+    }
+
+    // Cell count and fillable-region checks on a field of `height` rows
+    bool viable(const Board& board, int height, int index, int hold) const {
+        RowBits fullColumns = FULL_ROW;
+        int filled = 0;
+        for (int y = GRID_HEIGHT - height; y < GRID_HEIGHT; ++y) {
+            fullColumns &= board.rows[y];
+            filled += __builtin_popcount(board.rows[y]);
+        }
+        int needed = (height * 10 - filled) / 4;
+        if (needed > availablePieces(index, hold) || needed > maxPieces - piecesPlaced(index, hold)) return false;
+
+        // Empty cells between two full columns (or a wall) must come in fours
+        unsigned remaining = FULL_ROW & ~fullColumns;
+        while (remaining) {
+            unsigned low = remaining & (0u - remaining);
+            unsigned wallsRight = (fullColumns & ~(low - 1)) | (1u << GRID_WIDTH);
+            unsigned segment = (wallsRight & (0u - wallsRight)) - low; // columns up to the next full one
+            int empty = 0;
+            for (int y = GRID_HEIGHT - height; y < GRID_HEIGHT; ++y)
+                empty += __builtin_popcount(segment & ~board.rows[y]);
+            if (empty % 4) return false;
+            remaining &= ~segment;
+        }
+        return true;
+    }
+
+    std::uint64_t stateKey(const Board& board, int height, int index, int hold) const {
+        std::uint64_t extra = searchId << 32 | static_cast<std::uint64_t>(index) << 16 |
+                              static_cast<std::uint64_t>(hold + 1) << 8 | static_cast<std::uint64_t>(height);
+        return hashBoard(board) ^ splitMix64(extra);
+    }
+
+    // Children of a node: the current queue piece, or the hold alternative
+    void expand(const Node& node, bool canHold, std::vector<Node>& out, std::vector<Placement>& moves) const {
+        int index = node.index;
+        if (index >= static_cast<int>(queue.size()) && node.hold < 0) return;
+        int current = index < static_cast<int>(queue.size()) ? queue[index] : -1;
+
+        auto addPiece = [&](int shape, bool useHold, int nextIndex, int nextHold) {
+            moves.clear();
+            generatePlacements(node.board, Tetrimino(shape), moves);
+            int fieldTop = GRID_HEIGHT - node.height;
+            for (Placement& p : moves) {
+                bool inField = true;
+                for (const Cell& c : getBlockPositions(p.piece)) inField = inField && c.y >= fieldTop;
+                if (!inField) continue;
+                Node child;
+                child.board = node.board;
+                int lines = 0;
+                applyPlacement(child.board, p.piece, lines);
+                child.height = node.height - lines;
+                child.index = nextIndex;
+                child.hold = nextHold;
+                if (child.height > 0 && !viable(child.board, child.height, nextIndex, nextHold)) continue;
+                child.move = p;
+                child.move.useHold = useHold;
+                out.push_back(child);
+            }
+        };
+
+        if (current >= 0) addPiece(current, false, index + 1, node.hold);
+        if (!canHold) return;
+        if (node.hold < 0) {
+            // Holding into an empty slot plays the piece after it
+            if (index + 1 < static_cast<int>(queue.size()) && queue[index + 1] != current)
+                addPiece(queue[index + 1], true, index + 2, current);
+        } else if (node.hold != current) {
+            addPiece(node.hold, true, index + 1, current);
+        }
+    }
+
+    bool aborted() const { return abortFlag && abortFlag->load(std::memory_order_relaxed); }
+
+    bool stopped() const {
+        return solvedFlag.load(std::memory_order_relaxed) || nodeLimitHit.load(std::memory_order_relaxed) || aborted();
+    }
+
+    // Depth-first search below `node`; `path` holds the moves from the root
+    bool dfs(const Node& node, std::vector<Placement>& path, std::vector<std::vector<Node>>& levels,
+             std::vector<Placement>& moves, size_t depth) {
+        long count = nodes.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (nodeLimit && count > nodeLimit) {
+            nodeLimitHit.store(true);
+            return false;
+        }
+        std::vector<Node>& children = levels[depth];
+        children.clear();
+        expand(node, true, children, moves);
+        for (size_t i = 0; i < children.size(); ++i) {
+            if (stopped()) return false;
+            const Node& child = children[i];
+            path.push_back(child.move);
+            if (child.height == 0) return true;
+            std::uint64_t key = stateKey(child.board, child.height, child.index, child.hold);
+            double dead;
+            if (memo.probe(key, dead)) {
+                memoHits.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                if (dfs(child, path, levels, moves, depth + 1)) return true;
+                if (!stopped()) memo.store(key, 0.0);
+            }
+            path.pop_back();
+        }
+        return false;
+    }
+
+    bool search(const PcProblem& problem, int height, PcResult& result) {
+        solvedFlag.store(false);
+        Node root;
+        root.board = problem.board;
+        root.height = height;
+        root.index = 0;
+        root.hold = problem.hold;
+        if (!viable(root.board, height, 0, root.hold)) return false;
+
+        // Breadth-first until there is enough work to spread over the threads
+        struct Task {
+            Node node;
+            std::vector<Placement> path;
+        };
+        std::vector<Task> frontier(1);
+        frontier[0].node = root;
+        std::vector<Node> children;
+        std::vector<Placement> moves;
+        bool rootLevel = true;
+        while (frontier.size() < pool.size() * 8u) {
+            std::vector<Task> next;
+            for (const Task& task : frontier) {
+                children.clear();
+                expand(task.node, rootLevel ? problem.canHold : true, children, moves);
+                nodes.fetch_add(1);
+                for (const Node& child : children) {
+                    Task t;
+                    t.node = child;
+                    t.path = task.path;
+                    t.path.push_back(child.move);
+                    if (child.height == 0) {
+                        result.steps = t.path;
+                        return true;
+                    }
+                    next.push_back(t);
+                }
+            }
+            rootLevel = false;
+            if (next.empty()) return false;
+            frontier.swap(next);
+        }
+
+        std::mutex solutionMutex;
+        pool.parallelFor(frontier.size(), [&](size_t i) {
+            if (stopped()) return;
+            thread_local std::vector<std::vector<Node>> levels;
+            thread_local std::vector<Placement> localMoves;
+            // One child buffer per depth; every level places a piece, so maxPieces + 1 is enough
+            if (levels.size() < static_cast<size_t>(maxPieces) + 1) levels.resize(maxPieces + 1);
+            std::vector<Placement> path = frontier[i].path;
+            if (dfs(frontier[i].node, path, levels, localMoves, 0)) {
+                std::lock_guard<std::mutex> lock(solutionMutex);
+                if (!solvedFlag.exchange(true)) result.steps = path;
+            }
+        });
+        return solvedFlag.load();
+    }
+
+    ThreadPool pool;
+    TranspositionTable memo; // dead positions
+    std::vector<int> queue;
+    int rootHold = -1;
+    int maxPieces = 0;
+    long nodeLimit = 0;
+    std::uint64_t searchId = 0;
+    std::atomic<long> nodes{0};
+    std::atomic<long> memoHits{0};
+    std::atomic<bool> solvedFlag{false};
+    std::atomic<bool> nodeLimitHit{false};
+    const std::atomic<bool>* abortFlag = nullptr;
+};
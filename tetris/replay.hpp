@@ -0,0 +1,208 @@
+#pragma once
+
+#include "engine.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Binary input logs for TetrisEngine. A log holds the seed and every input
+// applied during one game; replaying it reproduces the game bit for bit.
+//
+// File layout, all integers little-endian:
+//   "TRPL"  magic
+//   u8      format version
+//   u16     tick rate the log was recorded at
+//   u32     seed
+//   u8      flags, bit 0 = high gravity
+//   u32     last tick simulated
+//   u32     event count, then per event: varint tick delta, u8 key bits
+//   u32     final score, u32 lines cleared, u32 pieces placed, u64 state hash
+
+const std::uint8_t REPLAY_VERSION = 4; // 3: PCG32 piece generator, 4: unbiased piece draws
+
+struct ReplayResult {
+    std::uint32_t score = 0;
+    std::uint32_t lines = 0;
+    std::uint32_t pieces = 0;
+    std::uint64_t stateHash = 0;
+
+    bool operator==(const ReplayResult& other) const {
+        return score == other.score && lines == other.lines && pieces == other.pieces &&
+               stateHash == other.stateHash;
+    }
+    bool operator!=(const ReplayResult& other) const { return !(*this == other); }
+};
+
+struct InputLog {
+    unsigned seed = 0;
+    bool highGravity = false;
+    std::uint32_t endTick = 0;
+    std::vector<InputEvent> events;
+    ReplayResult expected; // state of the engine when the log was saved
+};
+
+// FNV-1a over everything that decides how the game continues
+inline std::uint64_t engineStateHash(const TetrisEngine& engine) {
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    auto mix = [&hash](std::uint64_t value) {
+        for (int i = 0; i < 8; ++i) {
+            hash ^= (value >> (i * 8)) & 0xFF;
+            hash *= 0x100000001b3ull;
+        }
+    };
+    auto mixPiece = [&mix](const Tetrimino& t) {
+        mix(static_cast<std::uint64_t>(t.shapeIndex) | static_cast<std::uint64_t>(t.rotation) << 8 |
+            static_cast<std::uint64_t>(t.x & 0xFF) << 16 | static_cast<std::uint64_t>(t.y & 0xFF) << 24);
+    };
+    const EngineState& s = engine.saveState();
+    for (RowBits row : s.grid.rows) mix(row);
+    mixPiece(s.currentTetrimino);
+    mix(static_cast<std::uint64_t>(s.nextTetrimino.shapeIndex));
+    mix(s.hasHeld ? static_cast<std::uint64_t>(s.heldTetrimino.shapeIndex) : 0xFF);
+    mix(s.tick);
+    mix(static_cast<std::uint64_t>(s.score));
+    mix(s.rng.state);
+    mix(static_cast<std::uint64_t>(s.level) | static_cast<std::uint64_t>(s.linesCleared) << 32);
+    mix(static_cast<std::uint64_t>(s.fallTimer) | static_cast<std::uint64_t>(s.clearAnimTimer) << 32);
+    mix(s.clearingRows | static_cast<std::uint64_t>(s.canHold) << 32 | static_cast<std::uint64_t>(s.gameOver) << 40);
+    mix(static_cast<std::uint64_t>(s.garbagePending) | static_cast<std::uint64_t>(s.garbageOut) << 32);
+    for (int i = 0; i < s.garbagePending; ++i) mix(static_cast<std::uint64_t>(s.garbageHoles[i]));
+    return hash;
+}
+
+inline ReplayResult replayResultOf(const TetrisEngine& engine) {
+    ReplayResult result;
+    result.score = static_cast<std::uint32_t>(engine.getScore());
+    result.lines = static_cast<std::uint32_t>(engine.getLinesCleared());
+    result.pieces = static_cast<std::uint32_t>(engine.getPiecesPlaced());
+    result.stateHash = engineStateHash(engine);
+    return result;
+}
+
+// Capture the game recorded through TetrisEngine::setRecorder(&events)
+inline InputLog makeInputLog(const TetrisEngine& engine, const std::vector<InputEvent>& events) {
+    InputLog log;
+    log.seed = engine.getSeed();
+    log.highGravity = engine.getHighGravity();
+    log.endTick = engine.getTick();
+    log.events = events;
+    log.expected = replayResultOf(engine);
+    return log;
+}
+
+// Re-run the log on `engine` as fast as possible. With stopAtPiece >= 0 the
+// replay stops as soon as that many pieces are locked and the next one has
+// spawned, before any input moves it.
+inline ReplayResult replayInputLog(const InputLog& log, TetrisEngine& engine, long stopAtPiece = -1) {
+    engine.setHighGravity(log.highGravity);
+    engine.reset(log.seed);
+    size_t next = 0;
+    auto reachedStop = [&]() {
+        return stopAtPiece >= 0 && engine.getPiecesPlaced() >= stopAtPiece && !engine.getClearingRows();
+    };
+    while (true) {
+        // Key presses land between ticks, in the order they were made
+        while (next < log.events.size() && log.events[next].tick == engine.getTick() && !reachedStop())
+            engine.step(EngineInput::fromBits(log.events[next++].keys), 0);
+        if (reachedStop() || engine.isGameOver() || engine.getTick() >= log.endTick) break;
+        engine.step(EngineInput(), 1);
+    }
+    return replayResultOf(engine);
+}
+
+namespace replay_io {
+
+inline void writeBytes(std::ostream& out, std::uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) out.put(static_cast<char>((value >> (i * 8)) & 0xFF));
+}
+
+inline bool readBytes(std::istream& in, std::uint64_t& value, int bytes) {
+    value = 0;
+    for (int i = 0; i < bytes; ++i) {
+        int c = in.get();
+        if (c == EOF) return false;
+        value |= static_cast<std::uint64_t>(c & 0xFF) << (i * 8);
+    }
+    return true;
+}
+
+inline void writeVarint(std::ostream& out, std::uint32_t value) {
+    while (value >= 0x80) {
+        out.put(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.put(static_cast<char>(value));
+}
+
+inline bool readVarint(std::istream& in, std::uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        int c = in.get();
+        if (c == EOF) return false;
+        value |= static_cast<std::uint32_t>(c & 0x7F) << shift;
+        if (!(c & 0x80)) return true;
+    }
+    return false;
+}
+
+} // namespace replay_io
+
+inline bool saveInputLog(const std::string& path, const InputLog& log) {
+    using namespace replay_io;
+    std::ofstream out(path, std::ios::binary);
+    if (!out) return false;
+    out.write("TRPL", 4);
+    writeBytes(out, REPLAY_VERSION, 1);
+    writeBytes(out, TICK_RATE, 2);
+    writeBytes(out, log.seed, 4);
+    writeBytes(out, log.highGravity ? 1 : 0, 1);
+    writeBytes(out, log.endTick, 4);
+    writeBytes(out, log.events.size(), 4);
+    std::uint32_t previous = 0;
+    for (const InputEvent& event : log.events) {
+        writeVarint(out, event.tick - previous);
+        writeBytes(out, event.keys, 1);
+        previous = event.tick;
+    }
+    writeBytes(out, log.expected.score, 4);
+    writeBytes(out, log.expected.lines, 4);
+    writeBytes(out, log.expected.pieces, 4);
+    writeBytes(out, log.expected.stateHash, 8);
+    return static_cast<bool>(out);
+}
+
+// Fails on a missing file, a bad header or a log recorded at another tick rate
+inline bool loadInputLog(const std::string& path, InputLog& log) {
+    using namespace replay_io;
+    std::ifstream in(path, std::ios::binary);
+    char magic[4];
+    if (!in.read(magic, 4) || std::string(magic, 4) != "TRPL") return false;
+    std::uint64_t version, tickRate, seed, flags, endTick, count;
+    if (!readBytes(in, version, 1) || version != REPLAY_VERSION) return false;
+    if (!readBytes(in, tickRate, 2) || tickRate != static_cast<std::uint64_t>(TICK_RATE)) return false;
+    if (!readBytes(in, seed, 4) || !readBytes(in, flags, 1) || !readBytes(in, endTick, 4) || !readBytes(in, count, 4)) return false;
+    log.seed = static_cast<unsigned>(seed);
+    log.highGravity = flags & 1;
+    log.endTick = static_cast<std::uint32_t>(endTick);
+    log.events.clear();
+    log.events.reserve(static_cast<size_t>(std::min<std::uint64_t>(count, 1 << 20)));
+    std::uint32_t tick = 0;
+    for (std::uint64_t i = 0; i < count; ++i) {
+        std::uint32_t delta;
+        std::uint64_t keys;
+        if (!readVarint(in, delta) || !readBytes(in, keys, 1)) return false;
+        tick += delta;
+        log.events.push_back(InputEvent{tick, static_cast<std::uint8_t>(keys)});
+    }
+    std::uint64_t score, lines, pieces, hash;
+    if (!readBytes(in, score, 4) || !readBytes(in, lines, 4) || !readBytes(in, pieces, 4) || !readBytes(in, hash, 8))
+        return false;
+    log.expected.score = static_cast<std::uint32_t>(score);
+    log.expected.lines = static_cast<std::uint32_t>(lines);
+    log.expected.pieces = static_cast<std::uint32_t>(pieces);
+    log.expected.stateHash = hash;
+    return true;
+}
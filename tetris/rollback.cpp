@@ -0,0 +1,254 @@
+// Rollback netcode harness: two RollbackSession peers play a versus match
+// over an in-process link with a chosen latency and jitter. Both players
+// are driven by the AI (or random presses), and every so often the state
+// both peers agree on is checked against a plain lockstep run of the true
+// inputs, so any divergence in save / restore / resimulation shows up.
+
+#include "ai.hpp"
+#include "rollback.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+struct RollbackOptions {
+    long ticks = TICK_RATE * 60;
+    double delayMs = 40.0;  // one way
+    double jitterMs = 15.0;
+    int inputDelay = 2;
+    int maxRollback = 16;
+    unsigned seed = 1;
+    bool random = false;    // random presses instead of the AI
+    int pressEvery = 8;     // random: average ticks between presses; AI: most ticks of thought per piece
+    int checkEvery = 60;    // frames between checks against the reference
+    AiConfig aiConfig;
+};
+
+void printUsage() {
+    std::cout << "Usage: tetris_rollback [--ticks N] [--delay-ms D] [--jitter-ms J] [--input-delay K]\n"
+              << "                       [--max-rollback R] [--seed S] [--random] [--press-every T]\n"
+              << "                       [--beam W]\n"
+              << "  Plays a versus match between two rollback peers over a simulated link\n"
+              << "  (one-way delay D ms plus up to J ms of jitter) and checks that both\n"
+              << "  peers end up in the same state as a lockstep run of the same inputs.\n"
+              << "  The AI pauses up to T ticks before each piece; --random presses a\n"
+              << "  random key every T ticks on average instead\n";
+}
+
+bool parseOptions(int argc, char** argv, RollbackOptions& options) {
+    options.aiConfig.threads = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--ticks" && hasValue) options.ticks = std::atol(argv[++i]);
+        else if (arg == "--delay-ms" && hasValue) options.delayMs = std::atof(argv[++i]);
+        else if (arg == "--jitter-ms" && hasValue) options.jitterMs = std::atof(argv[++i]);
+        else if (arg == "--input-delay" && hasValue) options.inputDelay = std::atoi(argv[++i]);
+        else if (arg == "--max-rollback" && hasValue) options.maxRollback = std::atoi(argv[++i]);
+        else if (arg == "--seed" && hasValue) options.seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--random") options.random = true;
+        else if (arg == "--press-every" && hasValue) options.pressEvery = std::atoi(argv[++i]);
+        else if (arg == "--beam" && hasValue) options.aiConfig.beamWidth = std::max(1, std::atoi(argv[++i]));
+        else return false;
+    }
+    return options.ticks > 0 && options.delayMs >= 0 && options.jitterMs >= 0 && options.inputDelay >= 0 &&
+           options.inputDelay <= 16 && options.maxRollback > 0 && options.maxRollback < ROLLBACK_STATES &&
+           options.pressEvery > 0;
+}
+
+// Keys one peer's player presses, one per tick
+class Controller {
+public:
+    Controller(const RollbackOptions& options_, unsigned seed) : options(options_), ai(options_.aiConfig), rng(seed) {}
+
+    // Keys for the next tick; consume() once the session accepted them
+    std::uint8_t peek(const TetrisEngine& engine) {
+        if (options.random) {
+            if (pending == 0xFF) pending = rng() % options.pressEvery ? 0 : randomKeys();
+            return pending;
+        }
+        if (queue.empty() && !engine.isGameOver() && !engine.getClearingRows() &&
+            engine.getPiecesPlaced() != plannedFor) {
+            Placement placement;
+            if (ai.decide(engine, placement)) {
+                // A random pause first, so the two players do not mirror each other
+                queue.insert(queue.end(), rng() % options.pressEvery, 0);
+                queuePlacement(placement);
+            }
+            plannedFor = engine.getPiecesPlaced();
+        }
+        return queue.empty() ? 0 : queue.front();
+    }
+
+    void consume() {
+        if (options.random) pending = 0xFF;
+        else if (!queue.empty()) queue.pop_front();
+    }
+
+private:
+    std::uint8_t randomKeys() {
+        EngineInput input;
+        switch (rng() % 8) {
+            case 0: case 1: input.left = true; break;
+            case 2: case 3: input.right = true; break;
+            case 4: input.rotate = true; break;
+            case 5: input.softDrop = true; break;
+            case 6: input.hardDrop = true; break;
+            default: input.hold = true; break;
+        }
+        return input.toBits();
+    }
+
+    // Same presses as executePlacement(), spread over consecutive ticks
+    void queuePlacement(const Placement& placement) {
+        EngineInput press;
+        if (placement.useHold) {
+            press.hold = true;
+            queue.push_back(press.toBits());
+            press.hold = false;
+        }
+        press.rotate = true;
+        for (int i = 0; i < placement.rotations; ++i) queue.push_back(press.toBits());
+        press.rotate = false;
+        press.left = placement.moveX < 0;
+        press.right = placement.moveX > 0;
+        for (int i = 0; i < std::abs(placement.moveX); ++i) queue.push_back(press.toBits());
+        press.left = press.right = false;
+        press.hardDrop = true;
+        queue.push_back(press.toBits());
+    }
+
+    const RollbackOptions& options;
+    TetrisAI ai;
+    std::mt19937 rng;
+    std::deque<std::uint8_t> queue;
+    long plannedFor = -1;
+    std::uint8_t pending = 0xFF;
+};
+
+// Checks the states both peers consider final against a lockstep match
+class Referee {
+public:
+    explicit Referee(unsigned seed) : reference(seed) {}
+
+    void record(std::uint32_t tick, int player, std::uint8_t keys) {
+        if (keys) inputs.push_back(VersusInput{tick, static_cast<std::uint8_t>(player), keys});
+    }
+
+    // False when a peer's confirmed state differs from the reference
+    bool check(const RollbackSession* const sessions[2]) {
+        std::uint32_t upTo = UINT32_MAX;
+        for (int p = 0; p < 2; ++p)
+            upTo = std::min({upTo, sessions[p]->getConfirmedTick(), sessions[p]->getMatch().getTick()});
+        if (upTo <= reference.getTick() && checks) return true;
+
+        // Inputs arrive per player; the session presses player 0 first
+        std::stable_sort(inputs.begin() + static_cast<long>(next), inputs.end(),
+                         [](const VersusInput& a, const VersusInput& b) {
+                             return a.tick != b.tick ? a.tick < b.tick : a.player < b.player;
+                         });
+        reference.runTo(upTo, inputs, next);
+        upTo = reference.getTick(); // stops early when the match is over
+        checks++;
+        for (int p = 0; p < 2; ++p) {
+            VersusMatch copy;
+            if (sessions[p]->getMatch().getTick() == upTo) {
+                if (sessions[p]->getMatch().stateHash() != reference.stateHash()) return false;
+                continue;
+            }
+            const VersusState* state = sessions[p]->stateAt(upTo);
+            if (!state) return false;
+            copy.loadState(*state);
+            if (copy.stateHash() != reference.stateHash()) return false;
+        }
+        return true;
+    }
+
+    long checks = 0;
+    const VersusMatch& match() const { return reference; }
+
+private:
+    VersusMatch reference;
+    std::vector<VersusInput> inputs;
+    size_t next = 0;
+};
+
+void printPeer(int p, const RollbackStats& stats) {
+    double perTick = stats.ticks ? 100.0 * stats.resimulated / stats.ticks : 0.0;
+    std::printf("peer %d: %ld ticks, %ld stalled frames, %ld rollbacks (avg depth %.1f, max %d), "
+                "%ld ticks resimulated (+%.1f%%)\n",
+                p, stats.ticks, stats.stalls, stats.rollbacks,
+                stats.rollbacks ? static_cast<double>(stats.resimulated) / stats.rollbacks : 0.0, stats.maxDepth,
+                stats.resimulated, perTick);
+    std::printf("        save %.0f ns, restore %.0f ns, %ld packets sent, %ld received\n",
+                stats.saves ? static_cast<double>(stats.saveNanos) / stats.saves : 0.0,
+                stats.loads ? static_cast<double>(stats.loadNanos) / stats.loads : 0.0, stats.packetsSent,
+                stats.packetsReceived);
+    if (stats.desyncs) std::printf("        %ld rollbacks found no snapshot to restore\n", stats.desyncs);
+}
+
+int main(int argc, char** argv) {
+    RollbackOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+
+    LoopbackLink link(options.delayMs * 1000.0, options.jitterMs * 1000.0, options.seed);
+    RollbackSession peer0(0, options.seed, link.endpoint(0), options.inputDelay, options.maxRollback);
+    RollbackSession peer1(1, options.seed, link.endpoint(1), options.inputDelay, options.maxRollback);
+    RollbackSession* peers[2] = {&peer0, &peer1};
+    const RollbackSession* const views[2] = {&peer0, &peer1};
+    Controller controller0(options, options.seed * 2 + 1), controller1(options, options.seed * 2 + 2);
+    Controller* controllers[2] = {&controller0, &controller1};
+    Referee referee(options.seed);
+
+    std::printf("one-way delay %.1f ms + up to %.1f ms jitter, input delay %d ticks, max rollback %d ticks\n",
+                options.delayMs, options.jitterMs, options.inputDelay, options.maxRollback);
+    std::printf("snapshot: %zu bytes per tick\n", sizeof(VersusState));
+
+    bool ok = true;
+    long frame = 0;
+    for (; frame < options.ticks && ok; ++frame) {
+        link.advanceTo(frame * 1e6 / TICK_RATE);
+        for (int p = 0; p < 2; ++p) {
+            RollbackSession& peer = *peers[p];
+            std::uint32_t tick = peer.getMatch().getTick();
+            std::uint8_t keys = controllers[p]->peek(peer.getMatch().player(p));
+            if (!peer.advance(keys)) continue;
+            controllers[p]->consume();
+            referee.record(tick + peer.getInputDelay(), p, keys);
+        }
+        if (frame % options.checkEvery == 0) ok = referee.check(views);
+        if (peer0.getMatch().finished() && peer1.getMatch().finished() && referee.match().finished()) break;
+    }
+    // Let the last inputs arrive, pressing nothing
+    for (long extra = 0; ok && extra < TICK_RATE; ++extra, ++frame) {
+        link.advanceTo(frame * 1e6 / TICK_RATE);
+        peer0.advance(0);
+        peer1.advance(0);
+    }
+    if (ok) ok = referee.check(views);
+    // A rollback without its snapshot may still happen to match the reference
+    if (peer0.getStats().desyncs || peer1.getStats().desyncs) ok = false;
+
+    const VersusMatch& match = referee.match();
+    std::printf("%ld frames, %u ticks confirmed by both peers, %ld packets overtaken in flight\n", frame,
+                match.getTick(), link.reordered());
+    for (int p = 0; p < 2; ++p) {
+        const TetrisEngine& player = match.player(p);
+        std::printf("player %d: %ld pieces, %d lines, %d garbage rows pending\n", p, player.getPiecesPlaced(),
+                    player.getLinesCleared(), player.getGarbagePending());
+    }
+    if (match.finished())
+        std::printf("winner: %s\n", match.getWinner() == DRAW ? "draw" : match.getWinner() == 0 ? "player 0" : "player 1");
+    printPeer(0, peer0.getStats());
+    printPeer(1, peer1.getStats());
+    std::printf("%s after %ld checks against the lockstep reference\n", ok ? "in sync" : "DESYNC", referee.checks);
+    return ok ? 0 : 2;
+}
@@ -0,0 +1,303 @@
+#pragma once
+
+#include "versus.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// Rollback netcode for peer-to-peer versus matches, in the style of GGPO.
+// Each peer simulates every tick straight away with its own input (delayed
+// by a few ticks) and a guess for the remote one: "no key pressed", since
+// inputs are edge-triggered presses and most ticks have none. When the real
+// remote input turns out different, the match is put back to the snapshot
+// taken before that tick and simulated again up to the present. Snapshots
+// are plain copies of VersusState taken every tick.
+
+const int ROLLBACK_STATES = 64;  // snapshots kept, the deepest possible rollback
+const int ROLLBACK_INPUTS = 256; // inputs kept per player; covers the peer running ahead
+const int ROLLBACK_MAX_KEYS = 128; // more than maxRollback + inputDelay can leave unacknowledged
+
+// What a peer sends every tick: its inputs from `firstTick` on, resent until
+// the other side acknowledges them, so late or reordered packets never lose
+// an input
+struct RollbackPacket {
+    std::uint32_t ackTick;   // every input of the receiver before this tick arrived
+    std::uint32_t firstTick;
+    std::uint8_t count;
+    std::uint8_t keys[ROLLBACK_MAX_KEYS];
+};
+
+class RollbackTransport {
+public:
+    virtual ~RollbackTransport() = default;
+    virtual void send(const RollbackPacket& packet) = 0;
+    virtual bool receive(RollbackPacket& packet) = 0;
+};
+
+struct RollbackStats {
+    long ticks = 0;        // ticks simulated for the first time
+    long stalls = 0;       // frames skipped, too far ahead of the remote peer
+    long rollbacks = 0;
+    long resimulated = 0;  // ticks simulated again after a rollback
+    int maxDepth = 0;      // ticks rewound by the worst rollback
+    long saves = 0;
+    long loads = 0;
+    long saveNanos = 0;
+    long loadNanos = 0;
+    long packetsSent = 0;
+    long packetsReceived = 0;
+    long desyncs = 0;      // rollbacks past the oldest snapshot; the match is no longer trustworthy
+};
+
+class RollbackSession {
+public:
+    // `inputDelay` ticks pass before a local press takes effect, which hides
+    // that much latency without any rollback; `maxRollback` bounds how far
+    // ahead of the last confirmed remote input the session may run
+    RollbackSession(int localPlayer_, unsigned seed, RollbackTransport& transport_, int inputDelay_ = 2,
+                    int maxRollback_ = 16)
+        : localPlayer(localPlayer_), transport(transport_),
+          inputDelay(std::max(0, std::min(inputDelay_, 16))),
+          maxRollback(std::max(1, std::min(maxRollback_, ROLLBACK_STATES - 1))),
+          match(seed) {
+        for (int p = 0; p < 2; ++p)
+            for (InputSlot& slot : inputs[p]) slot = InputSlot();
+        // Our first ticks have no input. The peer's come in its packets like
+        // any other, so the two sides need not use the same delay.
+        for (int t = 0; t < inputDelay; ++t) setInput(localPlayer, t, 0);
+        confirmedRemote = 0;
+        peerAck = 0;
+    }
+
+    // One frame: read the remote inputs that arrived, roll back if a guess
+    // was wrong, then simulate the next tick with `localKeys` queued
+    // inputDelay ticks ahead. Returns false when no tick was simulated: the
+    // remote peer is too far behind, or the match is over.
+    bool advance(std::uint8_t localKeys) {
+        receiveAll();
+        std::uint32_t now = match.getTick();
+        if (rollbackFrom < now) rollBack(now);
+        rollbackFrom = UINT32_MAX;
+
+        if (match.finished()) {
+            sendInputs(); // the peer may still need our last inputs
+            return false;
+        }
+        if (static_cast<std::int64_t>(now) - confirmedRemote >= maxRollback) {
+            stats.stalls++;
+            sendInputs(); // keep acknowledging, the peer may be stalled on us
+            return false;
+        }
+        setInput(localPlayer, now + inputDelay, localKeys);
+        sendInputs();
+        simulate(now);
+        stats.ticks++;
+        return true;
+    }
+
+    const VersusMatch& getMatch() const { return match; }
+    const RollbackStats& getStats() const { return stats; }
+    int getLocalPlayer() const { return localPlayer; }
+    int getInputDelay() const { return inputDelay; }
+    // Every remote input before this tick is known
+    std::uint32_t getConfirmedTick() const { return confirmedRemote; }
+
+    // Snapshot taken before `tick` was simulated, if it is still kept. States
+    // before the confirmed tick no longer depend on any guess.
+    const VersusState* stateAt(std::uint32_t tick) const {
+        const Frame& frame = frames[tick % ROLLBACK_STATES];
+        return frame.valid && frame.state.tick == tick ? &frame.state : nullptr;
+    }
+
+private:
+    struct InputSlot {
+        std::uint32_t tick = UINT32_MAX;
+        std::uint8_t keys = 0;
+        bool confirmed = false;
+    };
+
+    struct Frame {
+        VersusState state;
+        bool valid = false;
+    };
+
+    typedef std::chrono::steady_clock Clock;
+
+    void setInput(int player, std::uint32_t tick, std::uint8_t keys) {
+        InputSlot& slot = inputs[player][tick % ROLLBACK_INPUTS];
+        slot.tick = tick;
+        slot.keys = keys;
+        slot.confirmed = true;
+    }
+
+    // Confirmed input, or the guess used for the remote player
+    std::uint8_t inputAt(int player, std::uint32_t tick) {
+        InputSlot& slot = inputs[player][tick % ROLLBACK_INPUTS];
+        if (slot.tick != tick) {
+            slot.tick = tick;
+            slot.keys = 0; // prediction: nothing pressed
+            slot.confirmed = false;
+        }
+        return slot.keys;
+    }
+
+    void receiveAll() {
+        RollbackPacket packet;
+        int remote = 1 - localPlayer;
+        while (transport.receive(packet)) {
+            stats.packetsReceived++;
+            peerAck = std::max(peerAck, packet.ackTick);
+            for (int i = 0; i < packet.count; ++i) {
+                std::uint32_t tick = packet.firstTick + i;
+                if (tick < confirmedRemote || tick >= confirmedRemote + ROLLBACK_INPUTS) continue;
+                InputSlot& slot = inputs[remote][tick % ROLLBACK_INPUTS];
+                if (slot.tick == tick && slot.confirmed) continue;
+                // A tick already simulated with a wrong guess must be redone
+                bool guessed = slot.tick == tick;
+                if (tick < match.getTick() && (!guessed || slot.keys != packet.keys[i]))
+                    rollbackFrom = std::min(rollbackFrom, tick);
+                setInput(remote, tick, packet.keys[i]);
+            }
+            while (inputs[remote][confirmedRemote % ROLLBACK_INPUTS].tick == confirmedRemote &&
+                   inputs[remote][confirmedRemote % ROLLBACK_INPUTS].confirmed)
+                confirmedRemote++;
+        }
+    }
+
+    // Inputs the peer has not acknowledged yet, up to the newest one
+    void sendInputs() {
+        RollbackPacket packet;
+        std::uint32_t newest = match.getTick() + inputDelay + 1; // exclusive
+        std::uint32_t first = std::max(peerAck, newest > ROLLBACK_MAX_KEYS ? newest - ROLLBACK_MAX_KEYS : 0u);
+        packet.ackTick = confirmedRemote;
+        packet.firstTick = first;
+        packet.count = 0;
+        for (std::uint32_t t = first; t < newest; ++t) {
+            const InputSlot& slot = inputs[localPlayer][t % ROLLBACK_INPUTS];
+            if (slot.tick != t || !slot.confirmed) break; // stalled frames leave no input
+            packet.keys[packet.count++] = slot.keys;
+        }
+        transport.send(packet);
+        stats.packetsSent++;
+    }
+
+    void simulate(std::uint32_t tick) {
+        Frame& frame = frames[tick % ROLLBACK_STATES];
+        auto start = Clock::now();
+        match.saveState(frame.state);
+        stats.saveNanos += elapsedNanos(start);
+        stats.saves++;
+        frame.valid = true;
+        for (int p = 0; p < 2; ++p) {
+            std::uint8_t keys = inputAt(p, tick);
+            if (keys) match.press(p, keys);
+        }
+        match.advance();
+    }
+
+    void rollBack(std::uint32_t now) {
+        const VersusState* saved = stateAt(rollbackFrom);
+        // The stall in advance() keeps now - confirmedRemote below maxRollback,
+        // so the snapshot must be there; if not, the wrong guess stays baked in
+        if (!saved) {
+            stats.desyncs++;
+            return;
+        }
+        auto start = Clock::now();
+        match.loadState(*saved);
+        stats.loadNanos += elapsedNanos(start);
+        stats.loads++;
+        int depth = static_cast<int>(now - rollbackFrom);
+        stats.rollbacks++;
+        stats.maxDepth = std::max(stats.maxDepth, depth);
+        for (std::uint32_t t = rollbackFrom; t < now; ++t) simulate(t);
+        stats.resimulated += depth;
+    }
+
+    static long elapsedNanos(Clock::time_point since) {
+        return static_cast<long>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - since).count());
+    }
+
+    int localPlayer;
+    RollbackTransport& transport;
+    int inputDelay;
+    int maxRollback;
+    VersusMatch match;
+    std::array<std::array<InputSlot, ROLLBACK_INPUTS>, 2> inputs;
+    std::array<Frame, ROLLBACK_STATES> frames;
+    std::uint32_t confirmedRemote = 0;
+    std::uint32_t peerAck = 0;
+    std::uint32_t rollbackFrom = UINT32_MAX;
+    RollbackStats stats;
+};
+
+// In-process network for two sessions: every packet arrives `delay` plus a
+// random share of `jitter` microseconds after it was sent, so packets can
+// overtake each other. Time only moves when advanceTo() is called, which
+// keeps a run reproducible.
+class LoopbackLink {
+public:
+    class Endpoint : public RollbackTransport {
+    public:
+        void send(const RollbackPacket& packet) override { link->deliver(1 - side, packet); }
+        bool receive(RollbackPacket& packet) override { return link->take(side, packet); }
+
+    private:
+        friend class LoopbackLink;
+        LoopbackLink* link = nullptr;
+        int side = 0;
+    };
+
+    LoopbackLink(double delayMicros_, double jitterMicros_, unsigned seed = 1)
+        : delayMicros(delayMicros_), jitterMicros(jitterMicros_), rng(seed) {
+        for (int side = 0; side < 2; ++side) {
+            endpoints[side].link = this;
+            endpoints[side].side = side;
+        }
+    }
+    LoopbackLink(const LoopbackLink&) = delete;
+    LoopbackLink& operator=(const LoopbackLink&) = delete;
+
+    Endpoint& endpoint(int side) { return endpoints[side]; }
+    void advanceTo(double micros) { now = micros; }
+    long reordered() const { return overtaken; }
+
+private:
+    struct InFlight {
+        double arrival;
+        long sequence;
+        RollbackPacket packet;
+    };
+
+    void deliver(int side, const RollbackPacket& packet) {
+        double arrival = now + delayMicros + jitterMicros * std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        queues[side].push_back(InFlight{arrival, sent++, packet});
+    }
+
+    // Earliest packet that has arrived by now
+    bool take(int side, RollbackPacket& packet) {
+        std::vector<InFlight>& queue = queues[side];
+        auto first = queue.end();
+        for (auto it = queue.begin(); it != queue.end(); ++it)
+            if (it->arrival <= now && (first == queue.end() || it->arrival < first->arrival)) first = it;
+        if (first == queue.end()) return false;
+        if (first->sequence > lastTaken[side]) lastTaken[side] = first->sequence;
+        else overtaken++;
+        packet = first->packet;
+        queue.erase(first);
+        return true;
+    }
+
+    double delayMicros;
+    double jitterMicros;
+    std::mt19937 rng;
+    double now = 0;
+    long sent = 0;
+    long overtaken = 0;
+    long lastTaken[2] = {-1, -1};
+    std::vector<InFlight> queues[2];
+    Endpoint endpoints[2];
+};
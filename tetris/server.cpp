@@ -0,0 +1,421 @@
+// Versus match server: pairs up clients, runs their matches at the engine's
+// fixed tick rate and streams the inputs of both players to both clients.
+//
+// One thread owns every socket through epoll (non-blocking, level-triggered)
+// and a timerfd that fires every tick. Each tick the matches are simulated
+// in batches on the thread pool, then the new inputs are queued on the
+// connections and written out with one send() per connection. Once a
+// second the server prints how much CPU the simulation and the socket work
+// took, and the number of matches per core that load allows.
+
+#include "versus_net.hpp"
+#include "../common/thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+typedef std::chrono::steady_clock Clock;
+
+const int MATCH_BATCH = 32;          // matches simulated per pool task
+const int MAX_INPUTS_PER_TICK = 16;  // per player, extra key presses are dropped
+const int MAX_CATCH_UP_TICKS = 4;    // ticks run at once after a stall, the rest are skipped
+
+struct ServerOptions {
+    int port = VERSUS_DEFAULT_PORT;
+    unsigned threads = 0;
+    int syncEvery = 2;      // ticks between SYNC messages
+    double duration = 0.0;  // seconds, 0 = until interrupted
+    unsigned seed = 0;      // match seeds; 0 = random
+    bool quiet = false;
+};
+
+void printUsage() {
+    std::cout << "Usage: tetris_server [--port P] [--threads T] [--sync-every N] [--duration S]\n"
+              << "                     [--seed S] [--quiet]\n"
+              << "  Hosts two-player versus matches; clients are paired in the order they join.\n"
+              << "  --sync-every sets how often clients may advance their copy of the match\n"
+              << "  --duration stops the server after S seconds and prints a summary\n";
+}
+
+bool parseOptions(int argc, char** argv, ServerOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--port" && hasValue) options.port = std::atoi(argv[++i]);
+        else if (arg == "--threads" && hasValue) options.threads = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if (arg == "--sync-every" && hasValue) options.syncEvery = std::atoi(argv[++i]);
+        else if (arg == "--duration" && hasValue) options.duration = std::atof(argv[++i]);
+        else if (arg == "--seed" && hasValue) options.seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--quiet") options.quiet = true;
+        else return false;
+    }
+    return options.port > 0 && options.port < 65536 && options.syncEvery > 0;
+}
+
+struct Connection {
+    int fd = -1;
+    std::vector<std::uint8_t> in;
+    std::vector<std::uint8_t> out;
+    size_t outOffset = 0;
+    bool writeWatched = false; // EPOLLOUT registered while a send is incomplete
+    bool queued = false;       // in the matchmaking queue
+    bool flushPending = false; // in the list of connections to flush this tick
+    int match = -1;
+    int player = 0;
+};
+
+struct Match {
+    VersusMatch game;
+    int connections[2] = {-1, -1};
+    std::vector<std::uint8_t> keys[2]; // presses received since the last tick
+    std::vector<VersusInput> applied;  // presses applied this tick, to broadcast
+    bool active = false;
+};
+
+class VersusServer {
+public:
+    VersusServer(const ServerOptions& options_) : options(options_), pool(options_.threads) {
+        seedRng.seed(options.seed ? options.seed : std::random_device()());
+    }
+
+    bool start() {
+        listenFd = listenTcp(options.port);
+        epollFd = epoll_create1(0);
+        timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+        if (listenFd < 0 || epollFd < 0 || timerFd < 0) return false;
+        itimerspec period{};
+        period.it_interval.tv_nsec = 1000000000L / TICK_RATE;
+        period.it_value = period.it_interval;
+        timerfd_settime(timerFd, 0, &period, nullptr);
+        watch(listenFd, EPOLLIN);
+        watch(timerFd, EPOLLIN);
+        return true;
+    }
+
+    unsigned threadCount() const { return pool.size(); }
+
+    // Event loop; returns after --duration seconds or on SIGINT/SIGTERM
+    void run(const std::atomic<bool>& interrupted) {
+        startTime = Clock::now();
+        lastReport = startTime;
+        epoll_event events[256];
+        while (!interrupted.load()) {
+            int count = epoll_wait(epollFd, events, 256, 100);
+            auto ioStart = Clock::now();
+            for (int i = 0; i < count; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == listenFd) acceptClients();
+                else if (fd == timerFd) onTimer();
+                else onSocket(fd, events[i].events);
+            }
+            // Socket time is the loop's busy time minus the simulation it ran
+            ioNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - ioStart).count() - simLoopWall;
+            simLoopWall = 0;
+            if (Clock::now() - lastReport >= std::chrono::seconds(1)) report();
+            if (options.duration > 0 && std::chrono::duration<double>(Clock::now() - startTime).count() >= options.duration)
+                break;
+        }
+        summary();
+    }
+
+private:
+    void watch(int fd, std::uint32_t events) {
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+    }
+
+    void rewatch(int fd, std::uint32_t events) {
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event);
+    }
+
+    void acceptClients() {
+        for (;;) {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK);
+            if (fd < 0) return;
+            setNoDelay(fd);
+            if (static_cast<size_t>(fd) >= connections.size()) connections.resize(fd + 1);
+            connections[fd] = Connection();
+            connections[fd].fd = fd;
+            watch(fd, EPOLLIN);
+            clientCount++;
+        }
+    }
+
+    void onSocket(int fd, std::uint32_t events) {
+        Connection& c = connections[fd];
+        if (c.fd < 0) return;
+        if (events & (EPOLLERR | EPOLLHUP)) {
+            disconnect(fd);
+            return;
+        }
+        if (events & EPOLLOUT) flush(c);
+        if (!(events & EPOLLIN) || c.fd < 0) return;
+        size_t buffered = c.in.size();
+        bool open = receiveAvailable(fd, c.in);
+        bytesIn += static_cast<long>(c.in.size() - buffered);
+        bool valid = readMessages(c.in, [&](std::uint8_t type, const std::uint8_t* payload) {
+            if (type == MSG_HELLO && payload[0] == VERSUS_PROTOCOL && c.match < 0 && !c.queued) {
+                c.queued = true;
+                waiting.push_back(fd);
+            } else if (type == MSG_INPUT && c.match >= 0) {
+                std::vector<std::uint8_t>& keys = matches[c.match].keys[c.player];
+                if (keys.size() < MAX_INPUTS_PER_TICK && payload[0]) keys.push_back(payload[0]);
+            }
+        });
+        if (!open || !valid) disconnect(fd);
+        else pairWaiting();
+    }
+
+    void pairWaiting() {
+        while (waiting.size() >= 2) {
+            int a = waiting[0], b = waiting[1];
+            waiting.erase(waiting.begin(), waiting.begin() + 2);
+            int index;
+            if (!freeMatches.empty()) {
+                index = freeMatches.back();
+                freeMatches.pop_back();
+            } else {
+                index = static_cast<int>(matches.size());
+                matches.emplace_back();
+            }
+            Match& m = matches[index];
+            m.game.reset(static_cast<unsigned>(seedRng()));
+            m.connections[0] = a;
+            m.connections[1] = b;
+            m.keys[0].clear();
+            m.keys[1].clear();
+            m.active = true;
+            activeMatches.push_back(index);
+            for (int p = 0; p < 2; ++p) {
+                Connection& c = connections[m.connections[p]];
+                c.queued = false;
+                c.match = index;
+                c.player = p;
+                writeStart(c.out, m.game.getSeed(), static_cast<std::uint8_t>(p));
+                markForFlush(c);
+            }
+            matchesStarted++;
+        }
+        flushAll();
+    }
+
+    void onTimer() {
+        std::uint64_t expirations = 0;
+        if (read(timerFd, &expirations, sizeof(expirations)) != sizeof(expirations)) return;
+        if (expirations > static_cast<std::uint64_t>(MAX_CATCH_UP_TICKS)) {
+            skippedTicks += static_cast<long>(expirations) - MAX_CATCH_UP_TICKS;
+            expirations = MAX_CATCH_UP_TICKS;
+        }
+        for (std::uint64_t i = 0; i < expirations; ++i) tick();
+    }
+
+    // Simulate every match one tick, then hand the results to the sockets
+    void tick() {
+        auto wallStart = Clock::now();
+        size_t batches = (activeMatches.size() + MATCH_BATCH - 1) / MATCH_BATCH;
+        pool.parallelFor(batches, [&](size_t batch) {
+            auto start = Clock::now();
+            size_t end = std::min(activeMatches.size(), (batch + 1) * MATCH_BATCH);
+            for (size_t i = batch * MATCH_BATCH; i < end; ++i) {
+                Match& m = matches[activeMatches[i]];
+                m.applied.clear();
+                for (int p = 0; p < 2; ++p) {
+                    for (std::uint8_t keys : m.keys[p]) {
+                        m.applied.push_back(VersusInput{m.game.getTick(), static_cast<std::uint8_t>(p), keys});
+                        m.game.press(p, keys);
+                    }
+                    m.keys[p].clear();
+                }
+                m.game.advance();
+            }
+            simNanos.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count(),
+                               std::memory_order_relaxed);
+        });
+        simLoopWall += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - wallStart).count();
+        matchTicks += static_cast<long>(activeMatches.size());
+        ticks++;
+
+        for (size_t i = 0; i < activeMatches.size();) {
+            int index = activeMatches[i];
+            Match& m = matches[index];
+            bool sync = m.game.getTick() % options.syncEvery == 0;
+            for (int p = 0; p < 2; ++p) {
+                Connection& c = connections[m.connections[p]];
+                if (m.applied.empty() && !sync && !m.game.finished()) continue;
+                for (const VersusInput& input : m.applied) writeInputs(c.out, input);
+                if (m.game.finished())
+                    writeEnd(c.out, m.game.getWinner(), END_TOPPED_OUT, m.game.getTick(), m.game.stateHash());
+                else if (sync)
+                    writeSync(c.out, m.game.getTick());
+                markForFlush(c);
+            }
+            if (m.game.finished()) endMatch(index, i);
+            else ++i;
+        }
+        flushAll();
+    }
+
+    // Release the match; the connections go back to idle until their next HELLO
+    void endMatch(int index, size_t activePosition) {
+        Match& m = matches[index];
+        for (int fd : m.connections)
+            if (fd >= 0 && connections[fd].match == index) connections[fd].match = -1;
+        m.active = false;
+        activeMatches[activePosition] = activeMatches.back();
+        activeMatches.pop_back();
+        freeMatches.push_back(index);
+        matchesFinished++;
+    }
+
+    void disconnect(int fd) {
+        Connection& c = connections[fd];
+        if (c.match >= 0) {
+            Match& m = matches[c.match];
+            int other = m.connections[1 - c.player];
+            Connection& o = connections[other];
+            writeEnd(o.out, static_cast<std::uint8_t>(1 - c.player), END_OPPONENT_LEFT, m.game.getTick(), 0);
+            markForFlush(o);
+            m.connections[c.player] = -1;
+            size_t position = std::find(activeMatches.begin(), activeMatches.end(), c.match) - activeMatches.begin();
+            endMatch(c.match, position);
+        }
+        if (c.queued) waiting.erase(std::find(waiting.begin(), waiting.end(), fd));
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        c = Connection();
+        clientCount--;
+    }
+
+    void markForFlush(Connection& c) {
+        if (c.flushPending) return;
+        c.flushPending = true;
+        toFlush.push_back(c.fd);
+    }
+
+    void flush(Connection& c) {
+        size_t before = c.out.size() - c.outOffset;
+        if (!sendPending(c.fd, c.out, c.outOffset)) {
+            disconnect(c.fd);
+            return;
+        }
+        bytesOut += static_cast<long>(before - (c.out.size() - c.outOffset));
+        bool pending = !c.out.empty();
+        if (pending != c.writeWatched) {
+            rewatch(c.fd, pending ? EPOLLIN | EPOLLOUT : EPOLLIN);
+            c.writeWatched = pending;
+        }
+    }
+
+    void flushAll() {
+        // A disconnect below can add entries, so index instead of iterating
+        for (size_t i = 0; i < toFlush.size(); ++i) {
+            Connection& c = connections[toFlush[i]];
+            if (c.fd < 0 || !c.flushPending) continue;
+            c.flushPending = false;
+            if (!c.writeWatched) flush(c); // otherwise EPOLLOUT will send it
+        }
+        toFlush.clear();
+    }
+
+    void report() {
+        auto now = Clock::now();
+        double seconds = std::chrono::duration<double>(now - lastReport).count();
+        lastReport = now;
+        long sim = simNanos.exchange(0), io = ioNanos;
+        ioNanos = 0;
+        long matchTickCount = matchTicks - reportedMatchTicks, tickCount = ticks - reportedTicks;
+        reportedMatchTicks = matchTicks;
+        reportedTicks = ticks;
+        totalSim += sim;
+        totalIo += io;
+
+        double perMatchTick = matchTickCount ? static_cast<double>(sim + io) / matchTickCount : 0.0;
+        // A core has 1e9 ns per second to spend on TICK_RATE ticks of every match
+        double capacity = perMatchTick > 0.0 ? 1e9 / (perMatchTick * TICK_RATE) : 0.0;
+        if (!options.quiet)
+            std::printf("%6.0f ticks/s  %5zu matches  %5ld clients  sim %6.2f%%  io %6.2f%% of a core  "
+                        "%6.0f ns/match-tick  ~%.0f matches/core  in %.0f KB/s out %.0f KB/s\n",
+                        tickCount / seconds, activeMatches.size(), clientCount, sim / 1e7 / seconds,
+                        io / 1e7 / seconds, perMatchTick, capacity, bytesIn / 1024.0 / seconds,
+                        bytesOut / 1024.0 / seconds);
+        std::fflush(stdout);
+        bytesIn = bytesOut = 0;
+        peakMatches = std::max(peakMatches, activeMatches.size());
+    }
+
+    void summary() {
+        double perMatchTick = matchTicks ? static_cast<double>(totalSim + totalIo) / matchTicks : 0.0;
+        double simPerMatchTick = matchTicks ? static_cast<double>(totalSim) / matchTicks : 0.0;
+        std::printf("summary: %ld ticks, %ld skipped, %ld matches started, %ld finished, peak %zu concurrent\n",
+                    ticks, skippedTicks, matchesStarted, matchesFinished, peakMatches);
+        std::printf("         %.0f ns per match-tick (%.0f simulation), ~%.0f matches per core at %d Hz "
+                    "(%.0f simulation only), %u threads\n",
+                    perMatchTick, simPerMatchTick, perMatchTick > 0 ? 1e9 / (perMatchTick * TICK_RATE) : 0.0,
+                    TICK_RATE, simPerMatchTick > 0 ? 1e9 / (simPerMatchTick * TICK_RATE) : 0.0, pool.size());
+    }
+
+    ServerOptions options;
+    ThreadPool pool;
+    std::mt19937 seedRng;
+    int listenFd = -1, epollFd = -1, timerFd = -1;
+    std::vector<Connection> connections; // indexed by file descriptor
+    std::vector<Match> matches;
+    std::vector<int> activeMatches;
+    std::vector<int> freeMatches;
+    std::vector<int> waiting;
+    std::vector<int> toFlush;
+
+    Clock::time_point startTime, lastReport;
+    std::atomic<long> simNanos{0}; // CPU time of all pool threads in the simulation
+    long simLoopWall = 0;          // wall time of the simulation inside the current loop iteration
+    long ioNanos = 0;
+    long totalSim = 0, totalIo = 0;
+    long ticks = 0, reportedTicks = 0, skippedTicks = 0;
+    long matchTicks = 0, reportedMatchTicks = 0;
+    long matchesStarted = 0, matchesFinished = 0;
+    long clientCount = 0;
+    long bytesIn = 0, bytesOut = 0;
+    size_t peakMatches = 0;
+};
+
+std::atomic<bool> interrupted{false};
+
+void onSignal(int) { interrupted.store(true); }
+
+int main(int argc, char** argv) {
+    ServerOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+    raiseFileLimit();
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    VersusServer server(options);
+    if (!server.start()) {
+        std::cerr << "Cannot listen on port " << options.port << "\n";
+        return 1;
+    }
+    std::cout << "tetris_server on port " << options.port << ", " << server.threadCount() << " simulation threads, "
+              << TICK_RATE << " ticks/s\n";
+    std::fflush(stdout);
+    server.run(interrupted);
+    return 0;
+}
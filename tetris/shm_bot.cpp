@@ -0,0 +1,245 @@
+// Example bot for the shared-memory interface: attaches to a running game
+// (tetris --shm NAME), plays every piece with the built-in AI and reports
+// how long reading the state and submitting a move take.
+// --selftest hosts a headless engine in a second thread over a real
+// segment, so the interface can be checked without a display.
+
+#include "shm_bridge.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+struct BotOptions {
+    std::string name = "/tetris_bot";
+    long maxPieces = 0;   // 0 = play until game over
+    bool selftest = false;
+    unsigned seed = 1;
+    int hostTickMicros = 1000; // selftest host: wall time per tick
+    AiConfig aiConfig;
+};
+
+void printUsage() {
+    std::cout << "Usage: tetris_shm_bot [--name NAME] [--max-pieces P] [--beam W] [--threads T]\n"
+              << "                      [--weights FILE] [--selftest] [--seed S] [--host-tick-us U]\n"
+              << "  Attaches to a game started with tetris --shm NAME and plays it with the AI.\n"
+              << "  --selftest runs a headless game in-process over the same interface and\n"
+              << "  checks that every state read is consistent\n";
+}
+
+bool parseOptions(int argc, char** argv, BotOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--name" && hasValue) options.name = argv[++i];
+        else if (arg == "--max-pieces" && hasValue) options.maxPieces = std::atol(argv[++i]);
+        else if (arg == "--beam" && hasValue) options.aiConfig.beamWidth = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--threads" && hasValue) options.aiConfig.threads = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if (arg == "--weights" && hasValue) {
+            if (!loadEvalWeights(argv[++i], options.aiConfig.weights)) {
+                std::cerr << "Cannot read weights from " << argv[i] << "\n";
+                return false;
+            }
+        }
+        else if (arg == "--selftest") options.selftest = true;
+        else if (arg == "--seed" && hasValue) options.seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--host-tick-us" && hasValue) options.hostTickMicros = std::max(0, std::atoi(argv[++i]));
+        else return false;
+    }
+    return options.maxPieces >= 0 && !options.name.empty() && options.name[0] == '/';
+}
+
+// Occupancy and colours are written separately; a torn read would disagree
+bool consistent(const GameSnapshot& s) {
+    for (int y = 0; y < GRID_HEIGHT; ++y)
+        for (int x = 0; x < GRID_WIDTH; ++x)
+            if (((s.rows[y] >> x) & 1) != (s.colors[y][x] != 0)) return false;
+    return s.currentShape >= 0 && s.currentShape < 7 && s.nextShape >= 0 && s.nextShape < 7;
+}
+
+std::uint32_t elapsedNanos(Clock::time_point since) {
+    return static_cast<std::uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - since).count());
+}
+
+struct BotStats {
+    long pieces = 0;
+    long lines = 0;
+    long score = 0;
+    long reads = 0;
+    long badReads = 0;  // failed or inconsistent
+    long ringFull = 0;
+    std::vector<std::uint32_t> readNanos;
+    std::vector<std::uint32_t> submitNanos;
+    std::vector<std::uint32_t> decideNanos;
+};
+
+// Place every new piece as soon as it shows up in the shared state
+void playBot(SharedMemoryLink& link, const BotOptions& options, const std::atomic<bool>& hostDone, BotStats& stats) {
+    TetrisAI ai(options.aiConfig);
+    GameSnapshot snapshot;
+    std::uint32_t seenVersion = 0;
+    long submittedFor = -1; // piece count the last move was sent for
+    while (!hostDone.load(std::memory_order_acquire)) {
+        std::uint32_t version = link.stateVersion();
+        if (version == seenVersion) {
+            std::this_thread::yield();
+            continue;
+        }
+        seenVersion = version;
+
+        auto start = Clock::now();
+        bool ok = link.read(snapshot);
+        stats.readNanos.push_back(elapsedNanos(start));
+        stats.reads++;
+        if (!ok || !consistent(snapshot)) {
+            stats.badReads++;
+            continue;
+        }
+        stats.pieces = snapshot.piecesPlaced;
+        stats.lines = snapshot.linesCleared;
+        stats.score = snapshot.score;
+        if (snapshot.gameOver || (options.maxPieces && snapshot.piecesPlaced >= options.maxPieces)) break;
+        if (snapshot.clearingRows || snapshot.piecesPlaced == submittedFor) continue;
+
+        start = Clock::now();
+        Placement placement;
+        bool found = ai.decide(snapshotBoard(snapshot), snapshotCurrent(snapshot), snapshot.nextShape,
+                               snapshot.heldShape, snapshot.canHold != 0, placement);
+        stats.decideNanos.push_back(elapsedNanos(start));
+        if (!found) break;
+
+        BotAction action;
+        action.kind = BotAction::Place;
+        action.useHold = placement.useHold;
+        action.rotations = static_cast<std::int8_t>(placement.rotations);
+        action.moveX = static_cast<std::int8_t>(placement.moveX);
+        start = Clock::now();
+        bool queued = link.submit(action);
+        stats.submitNanos.push_back(elapsedNanos(start));
+        if (queued) submittedFor = snapshot.piecesPlaced;
+        else stats.ringFull++;
+    }
+}
+
+// Stand-in for tetris --shm: the same poll / step / publish loop, without a window
+void runHost(SharedMemoryLink& link, const BotOptions& options, const std::atomic<bool>& botDone,
+             std::atomic<bool>& hostDone) {
+    TetrisEngine engine(options.seed);
+    GameSnapshot snapshot;
+    auto next = Clock::now();
+    while (!botDone.load(std::memory_order_acquire)) {
+        BotAction action;
+        while (link.poll(action))
+            if (!engine.isGameOver()) applyBotAction(engine, action);
+        engine.step(EngineInput(), 1);
+        fillSnapshot(engine, snapshot);
+        link.publish(snapshot);
+        if (engine.isGameOver()) break;
+        next += std::chrono::microseconds(options.hostTickMicros);
+        std::this_thread::sleep_until(next);
+    }
+    // Let the bot see the final state before it is told to stop
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    hostDone.store(true, std::memory_order_release);
+}
+
+// Writer publishing as fast as it can while the reader checks every copy
+long stressSeqlock(SharedMemoryLink& host, SharedMemoryLink& bot, long& reads) {
+    std::atomic<bool> stop{false};
+    std::thread writer([&]() {
+        GameSnapshot s;
+        std::memset(&s, 0, sizeof(s));
+        std::uint32_t n = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            ++n;
+            for (int y = 0; y < GRID_HEIGHT; ++y) {
+                s.rows[y] = static_cast<std::uint16_t>((n * 2654435761u + y * 40503u) >> 16) & FULL_ROW;
+                for (int x = 0; x < GRID_WIDTH; ++x) s.colors[y][x] = ((s.rows[y] >> x) & 1) ? 1 + (n + x) % 7 : 0;
+            }
+            s.currentShape = static_cast<std::int8_t>(n % 7);
+            s.nextShape = static_cast<std::int8_t>((n + 3) % 7);
+            s.tick = n;
+            host.publish(s);
+        }
+    });
+    long bad = 0;
+    GameSnapshot s;
+    auto end = Clock::now() + std::chrono::milliseconds(300);
+    while (Clock::now() < end) {
+        if (!bot.read(s)) continue; // the writer never paused, nothing was copied
+        reads++;
+        if (!consistent(s)) bad++;
+    }
+    stop.store(true);
+    writer.join();
+    return bad;
+}
+
+std::uint32_t percentile(std::vector<std::uint32_t> samples, double p) {
+    if (samples.empty()) return 0;
+    size_t index = static_cast<size_t>(p * (samples.size() - 1));
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples[index];
+}
+
+void printStats(const BotStats& stats) {
+    std::cout << "pieces:       " << stats.pieces << "\n"
+              << "lines:        " << stats.lines << "\n"
+              << "score:        " << stats.score << "\n"
+              << "state reads:  " << stats.reads << " (" << stats.badReads << " bad)\n"
+              << "read p50:     " << percentile(stats.readNanos, 0.50) << " ns\n"
+              << "read p99:     " << percentile(stats.readNanos, 0.99) << " ns\n"
+              << "submit p50:   " << percentile(stats.submitNanos, 0.50) << " ns\n"
+              << "submit p99:   " << percentile(stats.submitNanos, 0.99) << " ns\n"
+              << "decide p50:   " << percentile(stats.decideNanos, 0.50) / 1000.0 << " us\n"
+              << "decide p99:   " << percentile(stats.decideNanos, 0.99) / 1000.0 << " us\n";
+    if (stats.ringFull) std::cout << "ring full:    " << stats.ringFull << "\n";
+}
+
+int main(int argc, char** argv) {
+    BotOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+
+    BotStats stats;
+    if (options.selftest) {
+        if (!options.maxPieces) options.maxPieces = 300;
+        std::string name = options.name + "_selftest_" + std::to_string(getpid());
+        SharedMemoryLink host, bot;
+        if (!host.create(name) || !bot.attach(name)) {
+            std::cerr << "Cannot create shared memory " << name << "\n";
+            return 1;
+        }
+        long stressReads = 0;
+        long torn = stressSeqlock(host, bot, stressReads);
+        std::cout << "seqlock:      " << stressReads << " reads under constant writes, " << torn << " torn\n";
+
+        std::atomic<bool> botDone{false}, hostDone{false};
+        std::thread hostThread(runHost, std::ref(host), std::cref(options), std::cref(botDone), std::ref(hostDone));
+        playBot(bot, options, hostDone, stats);
+        botDone.store(true, std::memory_order_release);
+        hostThread.join();
+        printStats(stats);
+        return torn || stats.badReads || stats.pieces == 0 ? 2 : 0;
+    }
+
+    SharedMemoryLink link;
+    if (!link.attach(options.name)) {
+        std::cerr << "Cannot attach to " << options.name << " (start the game with tetris --shm " << options.name << ")\n";
+        return 1;
+    }
+    std::atomic<bool> never{false};
+    playBot(link, options, never, stats);
+    printStats(stats);
+    return stats.badReads ? 2 : 0;
+}
@@ -0,0 +1,258 @@
+#pragma once
+
+#include "ai.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Shared-memory interface for bot processes. The game publishes its state
+// into a POSIX shared-memory segment and reads actions back from the same
+// segment, so a bot never makes a syscall once it is attached:
+//  - the state is a fixed binary snapshot guarded by a seqlock; the game is
+//    the only writer, readers retry if they raced with an update
+//  - actions go through a single-producer/single-consumer ring, the bot
+//    pushes and the game pops once per frame
+// The payload is stored as relaxed 64-bit atomics, which keeps the seqlock
+// free of data races and works across processes as long as 64-bit atomics
+// are lock-free.
+
+const std::uint32_t SHM_MAGIC = 0x54455453; // "TETS"
+const std::uint32_t SHM_VERSION = 1;
+const std::uint32_t ACTION_RING_SIZE = 64;  // power of two
+
+// Everything a bot needs to pick its next move, in a fixed layout
+struct GameSnapshot {
+    std::uint16_t rows[GRID_HEIGHT];                // bit x set when (x, y) is filled
+    std::uint8_t colors[GRID_HEIGHT][GRID_WIDTH];   // 0 = empty, shapeIndex + 1 otherwise
+    std::int8_t currentShape, currentRotation, currentX, currentY;
+    std::int8_t nextShape, heldShape;               // heldShape is -1 when nothing is held
+    std::uint8_t canHold, gameOver;
+    std::uint32_t clearingRows;
+    std::int32_t score, level, linesCleared, piecesPlaced;
+    std::uint32_t tick;
+};
+
+static_assert(sizeof(GameSnapshot) % 8 == 0, "the snapshot is copied in 64-bit words");
+
+inline void fillSnapshot(const TetrisEngine& engine, GameSnapshot& s) {
+    std::memset(&s, 0, sizeof(s));
+    const Board& grid = engine.getGrid();
+    for (int y = 0; y < GRID_HEIGHT; ++y) {
+        s.rows[y] = grid.rows[y];
+        for (int x = 0; x < GRID_WIDTH; ++x) s.colors[y][x] = static_cast<std::uint8_t>(grid.cell(x, y));
+    }
+    const Tetrimino& current = engine.getCurrent();
+    s.currentShape = static_cast<std::int8_t>(current.shapeIndex);
+    s.currentRotation = static_cast<std::int8_t>(current.rotation);
+    s.currentX = static_cast<std::int8_t>(current.x);
+    s.currentY = static_cast<std::int8_t>(current.y);
+    s.nextShape = static_cast<std::int8_t>(engine.getNext().shapeIndex);
+    s.heldShape = static_cast<std::int8_t>(engine.getHeld() ? engine.getHeld()->shapeIndex : -1);
+    s.canHold = engine.getCanHold();
+    s.gameOver = engine.isGameOver();
+    s.clearingRows = engine.getClearingRows();
+    s.score = engine.getScore();
+    s.level = engine.getLevel();
+    s.linesCleared = engine.getLinesCleared();
+    s.piecesPlaced = static_cast<std::int32_t>(engine.getPiecesPlaced());
+    s.tick = engine.getTick();
+}
+
+// Bot: rebuild the board and the falling piece from a snapshot
+inline Board snapshotBoard(const GameSnapshot& s) {
+    Board board;
+    for (int y = 0; y < GRID_HEIGHT; ++y) {
+        board.rows[y] = s.rows[y];
+        for (int x = 0; x < GRID_WIDTH; ++x) board.colors[y][x] = s.colors[y][x];
+    }
+    board.updateSurface();
+    return board;
+}
+
+inline Tetrimino snapshotCurrent(const GameSnapshot& s) {
+    Tetrimino t(s.currentShape);
+    t.rotation = s.currentRotation;
+    t.x = s.currentX;
+    t.y = s.currentY;
+    return t;
+}
+
+// A bot action, packed into one 64-bit ring slot
+struct BotAction {
+    enum Kind : std::uint8_t { Keys = 1, Place = 2 };
+    Kind kind = Keys;
+    std::uint8_t keys = 0;      // Keys: EngineInput::toBits(), applied between two ticks
+    bool useHold = false;       // Place: same meaning as Placement, from the spawn position
+    std::int8_t rotations = 0;
+    std::int8_t moveX = 0;
+
+    std::uint64_t pack() const {
+        return static_cast<std::uint64_t>(kind) | static_cast<std::uint64_t>(keys) << 8 |
+               static_cast<std::uint64_t>(useHold) << 16 | static_cast<std::uint64_t>(static_cast<std::uint8_t>(rotations)) << 24 |
+               static_cast<std::uint64_t>(static_cast<std::uint8_t>(moveX)) << 32;
+    }
+    static BotAction unpack(std::uint64_t word) {
+        BotAction action;
+        action.kind = static_cast<Kind>(word & 0xFF);
+        action.keys = static_cast<std::uint8_t>(word >> 8);
+        action.useHold = (word >> 16) & 1;
+        action.rotations = static_cast<std::int8_t>(word >> 24);
+        action.moveX = static_cast<std::int8_t>(word >> 32);
+        return action;
+    }
+};
+
+struct alignas(64) SharedSegment {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t size;
+
+    // State published by the game: odd sequence = update in progress
+    alignas(64) std::atomic<std::uint32_t> sequence;
+    std::atomic<std::uint64_t> words[sizeof(GameSnapshot) / 8];
+
+    // Action ring, bot to game; head and tail on their own cache lines
+    alignas(64) std::atomic<std::uint32_t> head; // next slot the game reads
+    alignas(64) std::atomic<std::uint32_t> tail; // next slot the bot writes
+    alignas(64) std::atomic<std::uint64_t> slots[ACTION_RING_SIZE];
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "shared atomics must be lock-free");
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free, "shared atomics must be lock-free");
+
+// Owns or attaches to the mapping; the game creates it, bots attach
+class SharedMemoryLink {
+public:
+    SharedMemoryLink() = default;
+    SharedMemoryLink(const SharedMemoryLink&) = delete;
+    SharedMemoryLink& operator=(const SharedMemoryLink&) = delete;
+
+    ~SharedMemoryLink() {
+        if (segment) munmap(segment, sizeof(SharedSegment));
+        if (owner) shm_unlink(name.c_str());
+    }
+
+    bool isOpen() const { return segment != nullptr; }
+    const std::string& getName() const { return name; }
+
+    // Game side: create (or take over) the segment and reset it
+    bool create(const std::string& shmName) {
+        name = shmName;
+        int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0600);
+        if (fd < 0) return false;
+        bool ok = ftruncate(fd, sizeof(SharedSegment)) == 0 && map(fd);
+        close(fd);
+        if (!ok) return false;
+        owner = true;
+        new (segment) SharedSegment();
+        segment->magic = SHM_MAGIC;
+        segment->version = SHM_VERSION;
+        segment->size = sizeof(SharedSegment);
+        segment->sequence.store(0, std::memory_order_relaxed);
+        for (auto& w : segment->words) w.store(0, std::memory_order_relaxed);
+        segment->head.store(0, std::memory_order_relaxed);
+        segment->tail.store(0, std::memory_order_release);
+        return true;
+    }
+
+    // Bot side: attach to a segment created by the game
+    bool attach(const std::string& shmName) {
+        name = shmName;
+        int fd = shm_open(name.c_str(), O_RDWR, 0);
+        if (fd < 0) return false;
+        bool ok = map(fd);
+        close(fd);
+        if (!ok) return false;
+        if (segment->magic != SHM_MAGIC || segment->version != SHM_VERSION || segment->size != sizeof(SharedSegment)) {
+            munmap(segment, sizeof(SharedSegment));
+            segment = nullptr;
+            return false;
+        }
+        return true;
+    }
+
+    // Game: publish a new state
+    void publish(const GameSnapshot& snapshot) {
+        std::uint64_t buffer[sizeof(GameSnapshot) / 8];
+        std::memcpy(buffer, &snapshot, sizeof(buffer));
+        std::uint32_t seq = segment->sequence.load(std::memory_order_relaxed);
+        segment->sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t i = 0; i < sizeof(buffer) / 8; ++i)
+            segment->words[i].store(buffer[i], std::memory_order_relaxed);
+        segment->sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    // Bot: number of states published so far, cheap enough to poll
+    std::uint32_t stateVersion() const { return segment->sequence.load(std::memory_order_acquire) / 2; }
+
+    // Bot: copy a consistent state; false if the game kept writing for every attempt.
+    // After a few quick retries the reader yields, in case it preempted the writer.
+    bool read(GameSnapshot& snapshot, int maxAttempts = 1000) const {
+        std::uint64_t buffer[sizeof(GameSnapshot) / 8];
+        for (int attempt = 0; attempt < maxAttempts; ++attempt) {
+            if (attempt >= 16) std::this_thread::yield();
+            std::uint32_t before = segment->sequence.load(std::memory_order_acquire);
+            if (before & 1) continue;
+            for (std::size_t i = 0; i < sizeof(buffer) / 8; ++i)
+                buffer[i] = segment->words[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (segment->sequence.load(std::memory_order_relaxed) == before) {
+                std::memcpy(&snapshot, buffer, sizeof(snapshot));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Bot: queue an action; false when the ring is full
+    bool submit(const BotAction& action) {
+        std::uint32_t tail = segment->tail.load(std::memory_order_relaxed);
+        if (tail - segment->head.load(std::memory_order_acquire) >= ACTION_RING_SIZE) return false;
+        segment->slots[tail & (ACTION_RING_SIZE - 1)].store(action.pack(), std::memory_order_relaxed);
+        segment->tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Game: take the oldest queued action
+    bool poll(BotAction& action) {
+        std::uint32_t head = segment->head.load(std::memory_order_relaxed);
+        if (head == segment->tail.load(std::memory_order_acquire)) return false;
+        action = BotAction::unpack(segment->slots[head & (ACTION_RING_SIZE - 1)].load(std::memory_order_relaxed));
+        segment->head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    bool map(int fd) {
+        void* address = mmap(nullptr, sizeof(SharedSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (address == MAP_FAILED) return false;
+        segment = static_cast<SharedSegment*>(address);
+        return true;
+    }
+
+    std::string name;
+    SharedSegment* segment = nullptr;
+    bool owner = false;
+};
+
+// Game: run one queued bot action on the engine
+inline void applyBotAction(TetrisEngine& engine, const BotAction& action) {
+    if (action.kind == BotAction::Keys) {
+        engine.step(EngineInput::fromBits(action.keys), 0);
+    } else if (action.kind == BotAction::Place) {
+        Placement placement;
+        placement.useHold = action.useHold;
+        placement.rotations = action.rotations;
+        placement.moveX = action.moveX;
+        executePlacement(engine, placement);
+    }
+}
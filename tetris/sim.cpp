@@ -0,0 +1,214 @@
+// Headless Tetris runner: plays seeded games through TetrisEngine as fast as
+// possible and reports throughput and per-step latency.
+
+#include "ai.hpp"
+#include "replay.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+struct SimOptions {
+    int games = 100;
+    unsigned seed = 1;
+    long maxPieces = 10000;
+    std::string script; // empty = random inputs
+    bool ai = false;
+    AiConfig aiConfig;
+    bool highGravity = false;
+    std::string recordPath; // save the first game's inputs here
+    std::string replayPath; // replay this log instead of playing
+};
+
+void printUsage() {
+    std::cout << "Usage: tetris_sim [--games N] [--seed S] [--max-pieces P] [--script KEYS]\n"
+              << "                  [--ai] [--beam W] [--threads T] [--no-lookahead] [--weights FILE]\n"
+              << "                  [--high-gravity] [--record FILE] [--replay FILE]\n"
+              << "  KEYS is replayed in a loop, one tick per character:\n"
+              << "  L/R move, D soft drop, U rotate, S hard drop, C hold, . nothing\n"
+              << "  --ai lets the computer player place every piece\n"
+              << "  --weights FILE loads evaluation weights written by tetris_tune\n"
+              << "  --high-gravity speeds gravity up to 20G after level 10\n"
+              << "  --record saves the inputs of the first game, --replay re-runs a log\n"
+              << "  --games times and checks every run ends in the recorded state\n";
+}
+
+bool parseOptions(int argc, char** argv, SimOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--games" && hasValue) options.games = std::atoi(argv[++i]);
+        else if (arg == "--seed" && hasValue) options.seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--max-pieces" && hasValue) options.maxPieces = std::atol(argv[++i]);
+        else if (arg == "--script" && hasValue) options.script = argv[++i];
+        else if (arg == "--ai") options.ai = true;
+        else if (arg == "--beam" && hasValue) options.aiConfig.beamWidth = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--threads" && hasValue) options.aiConfig.threads = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if (arg == "--no-lookahead") options.aiConfig.lookahead = false;
+        else if (arg == "--weights" && hasValue) {
+            if (!loadEvalWeights(argv[++i], options.aiConfig.weights)) {
+                std::cerr << "Cannot read weights from " << argv[i] << "\n";
+                return false;
+            }
+        }
+        else if (arg == "--high-gravity") options.highGravity = true;
+        else if (arg == "--record" && hasValue) options.recordPath = argv[++i];
+        else if (arg == "--replay" && hasValue) options.replayPath = argv[++i];
+        else return false;
+    }
+    return options.games > 0 && options.maxPieces > 0;
+}
+
+EngineInput inputForScriptKey(char key) {
+    EngineInput input;
+    input.left = key == 'L';
+    input.right = key == 'R';
+    input.softDrop = key == 'D';
+    input.rotate = key == 'U';
+    input.hardDrop = key == 'S';
+    input.hold = key == 'C';
+    return input;
+}
+
+// Mostly idle steps with the occasional key press, roughly like a human player
+EngineInput randomInput(std::mt19937& rng) {
+    EngineInput input;
+    switch (rng() % 32) {
+        case 0: case 1: input.left = true; break;
+        case 2: case 3: input.right = true; break;
+        case 4: input.rotate = true; break;
+        case 5: input.softDrop = true; break;
+        case 6: input.hardDrop = true; break;
+        case 7: input.hold = true; break;
+        default: break;
+    }
+    return input;
+}
+
+typedef std::chrono::steady_clock Clock;
+
+// Replay a recorded game as fast as possible and check it ends the same way
+int runReplay(const SimOptions& options) {
+    InputLog log;
+    if (!loadInputLog(options.replayPath, log)) {
+        std::cerr << "Cannot read input log " << options.replayPath << "\n";
+        return 1;
+    }
+    TetrisEngine engine;
+    int mismatches = 0;
+    ReplayResult result;
+    auto start = Clock::now();
+    for (int run = 0; run < options.games; ++run) {
+        result = replayInputLog(log, engine);
+        if (result != log.expected) mismatches++;
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    double ticks = static_cast<double>(log.endTick) * options.games;
+
+    std::cout << "replays:      " << options.games << "\n"
+              << "seed:         " << log.seed << "\n"
+              << "ticks:        " << log.endTick << " (" << log.endTick / static_cast<double>(TICK_RATE) << " s of play)\n"
+              << "events:       " << log.events.size() << "\n"
+              << "score:        " << result.score << " (recorded " << log.expected.score << ")\n"
+              << "lines:        " << result.lines << "\n"
+              << "pieces:       " << result.pieces << "\n"
+              << "elapsed:      " << seconds << " s\n"
+              << "ticks/sec:    " << ticks / seconds << "\n"
+              << "mismatches:   " << mismatches << "\n";
+    return mismatches ? 2 : 0;
+}
+
+int main(int argc, char** argv) {
+    SimOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+    if (!options.replayPath.empty()) return runReplay(options);
+
+    std::vector<std::uint32_t> stepNanos;
+    stepNanos.reserve(1 << 20);
+    long totalPieces = 0;
+    long totalLines = 0;
+    long long totalScore = 0;
+
+    std::vector<std::uint32_t> decisionNanos;
+    std::unique_ptr<TetrisAI> ai;
+    if (options.ai) ai.reset(new TetrisAI(options.aiConfig));
+
+    TetrisEngine engine;
+    engine.setHighGravity(options.highGravity);
+    std::mt19937 inputRng(options.seed);
+    auto start = Clock::now();
+
+    std::vector<InputEvent> recorded;
+    for (int game = 0; game < options.games; ++game) {
+        engine.setRecorder(game == 0 && !options.recordPath.empty() ? &recorded : nullptr);
+        engine.reset(options.seed + static_cast<unsigned>(game));
+        size_t scriptPos = 0;
+        while (!engine.isGameOver() && engine.getPiecesPlaced() < options.maxPieces) {
+            EngineInput input;
+            if (ai && !engine.getClearingRows()) {
+                auto before = Clock::now();
+                Placement placement;
+                if (ai->decide(engine, placement)) executePlacement(engine, placement);
+                else input.hardDrop = true; // every move loses, end the game
+                decisionNanos.push_back(static_cast<std::uint32_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - before).count()));
+            } else if (ai) {
+                // Let the line clear animation run
+            } else if (options.script.empty()) {
+                input = randomInput(inputRng);
+            } else {
+                input = inputForScriptKey(options.script[scriptPos]);
+                scriptPos = (scriptPos + 1) % options.script.size();
+            }
+            auto before = Clock::now();
+            engine.step(input);
+            auto after = Clock::now();
+            stepNanos.push_back(static_cast<std::uint32_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(after - before).count()));
+        }
+        if (game == 0 && !options.recordPath.empty() &&
+            !saveInputLog(options.recordPath, makeInputLog(engine, recorded))) {
+            std::cerr << "Cannot write input log " << options.recordPath << "\n";
+            return 1;
+        }
+        totalPieces += engine.getPiecesPlaced();
+        totalLines += engine.getLinesCleared();
+        totalScore += engine.getScore();
+    }
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    auto percentile = [](std::vector<std::uint32_t>& samples, double p) -> std::uint32_t {
+        if (samples.empty()) return 0;
+        size_t index = static_cast<size_t>(p * (samples.size() - 1));
+        std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+        return samples[index];
+    };
+
+    std::cout << "games:        " << options.games << "\n"
+              << "steps:        " << stepNanos.size() << "\n"
+              << "pieces:       " << totalPieces << "\n"
+              << "lines:        " << totalLines << "\n"
+              << "avg score:    " << static_cast<double>(totalScore) / options.games << "\n"
+              << "elapsed:      " << seconds << " s\n"
+              << "games/sec:    " << options.games / seconds << "\n"
+              << "pieces/sec:   " << totalPieces / seconds << "\n"
+              << "step p50:     " << percentile(stepNanos, 0.50) << " ns\n"
+              << "step p99:     " << percentile(stepNanos, 0.99) << " ns\n";
+    if (ai) {
+        AiStats stats = ai->getStats();
+        std::cout << "ai threads:   " << ai->getThreadCount() << "\n"
+                  << "decide p50:   " << percentile(decisionNanos, 0.50) / 1000.0 << " us\n"
+                  << "decide p99:   " << percentile(decisionNanos, 0.99) / 1000.0 << " us\n"
+                  << "evaluations:  " << stats.evaluations << " (" << stats.tableHits << " table hits)\n";
+    }
+    return 0;
+}
@@ -0,0 +1,268 @@
+// Genetic tuner for the Tetris evaluation weights. Every candidate plays the
+// same seeded headless games with the greedy player; the best ones breed the
+// next generation. Each generation is checkpointed so a run can be resumed.
+
+#include "ai.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+const int WEIGHT_COUNT = 5;
+typedef std::array<double, WEIGHT_COUNT> Genome; // height, lines, holes, bumpiness, wells
+
+struct TuneOptions {
+    int population = 100;
+    int generations = 30;
+    int games = 20;          // games per candidate and generation
+    long maxPieces = 500;    // cap per game, keeps good candidates from playing forever
+    unsigned seed = 1;
+    unsigned threads = 0;
+    double offspringRatio = 0.3;   // share of the population replaced every generation
+    double tournamentRatio = 0.1;
+    double mutationRate = 0.05;
+    std::string checkpointPath = "tetris_tune.ckpt";
+    std::string outPath = "tetris_weights.txt";
+    bool resume = false;
+};
+
+struct Candidate {
+    Genome genome;
+    double fitness = 0.0; // average lines cleared per game
+};
+
+void printUsage() {
+    std::cout << "Usage: tetris_tune [--population N] [--generations G] [--games K] [--max-pieces P]\n"
+              << "                   [--seed S] [--threads T] [--checkpoint FILE] [--out FILE] [--resume]\n"
+              << "  Each generation every candidate plays K seeded games of at most P pieces.\n"
+              << "  The best weights are written to --out after every generation, in the\n"
+              << "  format read by tetris --weights and tetris_sim --weights.\n"
+              << "  --resume continues from the generation stored in the checkpoint\n";
+}
+
+bool parseOptions(int argc, char** argv, TuneOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--population" && hasValue) options.population = std::atoi(argv[++i]);
+        else if (arg == "--generations" && hasValue) options.generations = std::atoi(argv[++i]);
+        else if (arg == "--games" && hasValue) options.games = std::atoi(argv[++i]);
+        else if (arg == "--max-pieces" && hasValue) options.maxPieces = std::atol(argv[++i]);
+        else if (arg == "--seed" && hasValue) options.seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--threads" && hasValue) options.threads = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if (arg == "--checkpoint" && hasValue) options.checkpointPath = argv[++i];
+        else if (arg == "--out" && hasValue) options.outPath = argv[++i];
+        else if (arg == "--resume") options.resume = true;
+        else return false;
+    }
+    return options.population >= 4 && options.generations > 0 && options.games > 0 && options.maxPieces > 0;
+}
+
+EvalWeights toWeights(const Genome& g) {
+    EvalWeights w;
+    w.aggregateHeight = g[0];
+    w.linesCleared = g[1];
+    w.holes = g[2];
+    w.bumpiness = g[3];
+    w.wells = g[4];
+    return w;
+}
+
+// Only the direction of the weight vector changes which move is picked
+void normalize(Genome& g) {
+    double length = 0.0;
+    for (double v : g) length += v * v;
+    length = std::sqrt(length);
+    if (length == 0.0) {
+        g[1] = 1.0;
+        return;
+    }
+    for (double& v : g) v /= length;
+}
+
+// Lines cleared by the greedy player in one seeded game
+long playGame(const EvalWeights& weights, unsigned seed, long maxPieces, long& pieces) {
+    thread_local std::vector<Placement> scratch;
+    TetrisEngine engine(seed);
+    Placement placement;
+    while (!engine.isGameOver() && engine.getPiecesPlaced() < maxPieces) {
+        if (!greedyPlacement(engine.getGrid(), engine.getCurrent(), weights, scratch, placement)) break;
+        executePlacement(engine, placement);
+        // Skip the line clear animation in one go
+        if (engine.getClearingRows()) engine.step(EngineInput(), CLEAR_ANIM_TICKS);
+    }
+    pieces = engine.getPiecesPlaced();
+    return engine.getLinesCleared();
+}
+
+// The breeding generator depends only on the seed and generation, so a
+// resumed run continues exactly like an uninterrupted one
+std::mt19937_64 generationRng(unsigned seed, int generation) {
+    std::uint64_t state = (static_cast<std::uint64_t>(seed) << 32) ^ static_cast<std::uint64_t>(generation);
+    return std::mt19937_64(splitMix64(state));
+}
+
+std::vector<Candidate> randomPopulation(const TuneOptions& options) {
+    std::mt19937_64 rng = generationRng(options.seed, -1);
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    std::vector<Candidate> population(options.population);
+    for (Candidate& c : population) {
+        for (double& v : c.genome) v = uniform(rng);
+        normalize(c.genome);
+    }
+    return population;
+}
+
+// Tournament selection, fitness-weighted crossover and a small mutation;
+// the offspring replace the weakest candidates
+void breed(std::vector<Candidate>& population, const TuneOptions& options, int generation) {
+    std::mt19937_64 rng = generationRng(options.seed, generation);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    int count = static_cast<int>(population.size());
+    int tournamentSize = std::min(count, std::max(2, static_cast<int>(count * options.tournamentRatio)));
+    int offspringCount = std::max(1, static_cast<int>(count * options.offspringRatio));
+
+    std::vector<Candidate> offspring;
+    std::vector<int> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::vector<int> picks(tournamentSize);
+    for (int n = 0; n < offspringCount; ++n) {
+        // Distinct picks (a partial shuffle), so a candidate never breeds with itself
+        for (int i = 0; i < tournamentSize; ++i) {
+            std::swap(order[i], order[i + static_cast<int>(rng() % (count - i))]);
+            picks[i] = order[i];
+        }
+        std::sort(picks.begin(), picks.end(), [&](int a, int b) { return population[a].fitness > population[b].fitness; });
+        const Candidate& a = population[picks[0]];
+        const Candidate& b = population[picks[1]];
+        double fa = a.fitness, fb = b.fitness;
+        if (fa + fb <= 0.0) fa = fb = 1.0;
+
+        Candidate child;
+        for (int i = 0; i < WEIGHT_COUNT; ++i)
+            child.genome[i] = a.genome[i] * fa + b.genome[i] * fb;
+        if (unit(rng) < options.mutationRate)
+            child.genome[rng() % WEIGHT_COUNT] += unit(rng) * 0.4 - 0.2;
+        normalize(child.genome);
+        offspring.push_back(child);
+    }
+
+    std::sort(population.begin(), population.end(),
+              [](const Candidate& a, const Candidate& b) { return a.fitness > b.fitness; });
+    std::copy(offspring.begin(), offspring.end(), population.end() - offspringCount);
+}
+
+// Plain text so a checkpoint can be inspected or edited by hand
+bool saveCheckpoint(const std::string& path, int generation, const std::vector<Candidate>& population) {
+    std::string temp = path + ".tmp";
+    {
+        std::ofstream out(temp);
+        out.precision(17);
+        out << "tetris_tune 1\n" << generation << " " << population.size() << "\n";
+        for (const Candidate& c : population) {
+            for (double v : c.genome) out << v << " ";
+            out << c.fitness << "\n";
+        }
+        if (!out) return false;
+    }
+    // Replace the old checkpoint only once the new one is complete
+    return std::rename(temp.c_str(), path.c_str()) == 0;
+}
+
+bool loadCheckpoint(const std::string& path, int& generation, std::vector<Candidate>& population) {
+    std::ifstream in(path);
+    std::string magic;
+    int version;
+    size_t count;
+    if (!(in >> magic >> version >> generation >> count) || magic != "tetris_tune" || version != 1) return false;
+    population.assign(count, Candidate());
+    for (Candidate& c : population) {
+        for (double& v : c.genome) in >> v;
+        in >> c.fitness;
+    }
+    return static_cast<bool>(in);
+}
+
+int main(int argc, char** argv) {
+    TuneOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+
+    std::vector<Candidate> population;
+    int firstGeneration = 0;
+    if (options.resume) {
+        int done;
+        if (!loadCheckpoint(options.checkpointPath, done, population)) {
+            std::cerr << "Cannot read checkpoint " << options.checkpointPath << "\n";
+            return 1;
+        }
+        std::cout << "resuming after generation " << done << " (" << population.size() << " candidates)\n";
+        breed(population, options, done);
+        firstGeneration = done + 1;
+    } else {
+        population = randomPopulation(options);
+    }
+
+    ThreadPool pool(options.threads);
+    std::cout << "threads: " << pool.size() << ", " << population.size() << " candidates x " << options.games
+              << " games, at most " << options.maxPieces << " pieces each\n";
+
+    typedef std::chrono::steady_clock Clock;
+    size_t gameCount = population.size() * static_cast<size_t>(options.games);
+    std::vector<long> lines(gameCount);
+    std::vector<long> pieces(gameCount);
+
+    for (int generation = firstGeneration; generation < options.generations; ++generation) {
+        auto start = Clock::now();
+        // Every candidate plays the same games; the games change every generation
+        unsigned firstSeed = options.seed * 7919u + static_cast<unsigned>(generation * options.games);
+        // One task per game, handed out from a shared counter so idle threads
+        // take the next game as soon as they finish one
+        pool.parallelFor(gameCount, [&](size_t task) {
+            size_t candidate = task / options.games;
+            unsigned seed = firstSeed + static_cast<unsigned>(task % options.games);
+            lines[task] = playGame(toWeights(population[candidate].genome), seed, options.maxPieces, pieces[task]);
+        });
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        long totalPieces = 0;
+        for (size_t c = 0; c < population.size(); ++c) {
+            long total = 0;
+            for (int g = 0; g < options.games; ++g) {
+                total += lines[c * options.games + g];
+                totalPieces += pieces[c * options.games + g];
+            }
+            population[c].fitness = static_cast<double>(total) / options.games;
+        }
+
+        const Candidate* best = &population[0];
+        double average = 0.0;
+        for (const Candidate& c : population) {
+            average += c.fitness;
+            if (c.fitness > best->fitness) best = &c;
+        }
+        average /= population.size();
+
+        std::printf("gen %3d  best %7.1f  avg %7.1f lines  %6.0f games/s  %8.0f pieces/s  (%.2f s)\n", generation,
+                    best->fitness, average, gameCount / seconds, totalPieces / seconds, seconds);
+        std::printf("         height %.4f  lines %.4f  holes %.4f  bumpiness %.4f  wells %.4f\n",
+                    best->genome[0], best->genome[1], best->genome[2], best->genome[3], best->genome[4]);
+        std::fflush(stdout);
+
+        if (!saveEvalWeights(options.outPath, toWeights(best->genome)))
+            std::cerr << "Cannot write " << options.outPath << "\n";
+        if (!saveCheckpoint(options.checkpointPath, generation, population))
+            std::cerr << "Cannot write checkpoint " << options.checkpointPath << "\n";
+
+        if (generation + 1 < options.generations) breed(population, options, generation);
+    }
+    return 0;
+}
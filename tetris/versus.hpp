@@ -0,0 +1,113 @@
+#pragma once
+
+#include "replay.hpp"
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+// Two-player versus rules on top of TetrisEngine. Both players get the same
+// piece sequence; every line clear sends garbage rows to the opponent, with
+// one random hole column per attack. The match is deterministic in its seed
+// and the inputs of both players, so a server and its clients can run the
+// same match from the same input stream.
+
+const std::uint8_t NO_WINNER = 0xFF; // match still running
+const std::uint8_t DRAW = 2;         // both players topped out on the same tick
+
+// Input applied by `player` before tick `tick` was simulated
+struct VersusInput {
+    std::uint32_t tick;
+    std::uint8_t player;
+    std::uint8_t keys;
+};
+
+// Everything a match needs to continue, copyable as raw bytes (rollback)
+struct VersusState {
+    EngineState players[2];
+    PieceRng garbageRng;
+    unsigned matchSeed;
+    std::uint32_t tick;
+    std::uint8_t winner;
+};
+
+static_assert(std::is_trivially_copyable<VersusState>::value, "match state must be copyable as raw bytes");
+
+class VersusMatch {
+public:
+    explicit VersusMatch(unsigned seed = 0) { reset(seed); }
+
+    void reset(unsigned seed) {
+        matchSeed = seed;
+        players[0].reset(seed);
+        players[1].reset(seed);
+        garbageRng.seed(seed, STREAM_GARBAGE); // independent of the pieces
+        tick = 0;
+        winner = NO_WINNER;
+    }
+
+    // A key press between two ticks
+    void press(int player, std::uint8_t keys) {
+        if (winner == NO_WINNER) players[player].step(EngineInput::fromBits(keys), 0);
+    }
+
+    // Simulate one tick for both players, then deliver the garbage they sent
+    void advance() {
+        if (winner != NO_WINNER) return;
+        players[0].step(EngineInput(), 1);
+        players[1].step(EngineInput(), 1);
+        tick++;
+        for (int p = 0; p < 2; ++p) {
+            int lines = players[p].takeGarbageOut();
+            if (lines) players[1 - p].addGarbage(lines, static_cast<int>(garbageRng() % GRID_WIDTH));
+        }
+        bool lost0 = players[0].isGameOver(), lost1 = players[1].isGameOver();
+        if (lost0 && lost1) winner = DRAW;
+        else if (lost0) winner = 1;
+        else if (lost1) winner = 0;
+    }
+
+    // Replay inputs up to (not including) `untilTick`; `inputs` must be in tick order
+    void runTo(std::uint32_t untilTick, const std::vector<VersusInput>& inputs, size_t& next) {
+        while (tick < untilTick && winner == NO_WINNER) {
+            for (; next < inputs.size() && inputs[next].tick == tick; ++next) press(inputs[next].player, inputs[next].keys);
+            advance();
+        }
+    }
+
+    bool finished() const { return winner != NO_WINNER; }
+    std::uint8_t getWinner() const { return winner; }
+    std::uint32_t getTick() const { return tick; }
+    unsigned getSeed() const { return matchSeed; }
+    TetrisEngine& player(int p) { return players[p]; }
+    const TetrisEngine& player(int p) const { return players[p]; }
+
+    void saveState(VersusState& saved) const {
+        saved.players[0] = players[0].saveState();
+        saved.players[1] = players[1].saveState();
+        saved.garbageRng = garbageRng;
+        saved.matchSeed = matchSeed;
+        saved.tick = tick;
+        saved.winner = winner;
+    }
+
+    void loadState(const VersusState& saved) {
+        players[0].loadState(saved.players[0]);
+        players[1].loadState(saved.players[1]);
+        garbageRng = saved.garbageRng;
+        matchSeed = saved.matchSeed;
+        tick = saved.tick;
+        winner = saved.winner;
+    }
+
+    // Checked by clients against the server's value when the match ends
+    std::uint64_t stateHash() const {
+        return (engineStateHash(players[0]) * 31 ^ engineStateHash(players[1]) ^ tick) + garbageRng.state;
+    }
+
+private:
+    TetrisEngine players[2];
+    PieceRng garbageRng;
+    unsigned matchSeed = 0;
+    std::uint32_t tick = 0;
+    std::uint8_t winner = NO_WINNER;
+};
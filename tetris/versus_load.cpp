@@ -0,0 +1,204 @@
+// Loopback load generator for tetris_server: opens two connections per
+// match, joins the queue and presses random keys at a human-like rate.
+// Finished matches rejoin the queue straight away so the load stays
+// constant. Some clients keep a full copy of their match and check it
+// against the server's state hash when it ends.
+
+#include "versus_net.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+typedef std::chrono::steady_clock Clock;
+
+struct LoadOptions {
+    std::string host = "127.0.0.1";
+    int port = VERSUS_DEFAULT_PORT;
+    int matches = 100;
+    double duration = 10.0;   // seconds
+    int pressEvery = 12;      // average ticks between key presses per client
+    int verify = 10;          // clients that replay their match and check the hash
+    unsigned seed = 1;
+};
+
+void printUsage() {
+    std::cout << "Usage: tetris_versus_load [--server HOST:PORT] [--matches N] [--duration S]\n"
+              << "                          [--press-every T] [--verify K] [--seed S]\n"
+              << "  Opens 2N connections to tetris_server and keeps N matches running.\n"
+              << "  Every client presses a random key every T ticks on average; the first K\n"
+              << "  clients replay their matches and check them against the server\n";
+}
+
+bool parseOptions(int argc, char** argv, LoadOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--server" && hasValue) parseHostPort(argv[++i], options.host, options.port);
+        else if (arg == "--matches" && hasValue) options.matches = std::atoi(argv[++i]);
+        else if (arg == "--duration" && hasValue) options.duration = std::atof(argv[++i]);
+        else if (arg == "--press-every" && hasValue) options.pressEvery = std::atoi(argv[++i]);
+        else if (arg == "--verify" && hasValue) options.verify = std::atoi(argv[++i]);
+        else if (arg == "--seed" && hasValue) options.seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        else return false;
+    }
+    return options.matches > 0 && options.duration > 0 && options.pressEvery > 0 && options.verify >= 0;
+}
+
+struct LoadClient {
+    int fd = -1;
+    std::vector<std::uint8_t> in;
+    std::vector<std::uint8_t> out;
+    size_t outOffset = 0;
+    bool playing = false;
+    int player = 0;
+    bool verifying = false;
+    VersusReplica replica;                  // only used when verifying
+    std::deque<Clock::time_point> pressed;  // sent presses waiting for the server's echo
+};
+
+// A few keys a player would actually press, hard drops less often
+std::uint8_t randomKeys(std::mt19937& rng) {
+    EngineInput input;
+    switch (rng() % 8) {
+        case 0: case 1: input.left = true; break;
+        case 2: case 3: input.right = true; break;
+        case 4: input.rotate = true; break;
+        case 5: input.softDrop = true; break;
+        case 6: input.hardDrop = true; break;
+        default: input.hold = true; break;
+    }
+    return input.toBits();
+}
+
+std::uint32_t percentile(std::vector<std::uint32_t> samples, double p) {
+    if (samples.empty()) return 0;
+    size_t index = static_cast<size_t>(p * (samples.size() - 1));
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples[index];
+}
+
+int main(int argc, char** argv) {
+    LoadOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+    raiseFileLimit();
+
+    int epollFd = epoll_create1(0);
+    int timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    itimerspec period{};
+    period.it_interval.tv_nsec = 1000000000L / TICK_RATE;
+    period.it_value = period.it_interval;
+    timerfd_settime(timerFd, 0, &period, nullptr);
+    epoll_event timerEvent{};
+    timerEvent.events = EPOLLIN;
+    timerEvent.data.u64 = ~0ull;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, timerFd, &timerEvent);
+
+    std::vector<LoadClient> clients(options.matches * 2);
+    for (size_t i = 0; i < clients.size(); ++i) {
+        LoadClient& c = clients[i];
+        c.fd = connectTcp(options.host, options.port);
+        if (c.fd < 0) {
+            std::cerr << "Cannot connect to " << options.host << ":" << options.port << " (client " << i << ")\n";
+            return 1;
+        }
+        c.verifying = static_cast<int>(i) < options.verify;
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = i;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, c.fd, &event);
+        writeHello(c.out);
+        sendPending(c.fd, c.out, c.outOffset);
+    }
+    std::cout << clients.size() << " clients connected to " << options.host << ":" << options.port << "\n";
+
+    std::mt19937 rng(options.seed);
+    long started = 0, finished = 0, verified = 0, mismatches = 0, disconnected = 0;
+    long received = 0, presses = 0;
+    std::vector<std::uint32_t> echoMicros;
+    auto start = Clock::now(), lastReport = start;
+    epoll_event events[512];
+
+    while (std::chrono::duration<double>(Clock::now() - start).count() < options.duration) {
+        int count = epoll_wait(epollFd, events, 512, 100);
+        for (int e = 0; e < count; ++e) {
+            if (events[e].data.u64 == ~0ull) {
+                std::uint64_t expirations;
+                if (read(timerFd, &expirations, sizeof(expirations)) != sizeof(expirations)) continue;
+                // Each playing client presses with probability 1 / pressEvery per tick
+                for (LoadClient& c : clients) {
+                    if (c.fd < 0 || !c.playing || rng() % options.pressEvery) continue;
+                    writeInput(c.out, randomKeys(rng));
+                    c.pressed.push_back(Clock::now());
+                    presses++;
+                    if (!sendPending(c.fd, c.out, c.outOffset)) c.playing = false;
+                }
+                continue;
+            }
+
+            LoadClient& c = clients[events[e].data.u64];
+            size_t before = c.in.size();
+            bool open = receiveAvailable(c.fd, c.in);
+            received += static_cast<long>(c.in.size() - before);
+            bool valid = readMessages(c.in, [&](std::uint8_t type, const std::uint8_t* payload) {
+                if (c.verifying) c.replica.onMessage(type, payload);
+                if (type == MSG_START) {
+                    c.playing = true;
+                    c.player = payload[4];
+                    c.pressed.clear();
+                    if (c.player == 0) started++;
+                } else if (type == MSG_INPUTS && payload[4] == c.player && !c.pressed.empty()) {
+                    echoMicros.push_back(static_cast<std::uint32_t>(
+                        std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - c.pressed.front()).count()));
+                    c.pressed.pop_front();
+                } else if (type == MSG_END) {
+                    c.playing = false;
+                    if (c.player == 0) finished++;
+                    if (c.verifying && payload[1] == END_TOPPED_OUT) {
+                        verified++;
+                        if (c.replica.desync) mismatches++;
+                    }
+                    writeHello(c.out); // straight back into the queue
+                }
+            });
+            if (!open || !valid || !sendPending(c.fd, c.out, c.outOffset)) {
+                epoll_ctl(epollFd, EPOLL_CTL_DEL, c.fd, nullptr);
+                close(c.fd);
+                c.fd = -1;
+                c.playing = false;
+                disconnected++;
+            }
+        }
+
+        if (Clock::now() - lastReport >= std::chrono::seconds(1)) {
+            double seconds = std::chrono::duration<double>(Clock::now() - lastReport).count();
+            lastReport = Clock::now();
+            long playing = 0;
+            for (const LoadClient& c : clients) playing += c.playing;
+            std::printf("%5ld matches playing  %6ld started  %6ld finished  %7.0f presses/s  %7.0f KB/s in  "
+                        "echo p50 %u us p99 %u us\n",
+                        playing / 2, started, finished, presses / seconds, received / 1024.0 / seconds,
+                        percentile(echoMicros, 0.50), percentile(echoMicros, 0.99));
+            std::fflush(stdout);
+            presses = received = 0;
+        }
+    }
+
+    std::printf("summary: %ld matches started, %ld finished, %ld verified, %ld desynced, %ld disconnects\n",
+                started, finished, verified, mismatches, disconnected);
+    std::printf("         input echo p50 %u us, p99 %u us over %zu presses\n", percentile(echoMicros, 0.50),
+                percentile(echoMicros, 0.99), echoMicros.size());
+    return mismatches || disconnected ? 2 : 0;
+}
@@ -0,0 +1,353 @@
+#pragma once
+
+#include "versus.hpp"
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Wire protocol between tetris_server and its clients. Every message is a
+// type byte followed by a payload whose size depends only on the type;
+// integers are little-endian. The server runs the matches and streams the
+// inputs of both players back to each client, which replays them on its own
+// copy of the match (see VersusMatch), so no board state is ever sent.
+//
+//   client -> server
+//     HELLO   u8 protocol version         join the matchmaking queue
+//     INPUT   u8 key bits                 applied at the server's current tick
+//   server -> client
+//     START   u32 seed, u8 player index   a match begins at tick 0
+//     INPUTS  u32 tick, u8 player, u8 key bits
+//     SYNC    u32 tick                    every input before this tick was sent
+//     END     u8 winner, u8 reason, u32 tick, u64 state hash
+
+const std::uint8_t VERSUS_PROTOCOL = 1;
+const int VERSUS_DEFAULT_PORT = 7777;
+
+enum VersusMessage : std::uint8_t {
+    MSG_HELLO = 1,
+    MSG_INPUT = 2,
+    MSG_START = 3,
+    MSG_INPUTS = 4,
+    MSG_SYNC = 5,
+    MSG_END = 6,
+};
+
+enum EndReason : std::uint8_t {
+    END_TOPPED_OUT = 0,
+    END_OPPONENT_LEFT = 1,
+};
+
+// Payload size of each message type, -1 for unknown types
+inline int versusPayloadSize(std::uint8_t type) {
+    switch (type) {
+        case MSG_HELLO: return 1;
+        case MSG_INPUT: return 1;
+        case MSG_START: return 5;
+        case MSG_INPUTS: return 6;
+        case MSG_SYNC: return 4;
+        case MSG_END: return 14;
+        default: return -1;
+    }
+}
+
+inline void putU32(std::vector<std::uint8_t>& out, std::uint32_t v) {
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<std::uint8_t>(v >> (i * 8)));
+}
+
+inline void putU64(std::vector<std::uint8_t>& out, std::uint64_t v) {
+    for (int i = 0; i < 8; ++i) out.push_back(static_cast<std::uint8_t>(v >> (i * 8)));
+}
+
+inline std::uint32_t getU32(const std::uint8_t* p) {
+    return static_cast<std::uint32_t>(p[0]) | static_cast<std::uint32_t>(p[1]) << 8 |
+           static_cast<std::uint32_t>(p[2]) << 16 | static_cast<std::uint32_t>(p[3]) << 24;
+}
+
+inline std::uint64_t getU64(const std::uint8_t* p) {
+    return static_cast<std::uint64_t>(getU32(p)) | static_cast<std::uint64_t>(getU32(p + 4)) << 32;
+}
+
+inline void writeHello(std::vector<std::uint8_t>& out) {
+    out.push_back(MSG_HELLO);
+    out.push_back(VERSUS_PROTOCOL);
+}
+
+inline void writeInput(std::vector<std::uint8_t>& out, std::uint8_t keys) {
+    out.push_back(MSG_INPUT);
+    out.push_back(keys);
+}
+
+inline void writeStart(std::vector<std::uint8_t>& out, std::uint32_t seed, std::uint8_t player) {
+    out.push_back(MSG_START);
+    putU32(out, seed);
+    out.push_back(player);
+}
+
+inline void writeInputs(std::vector<std::uint8_t>& out, const VersusInput& input) {
+    out.push_back(MSG_INPUTS);
+    putU32(out, input.tick);
+    out.push_back(input.player);
+    out.push_back(input.keys);
+}
+
+inline void writeSync(std::vector<std::uint8_t>& out, std::uint32_t tick) {
+    out.push_back(MSG_SYNC);
+    putU32(out, tick);
+}
+
+inline void writeEnd(std::vector<std::uint8_t>& out, std::uint8_t winner, std::uint8_t reason, std::uint32_t tick,
+                     std::uint64_t hash) {
+    out.push_back(MSG_END);
+    out.push_back(winner);
+    out.push_back(reason);
+    putU32(out, tick);
+    putU64(out, hash);
+}
+
+// Call onMessage(type, payload) for every complete message in `buffer` and
+// drop them from it. Returns false on a message type it does not know.
+template <typename Handler>
+bool readMessages(std::vector<std::uint8_t>& buffer, Handler onMessage) {
+    size_t pos = 0;
+    bool ok = true;
+    while (pos < buffer.size()) {
+        int size = versusPayloadSize(buffer[pos]);
+        if (size < 0) {
+            ok = false;
+            break;
+        }
+        if (pos + 1 + size > buffer.size()) break;
+        onMessage(buffer[pos], &buffer[pos + 1]);
+        pos += 1 + size;
+    }
+    buffer.erase(buffer.begin(), buffer.begin() + pos);
+    return ok;
+}
+
+// Client side copy of a match, driven by the server's messages
+class VersusReplica {
+public:
+    enum State { Idle, Playing, Ended };
+
+    State state = Idle;
+    int you = -1;
+    VersusMatch match;
+    std::uint8_t winner = NO_WINNER;
+    std::uint8_t endReason = END_TOPPED_OUT;
+    bool desync = false; // our copy did not end like the server's
+
+    void onMessage(std::uint8_t type, const std::uint8_t* payload) {
+        if (type == MSG_START) {
+            match.reset(getU32(payload));
+            you = payload[4];
+            inputs.clear();
+            nextInput = 0;
+            winner = NO_WINNER;
+            desync = false;
+            state = Playing;
+        } else if (state != Playing) {
+            return;
+        } else if (type == MSG_INPUTS) {
+            inputs.push_back(VersusInput{getU32(payload), payload[4], payload[5]});
+        } else if (type == MSG_SYNC) {
+            catchUp(getU32(payload));
+        } else if (type == MSG_END) {
+            winner = payload[0];
+            endReason = payload[1];
+            catchUp(getU32(payload + 2));
+            if (endReason == END_TOPPED_OUT)
+                desync = match.getWinner() != winner || match.stateHash() != getU64(payload + 6);
+            state = Ended;
+        }
+    }
+
+private:
+    void catchUp(std::uint32_t tick) {
+        match.runTo(tick, inputs, nextInput);
+        // Inputs already applied are not needed any more
+        if (nextInput > 256) {
+            inputs.erase(inputs.begin(), inputs.begin() + nextInput);
+            nextInput = 0;
+        }
+    }
+
+    std::vector<VersusInput> inputs;
+    size_t nextInput = 0;
+};
+
+inline bool setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+// Inputs are tiny and latency matters more than packet count
+inline void setNoDelay(int fd) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+// Thousands of connections need more than the usual 1024 descriptors
+inline void raiseFileLimit() {
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+// Non-blocking listening socket on all interfaces, -1 on failure
+inline int listenTcp(int port, int backlog = 4096) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(static_cast<std::uint16_t>(port));
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, backlog) != 0 ||
+        !setNonBlocking(fd)) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Blocking connect, then switched to non-blocking; -1 on failure
+inline int connectTcp(const std::string& host, int port) {
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* found = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &found) != 0) return -1;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    bool ok = fd >= 0 && connect(fd, found->ai_addr, found->ai_addrlen) == 0 && setNonBlocking(fd);
+    freeaddrinfo(found);
+    if (!ok) {
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    setNoDelay(fd);
+    return fd;
+}
+
+// Read everything available; false once the peer closed or the socket failed
+inline bool receiveAvailable(int fd, std::vector<std::uint8_t>& buffer) {
+    std::uint8_t chunk[4096];
+    for (;;) {
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n > 0) {
+            buffer.insert(buffer.end(), chunk, chunk + n);
+            if (static_cast<size_t>(n) < sizeof(chunk)) return true;
+        } else if (n == 0) {
+            return false;
+        } else {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+    }
+}
+
+// Send as much of buffer[offset..] as the socket takes; the buffer is cleared
+// once everything went out. False when the socket failed.
+inline bool sendPending(int fd, std::vector<std::uint8_t>& buffer, size_t& offset) {
+    while (offset < buffer.size()) {
+        ssize_t n = send(fd, buffer.data() + offset, buffer.size() - offset, MSG_NOSIGNAL);
+        if (n > 0) {
+            offset += static_cast<size_t>(n);
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return true;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            return false;
+        }
+    }
+    buffer.clear();
+    offset = 0;
+    return true;
+}
+
+// Split "host:port"; the port defaults to VERSUS_DEFAULT_PORT
+inline void parseHostPort(const std::string& text, std::string& host, int& port) {
+    size_t colon = text.rfind(':');
+    host = colon == std::string::npos ? text : text.substr(0, colon);
+    port = colon == std::string::npos ? VERSUS_DEFAULT_PORT : std::atoi(text.c_str() + colon + 1);
+    if (host.empty()) host = "127.0.0.1";
+}
+
+// A player's connection to tetris_server, used by the SFML client
+class VersusConnection {
+public:
+    VersusReplica replica;
+    bool searching = false; // HELLO sent, waiting for an opponent
+
+    VersusConnection() = default;
+    VersusConnection(const VersusConnection&) = delete;
+    VersusConnection& operator=(const VersusConnection&) = delete;
+    ~VersusConnection() {
+        if (fd >= 0) close(fd);
+    }
+
+    bool connectTo(const std::string& host, int port) {
+        fd = connectTcp(host, port);
+        return fd >= 0;
+    }
+    bool isOpen() const { return fd >= 0; }
+    bool playing() const { return replica.state == VersusReplica::Playing; }
+
+    // Join the queue for the next match
+    void findMatch() {
+        if (searching || playing()) return;
+        writeHello(out);
+        searching = true;
+        flush();
+    }
+
+    void sendKeys(std::uint8_t keys) {
+        if (!playing() || !keys) return;
+        writeInput(out, keys);
+        flush();
+    }
+
+    // Apply everything the server sent; false once the connection is lost
+    bool pump() {
+        if (fd < 0) return false;
+        bool open = receiveAvailable(fd, in);
+        bool valid = readMessages(in, [&](std::uint8_t type, const std::uint8_t* payload) {
+            replica.onMessage(type, payload);
+            if (type == MSG_START) searching = false;
+        });
+        if (open && valid) flush();
+        if (!open || !valid || fd < 0) {
+            if (fd >= 0) close(fd);
+            fd = -1;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    void flush() {
+        if (fd >= 0 && !sendPending(fd, out, outOffset)) {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    int fd = -1;
+    std::vector<std::uint8_t> in;
+    std::vector<std::uint8_t> out;
+    size_t outOffset = 0;
+};